@@ -19,23 +19,35 @@
 
 #include "am_driver_safe/automower_safe.h"
 #include "am_driver_safe/automower_safe_states.h"
+#include "am_driver_safe/automower_startup.h"
 
 decision_making::RosEventQueue* eventQueue;
 void stateMachineThread1();
 
 int main( int argc, char** argv )
 {
+    Husqvarna::StartupTrace& startup = Husqvarna::StartupTrace::instance();
+
+    startup.begin("ros init");
     ros::init(argc,argv, "am_driver_safe_node");
     ros_decision_making_init(argc, argv);
 
     ros::NodeHandle n;
+    startup.end("ros init");
 
 
     ros::Time lastTime;
 
+    startup.begin("event queue");
     eventQueue = new decision_making::RosEventQueue();
+    startup.end("event queue");
+
+    // The driver loads the model in the background, the serial port is
+    // opened meanwhile and the first update waits for the model
+    startup.begin("driver");
     Husqvarna::AutomowerSafePtr am(new Husqvarna::AutomowerSafe(n,eventQueue));
     Husqvarna::ConnectDriverAndStates(am);
+    startup.end("driver");
 
     double updateRate = am->GetUpdateRate();
     ros::Rate rate(updateRate);
@@ -630,6 +630,11 @@ hcp_Int amg3_Decode(hcp_tRuntime* pRuntime, hcp_tProtocol* pProtocol, const hcp_
 	hcp_Int error = 0;
 	amg3_tSession* session = (amg3_tSession*)pContext->value;
 
+	// the session lives inside the codec, which is moved when the codec
+	// vector of a dynamic state grows, so the receive buffer is rebound
+	// instead of relying on the address stored by amg3_Setup
+	session->received.value = session->buff;
+
 	while (completeMessage == HCP_FALSE && length > 0) {
 		error = amg3_InterpretByte(pRuntime,*source, session, &completeMessage);
 		source++; length--;
@@ -0,0 +1,192 @@
+/*
+ * automower_arbiter.cpp
+ *
+ *  Priority ordered access to the serial link of the Automower HRP
+ *  interface.
+ */
+
+#include "am_driver_safe/automower_arbiter.h"
+
+#include <string.h>
+
+namespace Husqvarna
+{
+
+namespace
+{
+
+typedef struct
+{
+    const char* prefix;
+    SerialPriority priority;
+} CommandClass;
+
+// First match wins, everything else is SERIAL_PRIORITY_CONTROL
+const CommandClass COMMAND_CLASSES[] =
+{
+    {"HardwareControl.WheelMotorsPower", SERIAL_PRIORITY_ACTUATION},
+    {"Wheels.PowerOff", SERIAL_PRIORITY_ACTUATION},
+    {"BladeMotor.Brake", SERIAL_PRIORITY_ACTUATION},
+    {"RealTimeData.", SERIAL_PRIORITY_TELEMETRY},
+    {"LoopSampler.", SERIAL_PRIORITY_TELEMETRY},
+    {"Wheels.GetRotationCounter", SERIAL_PRIORITY_TELEMETRY},
+    {"CurrentStatus.", SERIAL_PRIORITY_TELEMETRY},
+    {"DeviceInformation.", SERIAL_PRIORITY_TELEMETRY},
+    {"MowerApp.GetState", SERIAL_PRIORITY_TELEMETRY},
+    {"SystemSettings.GetLoopDetection", SERIAL_PRIORITY_TELEMETRY},
+    {"Charger.IsChargingPowerConnected", SERIAL_PRIORITY_TELEMETRY},
+};
+
+const double DEFAULT_MAX_WAIT = 0.1;
+
+const uint64_t NO_OWNER = ~(uint64_t)0;
+
+// Shorter limits would promote nearly every waiter, and mean a typo
+const double MIN_MAX_WAIT = 0.001;
+
+}
+
+SerialPriority serialPriority(const char* command)
+{
+    for (size_t i = 0; i < sizeof(COMMAND_CLASSES) / sizeof(COMMAND_CLASSES[0]); i++)
+    {
+        if (strncmp(command, COMMAND_CLASSES[i].prefix, strlen(COMMAND_CLASSES[i].prefix)) == 0)
+        {
+            return COMMAND_CLASSES[i].priority;
+        }
+    }
+    return SERIAL_PRIORITY_CONTROL;
+}
+
+SerialArbiter::SerialArbiter()
+    : mutex()
+    , released()
+    , queues()
+    , stats()
+    , maxWait()
+    , nextTicket(0)
+    , owner(NO_OWNER)
+    , isBusy(false)
+{
+    setMaxWait(DEFAULT_MAX_WAIT);
+}
+
+void SerialArbiter::setMaxWait(double seconds)
+{
+    // Also catches NaN
+    if (!(seconds > 0.0))
+    {
+        seconds = 0.0;
+    }
+    else if (seconds < MIN_MAX_WAIT)
+    {
+        seconds = MIN_MAX_WAIT;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    maxWait = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+void SerialArbiter::acquire(SerialPriority priority)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    const Waiter waiter(nextTicket++, std::chrono::steady_clock::now());
+    queues[priority].push_back(waiter);
+
+    if (!isBusy)
+    {
+        handOver(waiter.enqueued);
+    }
+
+    // The next owner is chosen once on release, a waiter does not need to
+    // wake up to age
+    while (owner != waiter.ticket)
+    {
+        released.wait(lock);
+    }
+}
+
+void SerialArbiter::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isBusy = false;
+        handOver(std::chrono::steady_clock::now());
+    }
+    released.notify_all();
+}
+
+void SerialArbiter::takeStats(SerialWaitStats out[SERIAL_PRIORITY_CLASSES])
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    memcpy(out, stats, sizeof(stats));
+    memset(stats, 0, sizeof(stats));
+}
+
+int SerialArbiter::nextClass(std::chrono::steady_clock::time_point now, bool& isPromoted) const
+{
+    isPromoted = false;
+    if (!queues[SERIAL_PRIORITY_ACTUATION].empty())
+    {
+        return SERIAL_PRIORITY_ACTUATION;
+    }
+
+    // The oldest control or telemetry waiter past maxWait, if any
+    int oldest = -1;
+    const bool isAging = (maxWait > std::chrono::steady_clock::duration::zero());
+    for (int c = SERIAL_PRIORITY_CONTROL; isAging && (c < SERIAL_PRIORITY_CLASSES); c++)
+    {
+        if (!queues[c].empty() && (now - queues[c].front().enqueued >= maxWait) &&
+            ((oldest < 0) || (queues[c].front().ticket < queues[oldest].front().ticket)))
+        {
+            oldest = c;
+        }
+    }
+
+    for (int c = SERIAL_PRIORITY_CONTROL; c < SERIAL_PRIORITY_CLASSES; c++)
+    {
+        if (!queues[c].empty())
+        {
+            isPromoted = (oldest > c);
+            return isPromoted ? oldest : c;
+        }
+    }
+    return -1;
+}
+
+void SerialArbiter::handOver(std::chrono::steady_clock::time_point now)
+{
+    bool isPromoted = false;
+    const int next = nextClass(now, isPromoted);
+    if (next < 0)
+    {
+        owner = NO_OWNER;
+        return;
+    }
+
+    const Waiter waiter = queues[next].front();
+    queues[next].pop_front();
+    owner = waiter.ticket;
+    isBusy = true;
+
+    const double wait = std::chrono::duration<double>(now - waiter.enqueued).count();
+    SerialWaitStats& classStats = stats[next];
+    classStats.count++;
+    classStats.promoted += isPromoted ? 1 : 0;
+    classStats.totalWait += wait;
+    classStats.maxWait = (wait > classStats.maxWait) ? wait : classStats.maxWait;
+}
+
+SerialArbiterLock::SerialArbiterLock(SerialArbiter& owner, SerialPriority priority)
+    : arbiter(owner)
+{
+    arbiter.acquire(priority);
+}
+
+SerialArbiterLock::~SerialArbiterLock()
+{
+    arbiter.release();
+}
+
+}
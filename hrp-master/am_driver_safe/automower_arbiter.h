@@ -0,0 +1,108 @@
+/*
+ * automower_arbiter.h
+ *
+ *  Priority ordered access to the serial link of the Automower HRP
+ *  interface. Threads that want to exchange a command queue up in one of
+ *  a few classes, the link is handed to the highest class first. A control
+ *  or telemetry waiter that has waited longer than the configured limit is
+ *  served before the other of these classes, so telemetry is delayed but
+ *  never starved. Actuation always goes first.
+ */
+
+#ifndef AUTOMOWER_ARBITER_H
+#define AUTOMOWER_ARBITER_H
+
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace Husqvarna
+{
+
+enum SerialPriority
+{
+    SERIAL_PRIORITY_ACTUATION = 0,  // wheel power, power off, blade brake
+    SERIAL_PRIORITY_CONTROL = 1,    // mode changes, settings, safety status
+    SERIAL_PRIORITY_TELEMETRY = 2,  // polled sensor data
+    SERIAL_PRIORITY_CLASSES = 3
+};
+
+// Queue wait statistics of one class
+typedef struct
+{
+    uint64_t count;
+    uint64_t promoted;          // served before higher classes because of their wait
+    double totalWait;           // seconds
+    double maxWait;             // seconds
+} SerialWaitStats;
+
+// Class of a TIF command ("Family.Command(...)"), by family and command
+SerialPriority serialPriority(const char* command);
+
+class SerialArbiter
+{
+public:
+    SerialArbiter();
+
+    // Waiters older than this (seconds) go first, whatever their class but
+    // actuation. Raised to at least 1 ms, zero or less serves strictly by
+    // class. Ages are compared when the link is released.
+    void setMaxWait(double seconds);
+
+    // Blocks until the calling thread owns the link
+    void acquire(SerialPriority priority);
+    void release();
+
+    // Copies the statistics gathered since the last call and clears them
+    void takeStats(SerialWaitStats stats[SERIAL_PRIORITY_CLASSES]);
+
+private:
+    SerialArbiter(const SerialArbiter&);
+    SerialArbiter& operator=(const SerialArbiter&);
+
+    struct Waiter
+    {
+        Waiter(uint64_t waiterTicket, std::chrono::steady_clock::time_point waiterEnqueued)
+            : ticket(waiterTicket)
+            , enqueued(waiterEnqueued)
+        {
+        }
+
+        uint64_t ticket;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    int nextClass(std::chrono::steady_clock::time_point now, bool& isPromoted) const;
+    // Gives the free link to the next waiter, with the mutex held
+    void handOver(std::chrono::steady_clock::time_point now);
+
+    std::mutex mutex;
+    std::condition_variable released;
+    std::deque<Waiter> queues[SERIAL_PRIORITY_CLASSES];
+    SerialWaitStats stats[SERIAL_PRIORITY_CLASSES];
+    std::chrono::steady_clock::duration maxWait;   // zero if waiters do not age
+    uint64_t nextTicket;
+    uint64_t owner;             // ticket of the waiter the link was handed to
+    bool isBusy;
+};
+
+// Owns the link for the lifetime of the object
+class SerialArbiterLock
+{
+public:
+    SerialArbiterLock(SerialArbiter& arbiter, SerialPriority priority);
+    ~SerialArbiterLock();
+
+private:
+    SerialArbiterLock(const SerialArbiterLock&);
+    SerialArbiterLock& operator=(const SerialArbiterLock&);
+
+    SerialArbiter& arbiter;
+};
+
+}
+
+#endif
@@ -0,0 +1,332 @@
+/*
+ * automower_capture.cpp
+ *
+ *  Binary capture of the bytes exchanged with the Automower HRP interface.
+ */
+
+#include "am_driver_safe/automower_capture.h"
+#include "am_driver_safe/automower_internal.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace Husqvarna
+{
+
+namespace
+{
+
+const uint32_t PCAP_MAGIC_NS = 0xa1b23c4d;
+const uint16_t PCAP_VERSION_MAJOR = 2;
+const uint16_t PCAP_VERSION_MINOR = 4;
+const uint32_t PCAP_SNAPLEN = 0xffff;
+const uint32_t LINKTYPE_USER0 = 147;
+
+// How often the writer looks for new frames when the ring was empty
+const int WRITER_PERIOD_MS = 20;
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t versionMajor;
+    uint16_t versionMinor;
+    int32_t thisZone;
+    uint32_t sigFigs;
+    uint32_t snapLen;
+    uint32_t linkType;
+} PcapFileHeader;
+
+typedef struct
+{
+    uint32_t seconds;
+    uint32_t nanoseconds;
+    uint32_t capturedLength;
+    uint32_t originalLength;
+} PcapRecordHeader;
+
+// Prefix of every frame in the ring
+typedef struct
+{
+    uint64_t timestamp;
+    uint32_t length;
+    uint32_t direction;
+} RingHeader;
+
+std::string fileName(const std::string& prefix, int index)
+{
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "-%04d.pcap", index);
+    return prefix + suffix;
+}
+
+}
+
+WireCapture::WireCapture()
+    : ringMask(0)
+    , head(0)
+    , tail(0)
+    , captured(0)
+    , dropped(0)
+    , running(false)
+    , maxFileBytes(0)
+    , maxFiles(0)
+    , fileIndex(0)
+    , file(NULL)
+    , fileBytes(0)
+{
+}
+
+WireCapture::~WireCapture()
+{
+    stop();
+}
+
+bool WireCapture::start(const std::string& pathPrefix, size_t maxBytes, int files, size_t ringBytes)
+{
+    stop();
+
+    size_t size = 4096;
+    while (size < ringBytes)
+    {
+        size <<= 1;
+    }
+    ring.assign(size, 0);
+    ringMask = size - 1;
+    head = 0;
+    tail = 0;
+    captured = 0;
+    dropped = 0;
+
+    prefix = pathPrefix;
+    maxFileBytes = maxBytes;
+    maxFiles = files;
+    fileIndex = 0;
+    if (!openFile())
+    {
+        return false;
+    }
+
+    running = true;
+    writer = std::thread(&WireCapture::run, this);
+    return true;
+}
+
+void WireCapture::stop()
+{
+    if (running.exchange(false))
+    {
+        writer.join();
+    }
+    if (file != NULL)
+    {
+        drain();
+        fclose(file);
+        file = NULL;
+    }
+}
+
+bool WireCapture::isActive() const
+{
+    return running;
+}
+
+void WireCapture::record(CaptureDirection direction, const uint8_t* data, size_t length)
+{
+    if (!running || (length == 0))
+    {
+        return;
+    }
+
+    RingHeader header;
+    header.timestamp = monotonicNow();
+    header.length = (uint32_t)length;
+    header.direction = (uint32_t)direction;
+
+    const uint64_t position = head.load(std::memory_order_relaxed);
+    const uint64_t used = position - tail.load(std::memory_order_acquire);
+    if (used + sizeof(header) + length > ring.size())
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    copyIn(position, &header, sizeof(header));
+    copyIn(position + sizeof(header), data, length);
+    head.store(position + sizeof(header) + length, std::memory_order_release);
+    captured.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t WireCapture::capturedFrames() const
+{
+    return captured.load(std::memory_order_relaxed);
+}
+
+uint64_t WireCapture::droppedFrames() const
+{
+    return dropped.load(std::memory_order_relaxed);
+}
+
+void WireCapture::run()
+{
+    while (running)
+    {
+        if (!drain())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_PERIOD_MS));
+        }
+    }
+}
+
+bool WireCapture::drain()
+{
+    uint64_t position = tail.load(std::memory_order_relaxed);
+    const uint64_t end = head.load(std::memory_order_acquire);
+    if (position == end)
+    {
+        return false;
+    }
+
+    while (position < end)
+    {
+        RingHeader header;
+        copyOut(position, &header, sizeof(header));
+        frameBuffer.resize(header.length + 1);
+        frameBuffer[0] = (uint8_t)header.direction;
+        copyOut(position + sizeof(header), &frameBuffer[1], header.length);
+        position += sizeof(header) + header.length;
+
+        if (file != NULL)
+        {
+            PcapRecordHeader record;
+            record.seconds = (uint32_t)(header.timestamp / 1000000000ULL);
+            record.nanoseconds = (uint32_t)(header.timestamp % 1000000000ULL);
+            record.capturedLength = (uint32_t)frameBuffer.size();
+            record.originalLength = record.capturedLength;
+            fwrite(&record, sizeof(record), 1, file);
+            fwrite(&frameBuffer[0], frameBuffer.size(), 1, file);
+            fileBytes += sizeof(record) + frameBuffer.size();
+
+            if ((maxFileBytes > 0) && (fileBytes >= maxFileBytes))
+            {
+                fclose(file);
+                file = NULL;
+                fileIndex++;
+                openFile();
+            }
+        }
+    }
+    tail.store(position, std::memory_order_release);
+
+    // Flushed per batch, not per frame, so a crash loses at most one period
+    if (file != NULL)
+    {
+        fflush(file);
+    }
+    return true;
+}
+
+bool WireCapture::openFile()
+{
+    file = fopen(fileName(prefix, fileIndex).c_str(), "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    if ((maxFiles > 0) && (fileIndex >= maxFiles))
+    {
+        remove(fileName(prefix, fileIndex - maxFiles).c_str());
+    }
+
+    PcapFileHeader header;
+    header.magic = PCAP_MAGIC_NS;
+    header.versionMajor = PCAP_VERSION_MAJOR;
+    header.versionMinor = PCAP_VERSION_MINOR;
+    header.thisZone = 0;
+    header.sigFigs = 0;
+    header.snapLen = PCAP_SNAPLEN;
+    header.linkType = LINKTYPE_USER0;
+    fwrite(&header, sizeof(header), 1, file);
+    fileBytes = sizeof(header);
+    return true;
+}
+
+void WireCapture::copyIn(uint64_t position, const void* source, size_t length)
+{
+    const size_t offset = (size_t)(position & ringMask);
+    const size_t first = std::min(length, ring.size() - offset);
+    memcpy(&ring[offset], source, first);
+    memcpy(&ring[0], (const uint8_t*)source + first, length - first);
+}
+
+void WireCapture::copyOut(uint64_t position, void* destination, size_t length) const
+{
+    const size_t offset = (size_t)(position & ringMask);
+    const size_t first = std::min(length, ring.size() - offset);
+    memcpy(destination, &ring[offset], first);
+    memcpy((uint8_t*)destination + first, &ring[0], length - first);
+}
+
+CaptureReader::CaptureReader()
+    : file(NULL)
+{
+}
+
+CaptureReader::~CaptureReader()
+{
+    close();
+}
+
+bool CaptureReader::open(const std::string& path)
+{
+    close();
+    file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    PcapFileHeader header;
+    if ((fread(&header, sizeof(header), 1, file) != 1) ||
+        (header.magic != PCAP_MAGIC_NS) || (header.linkType != LINKTYPE_USER0))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void CaptureReader::close()
+{
+    if (file != NULL)
+    {
+        fclose(file);
+        file = NULL;
+    }
+}
+
+bool CaptureReader::next(CaptureFrame& frame)
+{
+    PcapRecordHeader record;
+    if ((file == NULL) || (fread(&record, sizeof(record), 1, file) != 1) ||
+        (record.capturedLength < 1) || (record.capturedLength > PCAP_SNAPLEN))
+    {
+        return false;
+    }
+
+    frame.timestamp = (uint64_t)record.seconds * 1000000000ULL + record.nanoseconds;
+    frame.data.resize(record.capturedLength);
+    if (fread(&frame.data[0], record.capturedLength, 1, file) != 1)
+    {
+        return false;
+    }
+    frame.direction = (frame.data[0] == CAPTURE_TX) ? CAPTURE_TX : CAPTURE_RX;
+    frame.data.erase(frame.data.begin());
+    return true;
+}
+
+}
@@ -0,0 +1,114 @@
+/*
+ * automower_capture.h
+ *
+ *  Binary capture of the bytes exchanged with the Automower HRP interface.
+ *  The serial thread copies each write and read into a lock-free ring, a
+ *  background thread writes them to rotating pcap files.
+ *
+ *  File format: pcap with nanosecond timestamps (magic 0xa1b23c4d) and link
+ *  type LINKTYPE_USER0. Timestamps are CLOCK_MONOTONIC, the first byte of
+ *  every packet is the direction (CAPTURE_TX or CAPTURE_RX) followed by the
+ *  bytes as they were written to or read from the serial port.
+ */
+
+#ifndef AUTOMOWER_CAPTURE_H
+#define AUTOMOWER_CAPTURE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Husqvarna
+{
+
+enum CaptureDirection
+{
+    CAPTURE_TX = 0,     // host to mower
+    CAPTURE_RX = 1      // mower to host
+};
+
+typedef struct
+{
+    uint64_t timestamp;         // CLOCK_MONOTONIC in ns
+    CaptureDirection direction;
+    std::vector<uint8_t> data;
+} CaptureFrame;
+
+class WireCapture
+{
+public:
+    WireCapture();
+    ~WireCapture();
+
+    // Opens <pathPrefix>-0000.pcap and starts the writer thread. A new file
+    // is started once a file exceeds maxFileBytes, only the newest maxFiles
+    // are kept (0 keeps all). ringBytes is rounded up to a power of two.
+    bool start(const std::string& pathPrefix, size_t maxFileBytes, int maxFiles, size_t ringBytes);
+
+    // Writes what is left in the ring and closes the file
+    void stop();
+
+    bool isActive() const;
+
+    // Never blocks, the frame is dropped if the ring is full. Only one
+    // thread may record at a time, i.e. the one owning the serial link.
+    void record(CaptureDirection direction, const uint8_t* data, size_t length);
+
+    uint64_t capturedFrames() const;
+    uint64_t droppedFrames() const;
+
+private:
+    WireCapture(const WireCapture&);
+    WireCapture& operator=(const WireCapture&);
+
+    void run();
+    bool drain();
+    bool openFile();
+    void copyIn(uint64_t position, const void* source, size_t length);
+    void copyOut(uint64_t position, void* destination, size_t length) const;
+
+    std::vector<uint8_t> ring;
+    uint64_t ringMask;
+    std::atomic<uint64_t> head;     // written by record()
+    std::atomic<uint64_t> tail;     // written by the writer thread
+    std::atomic<uint64_t> captured;
+    std::atomic<uint64_t> dropped;
+    std::atomic<bool> running;
+    std::thread writer;
+
+    std::string prefix;
+    size_t maxFileBytes;
+    int maxFiles;
+    int fileIndex;
+    FILE* file;
+    size_t fileBytes;
+    std::vector<uint8_t> frameBuffer;
+};
+
+// Sequential reader for files written by WireCapture
+class CaptureReader
+{
+public:
+    CaptureReader();
+    ~CaptureReader();
+
+    bool open(const std::string& path);
+    void close();
+
+    // Returns false at the end of the file or if it is truncated
+    bool next(CaptureFrame& frame);
+
+private:
+    CaptureReader(const CaptureReader&);
+    CaptureReader& operator=(const CaptureReader&);
+
+    FILE* file;
+};
+
+}
+
+#endif
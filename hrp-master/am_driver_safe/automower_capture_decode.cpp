@@ -0,0 +1,278 @@
+/*
+ * automower_capture_decode.cpp
+ *
+ *  Offline decoder for serial captures written by the driver (serialLog).
+ *  Prints every frame with its time since the start of the capture, TX
+ *  frames as hex and RX frames decoded through the HCP model.
+ *
+ *  The AMG3 codec decodes a response as the command last encoded on the
+ *  session, so every TX frame is matched to a command of the model by its
+ *  message type and sub-command and that command is encoded again before
+ *  the following RX frames are decoded.
+ *
+ *  Usage: automower_capture_decode <automower_hrp.json> <capture.pcap>...
+ */
+
+#include "am_driver_safe/automower_capture.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    #include "hcp/hcp_types.h"
+    #include "hcp/hcp_runtime.h"
+    #include "hcp/hcp_string.h"
+    #include "hcp/hcp_library.h"
+
+    #include "hcp/amg3.h"
+    #include "hcp/cJSON.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+using namespace Husqvarna;
+
+static void* _malloc(hcp_Size_t size, void* ctx) {
+    return malloc(size);
+}
+
+static void _free(void* dest, void* ctx) {
+    free(dest);
+}
+
+static void* _memcpy(void* dest, const void* source, hcp_Size_t size, void*  ctx) {
+    return memcpy(dest, source, size);
+}
+
+static void* _memset(void* dest, hcp_Int value, hcp_Size_t len, void*  ctx) {
+    return memset(dest, value, len);
+}
+
+static std::string toString(const hcp_tString& str)
+{
+    return (str.value != NULL) ? std::string(str.value, str.length) : std::string();
+}
+
+static std::string hexString(const uint8_t* data, size_t length)
+{
+    std::ostringstream out;
+    out << std::hex << std::setfill('0');
+    for (size_t i = 0; i < length; i++)
+    {
+        out << std::setw(2) << (int)data[i] << " ";
+    }
+    return out.str();
+}
+
+// Message type and sub-command of an AMG3 request: STX, the extended
+// header (0x81, two bytes length, transaction id) for message types above
+// 0x7F, one or two bytes message type, length, sub-command
+static std::string requestKey(const uint8_t* frame, size_t length)
+{
+    const size_t typeIndex = ((length > 1) && (frame[1] == 0x81)) ? 5 : 1;
+    const size_t lengthIndex = ((length > typeIndex) && (frame[typeIndex] > 0x7F)) ? typeIndex + 2 : typeIndex + 1;
+    if ((length < lengthIndex + 2) || (frame[0] != 0x02))
+    {
+        return std::string();
+    }
+    std::string key((const char*)&frame[typeIndex], lengthIndex - typeIndex);
+    key += (char)frame[lengthIndex + 1];
+    return key;
+}
+
+// TIF strings for all methods of the model with zero arguments, by request key
+static std::map<std::string, std::string> loadRequests(const std::string& model, hcp_tCodec* session)
+{
+    std::map<std::string, std::string> requests;
+    cJSON* root = cJSON_Parse(model.c_str());
+    cJSON* methods = (root != NULL) ? cJSON_GetObjectItem(root, "methods") : NULL;
+    for (int i = 0; (methods != NULL) && (i < cJSON_GetArraySize(methods)); i++)
+    {
+        cJSON* method = cJSON_GetArrayItem(methods, i);
+        cJSON* family = cJSON_GetObjectItem(method, "family");
+        cJSON* command = cJSON_GetObjectItem(method, "command");
+        cJSON* inParams = cJSON_GetObjectItem(method, "inParams");
+        if ((family == NULL) || (command == NULL))
+        {
+            continue;
+        }
+
+        std::string tif = std::string(family->valuestring) + "." + command->valuestring + "(";
+        for (int p = 0; (inParams != NULL) && (p < cJSON_GetArraySize(inParams)); p++)
+        {
+            cJSON* name = cJSON_GetObjectItem(cJSON_GetArrayItem(inParams, p), "name");
+            tif += std::string(p > 0 ? "," : "") + ((name != NULL) ? name->valuestring : "") + ":0";
+        }
+        tif += ")";
+
+        hcp_Uint8 buf[255];
+        hcp_Int numBytes = hcp_EncodeSession(session, (hcp_szStr)tif.c_str(), buf, sizeof(buf));
+        if (numBytes > 0)
+        {
+            requests[requestKey(buf, numBytes)] = tif;
+        }
+    }
+    cJSON_Delete(root);
+    return requests;
+}
+
+static std::string parameterToString(const hcp_tParameter& parameter)
+{
+    std::ostringstream out;
+    out << toString(parameter.template_->name) << "=";
+    switch (parameter.template_->type)
+    {
+    case HCP_FLOAT_ID:          out << parameter.value.f; break;
+    case HCP_DOUBLE_ID:         out << parameter.value.d; break;
+    case HCP_BOOLEAN_ID:        out << (int)parameter.value.b; break;
+    case HCP_SIZET_ID:          out << parameter.value.sz; break;
+    case HCP_UINT8_ID:          out << (int)parameter.value.u8; break;
+    case HCP_INT8_ID:           out << (int)parameter.value.s8; break;
+    case HCP_SIMPLEVERSION_ID:
+    case HCP_UINT16_ID:         out << parameter.value.u16; break;
+    case HCP_INT16_ID:          out << parameter.value.i16; break;
+    case HCP_UNIXTIME_ID:
+    case HCP_UINT32_ID:         out << parameter.value.u32; break;
+    case HCP_INT32_ID:          out << parameter.value.i32; break;
+    case HCP_UINT64_ID:         out << parameter.value.u64; break;
+    case HCP_INT64_ID:          out << parameter.value.i64; break;
+    case HCP_STRING_ID:         out << "\"" << toString(parameter.value.str) << "\""; break;
+    case HCP_BLOB_ID:           out << "[" << hexString(parameter.value.blb.value, parameter.value.blb.length) << "]"; break;
+    default:                    out << "?"; break;
+    }
+    return out.str();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <automower_hrp.json> <capture.pcap>..." << std::endl;
+        return 1;
+    }
+
+    std::ifstream jsonFile(argv[1]);
+    std::stringstream model;
+    model << jsonFile.rdbuf();
+    if (model.str().empty())
+    {
+        std::cerr << "Could not read JSON model " << argv[1] << std::endl;
+        return 1;
+    }
+
+    hcp_tHost host;
+    memset(&host, 0, sizeof(host));
+    host.free_ = _free;
+    host.malloc_ = _malloc;
+    host.memcpy_ = _memcpy;
+    host.memset_ = _memset;
+
+    char codecName[] = "amg3";
+    hcp_Int modelId = -1;
+    hcp_tCodec session;
+    hcp_tState* state = (hcp_tState*)host.malloc_(hcp_SizeOfState(), host.context);
+    if ((hcp_NewState(state, &host) != HCP_NOERROR) ||
+        (hcp_LoadCodec(state, hcp_GetLibrary(), codecName, sizeof(codecName)) != HCP_NOERROR) ||
+        (hcp_LoadModel(state, model.str().c_str(), (hcp_Size_t)model.str().size(), &modelId) != HCP_NOERROR) ||
+        (hcp_OpenSession(state, codecName, (hcp_Size_t)modelId, &session) != HCP_NOERROR))
+    {
+        std::cerr << "Could not load the HCP model." << std::endl;
+        return 1;
+    }
+
+    const std::map<std::string, std::string> requests = loadRequests(model.str(), &session);
+
+    hcp_tResultStorage response;
+    uint64_t start = 0;
+    // Responses can only be decoded once the request they answer is known
+    bool hasRequest = false;
+
+    for (int i = 2; i < argc; i++)
+    {
+        CaptureReader reader;
+        if (!reader.open(argv[i]))
+        {
+            std::cerr << "Not a serial capture: " << argv[i] << std::endl;
+            continue;
+        }
+
+        CaptureFrame frame;
+        while (reader.next(frame))
+        {
+            if (start == 0)
+            {
+                start = frame.timestamp;
+            }
+            std::cout << std::fixed << std::setprecision(6) << (double)(frame.timestamp - start) / 1e9;
+
+            if (frame.direction == CAPTURE_TX)
+            {
+                std::cout << " TX " << hexString(&frame.data[0], frame.data.size()) << std::endl;
+
+                // Encoding the request again also drops whatever was received
+                // so far without completing a response
+                std::map<std::string, std::string>::const_iterator request =
+                    requests.find(requestKey(&frame.data[0], frame.data.size()));
+                if (request == requests.end())
+                {
+                    std::cout << "    unknown request" << std::endl;
+                    hasRequest = false;
+                    continue;
+                }
+
+                hcp_Uint8 buf[255];
+                hasRequest = hcp_EncodeSession(&session, (hcp_szStr)request->second.c_str(), buf, sizeof(buf)) > 0;
+                std::cout << "    " << request->second.substr(0, request->second.find('(')) << std::endl;
+                continue;
+            }
+
+            std::cout << " RX " << hexString(&frame.data[0], frame.data.size()) << std::endl;
+
+            size_t offset = 0;
+            while (hasRequest && (offset < frame.data.size()))
+            {
+                hcp_Int numBytes = hcp_DecodeInto(&session, &frame.data[offset], frame.data.size() - offset, &response);
+                const hcp_tResult& result = response.result;
+                if (result.error != HCP_NOERROR)
+                {
+                    std::cout << "    error " << result.error << " (device " << result.deviceError << ")" << std::endl;
+                    hcp_ResetSession(&session);
+                    hasRequest = false;
+                    break;
+                }
+                if (numBytes <= 0)
+                {
+                    break;
+                }
+                offset += numBytes;
+
+                if (result.command.length > 0)
+                {
+                    std::cout << "    " << toString(result.family) << "." << toString(result.command) << "(";
+                    for (hcp_Size_t p = 0; p < result.parameterCount; p++)
+                    {
+                        std::cout << (p > 0 ? ", " : "") << parameterToString(result.parameters[p]);
+                    }
+                    std::cout << ")" << std::endl;
+                }
+            }
+        }
+    }
+
+    hcp_CloseSession(&session);
+    hcp_CloseState(state);
+    host.free_(state, host.context);
+    return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * automower_internal.h
+ *
+ *  Helpers shared by the sources of the Automower HRP driver. Not part of
+ *  the interface of any of them.
+ */
+
+#ifndef AUTOMOWER_INTERNAL_H
+#define AUTOMOWER_INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <atomic>
+
+namespace Husqvarna
+{
+
+// A copy takes well below a microsecond, more retries mean the writer is gone
+const int SEQLOCK_READ_RETRIES = 1000;
+
+// Nanoseconds on CLOCK_MONOTONIC, comparable between processes
+inline uint64_t monotonicNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Copies size bytes from source, written under the odd/even sequence counter,
+// to destination. False if no consistent copy was made within
+// SEQLOCK_READ_RETRIES, else seen is the sequence the copy belongs to.
+inline bool seqlockRead(const std::atomic<uint32_t>& sequence, void* destination, const void* source,
+                        size_t size, uint32_t& seen)
+{
+    for (int i = 0; i < SEQLOCK_READ_RETRIES; i++)
+    {
+        const uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            continue;
+        }
+        memcpy(destination, source, size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before)
+        {
+            seen = before;
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+#endif
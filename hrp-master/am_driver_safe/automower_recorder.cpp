@@ -0,0 +1,303 @@
+/*
+ * automower_recorder.cpp
+ *
+ *  Flight recorder for the Automower HRP driver.
+ */
+
+#include "am_driver_safe/automower_recorder.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace Husqvarna
+{
+
+namespace
+{
+
+const char* const KIND_NAMES[FLIGHT_KINDS] = {"CMD", "RSP", "ERR", "SNS", "REG", "FSM"};
+
+const int FATAL_SIGNALS[] = {SIGSEGV, SIGBUS, SIGFPE, SIGABRT};
+
+FlightRecorder* signalRecorder = NULL;
+char signalPathPrefix[200];
+
+uint64_t clockNow(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Text formatting without stdio, usable from a signal handler
+class LineWriter
+{
+public:
+    explicit LineWriter(int file)
+        : fd(file)
+        , used(0)
+        , isGood(true)
+    {
+    }
+
+    void append(const char* text)
+    {
+        while (*text != '\0')
+        {
+            if (used == sizeof(buffer))
+            {
+                flush();
+            }
+            buffer[used++] = *text++;
+        }
+    }
+
+    void appendUnsigned(uint64_t value, int width)
+    {
+        char digits[24];
+        int count = 0;
+        do
+        {
+            digits[count++] = (char)('0' + value % 10);
+            value /= 10;
+        } while ((value > 0) || (count < width));
+
+        char text[24];
+        for (int i = 0; i < count; i++)
+        {
+            text[i] = digits[count - 1 - i];
+        }
+        text[count] = '\0';
+        append(text);
+    }
+
+    void appendInt(int64_t value)
+    {
+        if (value < 0)
+        {
+            append("-");
+            appendUnsigned((uint64_t)(-(value + 1)) + 1, 1);
+        }
+        else
+        {
+            appendUnsigned((uint64_t)value, 1);
+        }
+    }
+
+    void appendTime(uint64_t ns)
+    {
+        appendUnsigned(ns / 1000000000ULL, 1);
+        append(".");
+        appendUnsigned(ns % 1000000000ULL, 9);
+    }
+
+    bool flush()
+    {
+        size_t offset = 0;
+        while (isGood && (offset < used))
+        {
+            ssize_t written = write(fd, buffer + offset, used - offset);
+            if ((written < 0) && (errno == EINTR))
+            {
+                continue;
+            }
+            isGood = (written > 0);
+            offset += (written > 0) ? (size_t)written : 0;
+        }
+        used = 0;
+        return isGood;
+    }
+
+private:
+    int fd;
+    char buffer[4096];
+    size_t used;
+    bool isGood;
+};
+
+}
+
+FlightRecorder::FlightRecorder()
+    : slots(NULL)
+    , mask(0)
+    , next(0)
+{
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    if (signalRecorder == this)
+    {
+        signalRecorder = NULL;
+    }
+    delete[] slots;
+}
+
+void FlightRecorder::init(size_t capacity)
+{
+    size_t size = 64;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+
+    delete[] slots;
+    slots = new Slot[size];
+    for (size_t i = 0; i < size; i++)
+    {
+        slots[i].sequence.store(0, std::memory_order_relaxed);
+        memset(&slots[i].record, 0, sizeof(slots[i].record));
+    }
+    mask = size - 1;
+    next.store(0, std::memory_order_release);
+}
+
+bool FlightRecorder::isActive() const
+{
+    return slots != NULL;
+}
+
+void FlightRecorder::record(FlightRecordKind kind, const char* text,
+                            int32_t v0, int32_t v1, int32_t v2, int32_t v3)
+{
+    if (slots == NULL)
+    {
+        return;
+    }
+
+    const uint64_t sequence = next.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots[sequence & mask];
+
+    // Readers skip the slot until the record is complete
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    FlightRecord& record = slot.record;
+    record.timestamp = clockNow(CLOCK_MONOTONIC);
+    record.kind = (uint32_t)kind;
+    record.values[0] = v0;
+    record.values[1] = v1;
+    record.values[2] = v2;
+    record.values[3] = v3;
+
+    const size_t length = (text != NULL) ? strnlen(text, sizeof(record.text) - 1) : 0;
+    if (length > 0)
+    {
+        memcpy(record.text, text, length);
+    }
+    record.text[length] = '\0';
+
+    slot.sequence.store(sequence + 1, std::memory_order_release);
+}
+
+bool FlightRecorder::dump(const char* path) const
+{
+    if (slots == NULL)
+    {
+        return false;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    LineWriter out(fd);
+    out.append("# realtime ");
+    out.appendTime(clockNow(CLOCK_REALTIME));
+    out.append(" monotonic ");
+    out.appendTime(clockNow(CLOCK_MONOTONIC));
+    out.append("\n");
+
+    const uint64_t end = next.load(std::memory_order_acquire);
+    const uint64_t begin = (end > mask + 1) ? end - (mask + 1) : 0;
+    for (uint64_t sequence = begin; sequence < end; sequence++)
+    {
+        const Slot& slot = slots[sequence & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != sequence + 1)
+        {
+            continue;
+        }
+        FlightRecord record;
+        memcpy(&record, &slot.record, sizeof(record));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence + 1)
+        {
+            continue;
+        }
+        record.text[sizeof(record.text) - 1] = '\0';
+
+        out.appendTime(record.timestamp);
+        out.append(" ");
+        out.append((record.kind < FLIGHT_KINDS) ? KIND_NAMES[record.kind] : "???");
+        out.append(" ");
+        out.append(record.text);
+        for (int i = 0; i < 4; i++)
+        {
+            out.append(" ");
+            out.appendInt(record.values[i]);
+        }
+        out.append("\n");
+    }
+
+    const bool isWritten = out.flush();
+    close(fd);
+    return isWritten;
+}
+
+void FlightRecorder::installSignalHandlers(FlightRecorder* recorder, const char* pathPrefix)
+{
+    signalRecorder = recorder;
+    strncpy(signalPathPrefix, pathPrefix, sizeof(signalPathPrefix) - 1);
+    signalPathPrefix[sizeof(signalPathPrefix) - 1] = '\0';
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &FlightRecorder::onSignal;
+    sigemptyset(&action.sa_mask);
+    for (size_t i = 0; i < sizeof(FATAL_SIGNALS) / sizeof(FATAL_SIGNALS[0]); i++)
+    {
+        sigaction(FATAL_SIGNALS[i], &action, NULL);
+    }
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, NULL);
+}
+
+void FlightRecorder::onSignal(int signal)
+{
+    char path[256];
+    size_t length = 0;
+    const char* parts[] = {signalPathPrefix, "-signal-", NULL};
+    for (int p = 0; parts[p] != NULL; p++)
+    {
+        for (const char* c = parts[p]; (*c != '\0') && (length < sizeof(path) - 8); c++)
+        {
+            path[length++] = *c;
+        }
+    }
+    if (signal >= 10)
+    {
+        path[length++] = (char)('0' + signal / 10);
+    }
+    path[length++] = (char)('0' + signal % 10);
+    memcpy(&path[length], ".log", 5);
+
+    if (signalRecorder != NULL)
+    {
+        signalRecorder->dump(path);
+    }
+
+    // Let the fatal signal do what it would have done
+    if (signal != SIGUSR1)
+    {
+        ::signal(signal, SIG_DFL);
+        raise(signal);
+    }
+}
+
+}
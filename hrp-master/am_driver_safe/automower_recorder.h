@@ -0,0 +1,93 @@
+/*
+ * automower_recorder.h
+ *
+ *  Flight recorder for the Automower HRP driver. Keeps the latest records
+ *  of commands, responses, sensor values, regulator outputs and state
+ *  transitions in a fixed ring in memory. Recording is lock-free and costs
+ *  a clock read and a copy into the ring, the ring is only written to disk
+ *  when something went wrong.
+ *
+ *  Dump format: one text line per record, oldest first,
+ *    <CLOCK_MONOTONIC s.ns> <kind> <text> <v0> <v1> <v2> <v3>
+ *  preceded by a line giving CLOCK_REALTIME and CLOCK_MONOTONIC at the time
+ *  of the dump.
+ */
+
+#ifndef AUTOMOWER_RECORDER_H
+#define AUTOMOWER_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+namespace Husqvarna
+{
+
+enum FlightRecordKind
+{
+    FLIGHT_COMMAND = 0,     // text: command sent, v0: bytes, v1: priority class
+    FLIGHT_RESPONSE,        // text: command answered, v0: error, v1: device error, v2: bytes, v3: rtt us
+    FLIGHT_ERROR,           // text: what failed, v0..v3 depend on the failure
+    FLIGHT_SENSOR,          // text: signal, v0..v3 as decoded from the mower
+    FLIGHT_REGULATOR,       // text: regulator, v0..v3 outputs and inputs
+    FLIGHT_TRANSITION,      // text: state machine, v0: old state, v1: new state
+    FLIGHT_KINDS
+};
+
+#define FLIGHT_RECORD_TEXT_SIZE (88)
+
+typedef struct
+{
+    uint64_t timestamp;         // CLOCK_MONOTONIC in ns
+    uint32_t kind;
+    int32_t values[4];
+    char text[FLIGHT_RECORD_TEXT_SIZE];
+} FlightRecord;
+
+class FlightRecorder
+{
+public:
+    FlightRecorder();
+    ~FlightRecorder();
+
+    // Allocates the ring, capacity is rounded up to a power of two. Must be
+    // called before anything is recorded.
+    void init(size_t capacity);
+
+    bool isActive() const;
+
+    // Lock-free and safe from any thread, the text is truncated to fit
+    void record(FlightRecordKind kind, const char* text,
+                int32_t v0 = 0, int32_t v1 = 0, int32_t v2 = 0, int32_t v3 = 0);
+
+    // Writes the ring, oldest record first. Only uses async-signal-safe
+    // calls, records written while dumping may be left out.
+    bool dump(const char* path) const;
+
+    // Dumps to <pathPrefix>-signal-<number>.log on SIGSEGV, SIGBUS, SIGFPE
+    // and SIGABRT before the default action, and on SIGUSR1. One recorder
+    // per process.
+    static void installSignalHandlers(FlightRecorder* recorder, const char* pathPrefix);
+
+private:
+    FlightRecorder(const FlightRecorder&);
+    FlightRecorder& operator=(const FlightRecorder&);
+
+    typedef struct
+    {
+        // 0 while written, else the record's sequence number + 1
+        std::atomic<uint64_t> sequence;
+        FlightRecord record;
+    } Slot;
+
+    static void onSignal(int signal);
+
+    Slot* slots;
+    uint64_t mask;
+    std::atomic<uint64_t> next;
+};
+
+}
+
+#endif
@@ -11,7 +11,10 @@
 #include <math.h>
 #include <termios.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <string.h>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
@@ -73,6 +76,93 @@
 
 #define RADIANS_PER_DEGREE (3.14159/180.0)
 
+// Room for about 20 s of serial traffic at 50 Hz if the disk stalls
+#define SERIAL_CAPTURE_RING_SIZE (1024 * 1024)
+
+// How often the response cache reports the serial traffic it saved (seconds)
+#define RESPONSE_CACHE_REPORT_PERIOD (60.0)
+
+// Pitch or roll (degrees) from which the sensor status reports HVA_SS_TOO_STEEP
+#define TOO_STEEP_ANGLE (25.0)
+
+// Adaptive polling: share of the configured rate for signals the current
+// mode does not need, and the wheel speed (m/s) counted as moving
+#define POLL_SCALE_SLOW (0.25)
+#define POLL_MOTION_THRESHOLD (0.01)
+
+// Serial exchanges per call of each getter
+#define POLL_EXCHANGES_ENCODER (2)
+#define POLL_EXCHANGES_STATUS (4)
+#define POLL_EXCHANGES_STATUS_DETAIL (2)
+#define POLL_EXCHANGES_LOOP (3)
+
+// Serial budget: exchanges timed per command at startup, and the burst
+// (seconds of polling share) the token bucket can save up
+#define SERIAL_BUDGET_SAMPLES (3)
+#define SERIAL_BUDGET_BURST (0.1)
+#define SERIAL_BUDGET_REPORT_PERIOD (60.0)
+// Link share left to the other getters when the reserved commands take it all
+#define SERIAL_BUDGET_MIN_SHARE (0.05)
+
+// How often the queue wait per command class is reported (seconds)
+#define SERIAL_QUEUE_REPORT_PERIOD (60.0)
+
+// Flight recorder dumps closer than this (seconds) show the same records
+#define FLIGHT_DUMP_MIN_INTERVAL (5.0)
+
+// Process start to first wheel command the startup is checked against (seconds)
+#define STARTUP_TARGET (0.3)
+
+// Time a primary that is taken over gets to exit, after SIGABRT and again
+// after SIGKILL (seconds)
+#define TAKEOVER_EXIT_WAIT (0.5)
+
+// Commands sent by each polled getter, timed for the serial budget
+static const char* const BUDGET_WHEEL_COMMANDS[] = {"RealTimeData.GetWheelMotorData()", NULL};
+static const char* const BUDGET_ENCODER_COMMANDS[] = {"Wheels.GetRotationCounter(index:1)",
+                                                      "Wheels.GetRotationCounter(index:0)", NULL};
+static const char* const BUDGET_REGULATOR_COMMANDS[] = {"HardwareControl.WheelMotorsPower(leftWheelMotorPower:0, rightWheelMotorPower:0)", NULL};
+static const char* const BUDGET_STATE_COMMANDS[] = {"MowerApp.GetState()", "CurrentStatus.GetStatusKeepAlive()", NULL};
+static const char* const BUDGET_LOOP_COMMANDS[] = {"LoopSampler.GetLoopSignalMaster(loop:0)",
+                                                   "LoopSampler.GetLoopSignalMaster(loop:1)",
+                                                   "LoopSampler.GetLoopSignalMaster(loop:2)", NULL};
+static const char* const BUDGET_PITCHROLL_COMMANDS[] = {"RealTimeData.GetSensorData()", NULL};
+static const char* const BUDGET_BATTERY_COMMANDS[] = {"RealTimeData.GetBatteryData()", NULL};
+static const char* const BUDGET_GPS_COMMANDS[] = {"RealTimeData.GetGPSData()", NULL};
+static const char* const BUDGET_STATUS_COMMANDS[] = {"SystemSettings.GetLoopDetection()",
+                                                     "SafetySupervisor.GetStatus()",
+                                                     "RealTimeData.GetSensorData()",
+                                                     "Charger.IsChargingPowerConnected()",
+                                                     "CurrentStatus.GetStatusKeepAlive()", NULL};
+
+// Waits for the process to exit. A zombie has exited, its parent has yet to reap it.
+static bool waitForExit(pid_t pid, double timeout)
+{
+    char statPath[64];
+    snprintf(statPath, sizeof(statPath), "/proc/%d/stat", (int)pid);
+
+    const ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(timeout);
+    while (kill(pid, 0) == 0)
+    {
+        std::ifstream stat(statPath);
+        std::string line;
+        if (std::getline(stat, line))
+        {
+            const size_t end = line.rfind(')');
+            if ((end != std::string::npos) && (line.compare(end, 3, ") Z") == 0))
+            {
+                return true;
+            }
+        }
+
+        if (ros::WallTime::now() >= deadline)
+        {
+            return false;
+        }
+        ros::WallDuration(0.001).sleep();
+    }
+    return errno == ESRCH;
+}
 
 
 namespace Husqvarna
@@ -139,6 +229,16 @@ AutomowerSafe::AutomowerSafe(const ros::NodeHandle& nodeh, decision_making::RosE
     n_private.param("serialPort", pSerialPort, defPort);
     ROS_INFO("Param: serialPort: [%s]", pSerialPort.c_str());
 
+    std::string tmp;
+    //nh.param("jsonFile", tmp, (std::string) "./config/31.7_P2_Main_App-Certified_master_build_285-Debug.json");
+    n_private.param("jsonFile", tmp, (std::string) "./config/31.7_Main-App-P2_master_build-542_Debug.json");
+    jsonFile = tmp;
+
+    // Loads while the rest of the driver, ROS and the serial port are set up
+    isModelLoaded = false;
+    isModelValid = false;
+    modelLoader = std::thread(&AutomowerSafe::loadModel, this);
+
     n_private.param("updateRate", updateRate, 1000.0);
     ROS_INFO("Param: updateRate: [%f]", updateRate);
 
@@ -159,6 +259,83 @@ AutomowerSafe::AutomowerSafe(const ros::NodeHandle& nodeh, decision_making::RosE
     n_private.param("serialLog",serialLog , false);
     ROS_INFO("Param: serialLog: [%d]", serialLog);
 
+    // Written by a background thread, see automower_capture_decode for reading them back
+    n_private.param("serialLogPath", serialLogPath, std::string("/tmp/am_driver_safe_serial"));
+    ROS_INFO("Param: serialLogPath: [%s]", serialLogPath.c_str());
+
+    n_private.param("serialLogFileSize", serialLogFileSize, 64);
+    ROS_INFO("Param: serialLogFileSize: [%d] MB", serialLogFileSize);
+
+    n_private.param("serialLogFiles", serialLogFiles, 8);
+    ROS_INFO("Param: serialLogFiles: [%d]", serialLogFiles);
+
+    if (serialLog)
+    {
+        if (serialCapture.start(serialLogPath, (size_t)serialLogFileSize * 1024 * 1024, serialLogFiles, SERIAL_CAPTURE_RING_SIZE))
+        {
+            ROS_INFO("Automower::Capturing serial traffic to %s-*.pcap", serialLogPath.c_str());
+        }
+        else
+        {
+            ROS_ERROR("Automower::Could not open serial capture %s", serialLogPath.c_str());
+        }
+    }
+
+    // Always on, only written to disk when something goes wrong
+    n_private.param("flightRecorder", flightRecorder, true);
+    ROS_INFO("Param: flightRecorder: [%d]", flightRecorder);
+
+    n_private.param("flightRecorderSize", flightRecorderSize, 16384);
+    ROS_INFO("Param: flightRecorderSize: [%d] records", flightRecorderSize);
+
+    n_private.param("flightRecorderPath", flightRecorderPath, std::string("/tmp/am_driver_safe_flight"));
+    ROS_INFO("Param: flightRecorderPath: [%s]", flightRecorderPath.c_str());
+
+    flightDumpCount = 0;
+    lastFlightDumpTime = 0.0;
+    lastUserStopPressed = false;
+    if (flightRecorder)
+    {
+        recorder.init(flightRecorderSize);
+        FlightRecorder::installSignalHandlers(&recorder, flightRecorderPath.c_str());
+    }
+
+    // Empty disables the shared memory snapshot
+    n_private.param("sensorSnapshot", sensorSnapshotName, std::string(""));
+    ROS_INFO("Param: sensorSnapshot: [%s]", sensorSnapshotName.c_str());
+
+    // Opened by the primary only, see openSensorSnapshot()
+    memset(&sensorSnapshot, 0, sizeof(sensorSnapshot));
+
+    serialConfig = defaultSerialConfig();
+    n_private.param("baudRate", serialConfig.baudRate, serialConfig.baudRate);
+    ROS_INFO("Param: baudRate: [%d]", serialConfig.baudRate);
+
+    n_private.param("hardwareFlowControl", serialConfig.hardwareFlowControl, serialConfig.hardwareFlowControl);
+    ROS_INFO("Param: hardwareFlowControl: [%d]", serialConfig.hardwareFlowControl);
+
+    n_private.param("lowLatency", serialConfig.lowLatency, serialConfig.lowLatency);
+    ROS_INFO("Param: lowLatency: [%d]", serialConfig.lowLatency);
+
+    n_private.param("usbLatencyTimer", serialConfig.usbLatencyTimer, serialConfig.usbLatencyTimer);
+    ROS_INFO("Param: usbLatencyTimer: [%d]", serialConfig.usbLatencyTimer);
+
+    n_private.param("serialBenchmarkSamples", serialBenchmarkSamples, 10);
+    ROS_INFO("Param: serialBenchmarkSamples: [%d]", serialBenchmarkSamples);
+
+    n_private.param("responseTimeout", responseTimeout, 0.1);
+    ROS_INFO("Param: responseTimeout: [%f]", responseTimeout);
+
+    // Optional per command deadlines, e.g. {"MowerApp.SetMode": 0.5}
+    n_private.getParam("commandTimeouts", commandTimeouts);
+    for (std::map<std::string, double>::const_iterator it = commandTimeouts.begin(); it != commandTimeouts.end(); ++it)
+    {
+        ROS_INFO("Param: commandTimeouts: [%s: %f]", it->first.c_str(), it->second);
+    }
+
+    n_private.param("maxConsecutiveTimeouts", maxConsecutiveTimeouts, 3);
+    ROS_INFO("Param: maxConsecutiveTimeouts: [%d]", maxConsecutiveTimeouts);
+
     n_private.param("pitchAndRoll", m_PitchAndRollFromAccelerometer, false);
     ROS_INFO("Param: pitchAndRoll: [%d]", m_PitchAndRollFromAccelerometer);
 
@@ -192,6 +369,57 @@ AutomowerSafe::AutomowerSafe(const ros::NodeHandle& nodeh, decision_making::RosE
     n_private.param("stateCheckFreq", stateCheckFreq, 1.0);
     ROS_INFO("Param: stateCheckFreq: [%f]", stateCheckFreq);
 
+    n_private.param("adaptivePolling", adaptivePolling, false);
+    ROS_INFO("Param: adaptivePolling: [%d]", adaptivePolling);
+
+    n_private.param("regulatorMaxFreq", regulatorMaxFreq, regulatorFreq);
+    ROS_INFO("Param: regulatorMaxFreq: [%f]", regulatorMaxFreq);
+
+    n_private.param("serialBudget", serialBudget, false);
+    ROS_INFO("Param: serialBudget: [%d]", serialBudget);
+
+    n_private.param("serialBudgetShare", serialBudgetShare, 0.8);
+    ROS_INFO("Param: serialBudgetShare: [%f]", serialBudgetShare);
+
+    n_private.param("serialBudgetScale", serialBudgetScale, true);
+    ROS_INFO("Param: serialBudgetScale: [%d]", serialBudgetScale);
+
+    n_private.param("serialMaxQueueWait", serialMaxQueueWait, 0.1);
+    ROS_INFO("Param: serialMaxQueueWait: [%f]", serialMaxQueueWait);
+    serialArbiter.setMaxWait(serialMaxQueueWait);
+    serialQueueReportTime = ros::WallTime::now().toSec();
+
+    // Empty disables the state mirror, and with it the standby
+    n_private.param("stateMirror", stateMirrorName, std::string(""));
+    ROS_INFO("Param: stateMirror: [%s]", stateMirrorName.c_str());
+
+    n_private.param("standby", standby, false);
+    ROS_INFO("Param: standby: [%d]", standby);
+
+    // A healthy primary may stall for as long as it waits before it gives
+    // up on the link itself
+    double longestTimeout = responseTimeout;
+    for (std::map<std::string, double>::const_iterator it = commandTimeouts.begin(); it != commandTimeouts.end(); ++it)
+    {
+        longestTimeout = std::max(longestTimeout, it->second);
+    }
+    const double minStandbyTimeout = longestTimeout * std::max(maxConsecutiveTimeouts, 1);
+    n_private.param("standbyTimeout", standbyTimeout, minStandbyTimeout);
+    ROS_INFO("Param: standbyTimeout: [%f]", standbyTimeout);
+    if (standbyTimeout < minStandbyTimeout)
+    {
+        ROS_WARN("Automower::standbyTimeout below %.3f s, the standby may take over from a working primary",
+                 minStandbyTimeout);
+    }
+
+    memset(&mirroredState, 0, sizeof(mirroredState));
+    isMirrorLive = false;
+    if (standby && stateMirrorName.empty())
+    {
+        ROS_ERROR("Automower::standby needs stateMirror, running as primary");
+        standby = false;
+    }
+
     n_private.param("publishEuler", publishEuler, true);
     ROS_INFO("Param: publishEuler: [%d]", publishEuler);
 
@@ -267,16 +495,21 @@ AutomowerSafe::AutomowerSafe(const ros::NodeHandle& nodeh, decision_making::RosE
     collisionState = 0;
 
     serialPortState = AM_SP_STATE_OFFLINE;
+    serialFd = -1;
+    serialBenchmarkDone = false;
+    serialCalibrationStep = 0;
+    isStartupReported = false;
+
+    consecutiveTimeouts = 0;
+    awaitingLateResponse = false;
+    responseTimeoutCount = 0;
+    lateResponseCount = 0;
+    discardedBytes = 0;
 
     lastComtestWheelMotorPower = 3;
 
     actionResponse = 0;
 
-    std::string tmp;
-    //nh.param("jsonFile", tmp, (std::string) "./config/31.7_P2_Main_App-Certified_master_build_285-Debug.json");
-    n_private.param("jsonFile", tmp, (std::string) "./config/31.7_Main-App-P2_master_build-542_Debug.json");
-    jsonFile = tmp;
-
     timeSinceWheelSensor = ros::Duration(0.0);
     timeSinceEncoderSensor = ros::Duration(0.005);
     timeSinceRegulator = ros::Duration(0.010);
@@ -293,8 +526,77 @@ AutomowerSafe::AutomowerSafe(const ros::NodeHandle& nodeh, decision_making::RosE
     startTime = ros::WallTime::now().toSec();
     lastRateCheckTime = ros::WallTime::now().toSec();
 
+    responseCacheTick = 1;
+    responseCacheHits = 0;
+    responseCacheSavedBytes = 0;
+    responseCacheReportTime = ros::WallTime::now().toSec();
+
+    pollingMoving = false;
+    tunedRegulatorFreq = regulatorFreq;
+    nextStatusDetailTime = ros::Time::now();
+
+    memset(&pollingCosts, 0, sizeof(pollingCosts));
+    budgetRate = 0.0;
+    budgetCapacity = 0.0;
+    budgetTokens = 0.0;
+    budgetRefillTime = ros::WallTime::now();
+    budgetDeferred = 0;
+    budgetReportTime = ros::WallTime::now().toSec();
+
     userStop = true; // Assume stopped...
 
+    m_regulatingActive = false;
+    regulateBySpeed = true;
+
+    adaptPollingRates();
+}
+
+AutomowerSafe::~AutomowerSafe()
+{
+    if (modelLoader.joinable())
+    {
+        modelLoader.join();
+    }
+
+    // The sessions release their commands through the state, close them first
+    {
+        std::lock_guard<std::mutex> lock(hcpSessionMutex);
+        for (std::map<std::thread::id, hcp_tCodec*>::iterator it = hcpSessions.begin(); it != hcpSessions.end(); ++it)
+        {
+            hcp_CloseSession(it->second);
+            delete it->second;
+        }
+        hcpSessions.clear();
+    }
+    if (isModelValid)
+    {
+        hcp_CloseState(hcpState);
+    }
+    hcpHost.free_(hcpState, hcpHost.context);
+
+    if (serialCapture.isActive())
+    {
+        serialCapture.stop();
+        ROS_INFO("Automower::Serial capture: %lu frames, %lu dropped",
+                 (unsigned long)serialCapture.capturedFrames(), (unsigned long)serialCapture.droppedFrames());
+    }
+
+    if (!standby)
+    {
+        stateMirror.release();
+    }
+
+    if (serialFd >= 0)
+    {
+        close(serialFd);
+    }
+}
+
+
+void AutomowerSafe::loadModel()
+{
+    StartupScope scope("model");
+
     // Init the HCP library
     memset(&hcpHost, 0, sizeof(hcp_tHost));
     memset(&hcpCodecs, 0, sizeof(tCodecSet));
@@ -327,7 +629,7 @@ AutomowerSafe::AutomowerSafe(const ros::NodeHandle& nodeh, decision_making::RosE
 
     // Load the AMG3 codec
     hcp_tCodecLibrary* lib = hcp_GetLibrary();
-    char codecName[5] = "amg3";
+    strcpy(codecName, "amg3");
     error = hcp_LoadCodec(hcpState, lib, codecName, 5);
 
     if (error != HCP_NOERROR)
@@ -343,36 +645,37 @@ AutomowerSafe::AutomowerSafe(const ros::NodeHandle& nodeh, decision_making::RosE
         ROS_ERROR("Could not Load JSON model.");
     }
 
-    // Create a codec instance
-    error = hcp_NewCodec(hcpState, codecName, (hcp_Size_t)modelId, &codecId);
-    if (error != HCP_NOERROR)
     {
-        hcp_CloseState(hcpState);
-        ROS_ERROR("Could not create new Codec instance.");
+        std::lock_guard<std::mutex> lock(modelMutex);
+        isModelValid = (error == HCP_NOERROR);
+        isModelLoaded = true;
     }
+    modelCondition.notify_all();
 
-    m_regulatingActive = false;
-    regulateBySpeed = true;
-
-    ROS_INFO("AutomowerSafe::Loaded HCP/TIF codec...let's go!");
+    if (isModelValid)
+    {
+        ROS_INFO("AutomowerSafe::Loaded HCP/TIF codec...let's go!");
+    }
 }
 
-AutomowerSafe::~AutomowerSafe()
+bool AutomowerSafe::waitForModel()
 {
-    if (serialFd >= 0)
+    std::unique_lock<std::mutex> lock(modelMutex);
+    while (!isModelLoaded)
     {
-        close(serialFd);
+        modelCondition.wait(lock);
     }
+    return isModelValid;
 }
 
-
 bool AutomowerSafe::executeTifCommand(am_driver_safe::TifCmd::Request& req,
                                       am_driver_safe::TifCmd::Response& res)
 {
-    hcp_tResult result;
+    hcp_tResultStorage response;
+    const hcp_tResult& result = response.result;
     const char* msg = req.str.c_str();
     ROS_INFO("executeTifCommand %s...", msg);
-    if (!sendMessage(msg, sizeof(msg), result))
+    if (!sendMessage(msg, sizeof(msg), response))
     {
         return false;
     }
@@ -387,43 +690,77 @@ bool AutomowerSafe::executeTifCommand(am_driver_safe::TifCmd::Request& req,
 
 std::string AutomowerSafe::loadJsonModel(std::string fileName)
 {
-    std::string line;
-    std::ifstream file(fileName.c_str());
+    std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
     std::cout << "Loading from:" << fileName << "..." << std::endl;
 
-    std::string str;
-    std::string fileContents;
     if (file.is_open())
     {
-        while (std::getline(file, str))
-        {
-            fileContents += str;
-            fileContents.push_back('\n');
-        }
-        return fileContents;
+        // In one read, the model is a few MB
+        std::ostringstream fileContents;
+        fileContents << file.rdbuf();
+        return fileContents.str();
     }
     else
     {
         ROS_ERROR("Could not load JSON file!!!");
-        return str;
+        return std::string();
     }
 }
 
 
 bool AutomowerSafe::setup()
 {
-    struct termios term;
+    if (!stateMirrorName.empty())
+    {
+        if (!stateMirror.open(stateMirrorName))
+        {
+            ROS_ERROR("Automower::Could not map shared memory %s", stateMirrorName.c_str());
+            if (standby)
+            {
+                return false;
+            }
+        }
+        else if (!standby && stateMirror.read(mirroredState) && (stateMirror.heartbeat() != 0) &&
+                 (mirroredState.primaryPid != getpid()) && (kill(mirroredState.primaryPid, 0) == 0))
+        {
+            // E.g. a respawned primary while the former standby drives the mower
+            ROS_WARN("Automower::Driver %d is primary, standing by", mirroredState.primaryPid);
+            standby = true;
+        }
+    }
+
+    if (standby)
+    {
+        ROS_INFO("Automower::Standby, watching the primary through %s", stateMirrorName.c_str());
+        return true;
+    }
+
+    openSensorSnapshot();
+    return connectSerial();
+}
+
+void AutomowerSafe::openSensorSnapshot()
+{
+    if (sensorSnapshotName.empty() || snapshotPublisher.isOpen())
+    {
+        return;
+    }
+
+    if (snapshotPublisher.open(sensorSnapshotName))
+    {
+        ROS_INFO("Automower::Publishing sensor snapshots to shared memory %s", sensorSnapshotName.c_str());
+    }
+    else
+    {
+        ROS_ERROR("Automower::Could not create shared memory %s", sensorSnapshotName.c_str());
+    }
+}
 
-    // Open serial port
+bool AutomowerSafe::connectSerial()
+{
+    StartupScope scope("serial open");
 
-    serialFd = open(pSerialPort.c_str(), O_RDWR /* | O_NONBLOCK */);
-    close(serialFd);
-    serialFd = open(pSerialPort.c_str(), O_RDWR /* | O_NONBLOCK */);
-    //    serial_struct serinfo;
-    //    //Enable low latency communication
-    //    ioctl(serialFd, TIOCGSERIAL, &serinfo);
-    //    serinfo.flags |= ASYNC_LOW_LATENCY;
-    //    ioctl(serialFd, TIOCSSERIAL, &serinfo);
+    serialFd = openSerialPort(pSerialPort, serialConfig);
     if (serialFd < 0)
     {
         if (errno == ENOENT)
@@ -434,6 +771,10 @@ bool AutomowerSafe::setup()
         {
             ROS_ERROR("Automower::Serial port already open ");
         }
+        else if (errno == EINVAL)
+        {
+            ROS_ERROR("Automower::Serial port setup failed, unsupported baudRate %d?", serialConfig.baudRate);
+        }
         else
         {
             ROS_ERROR("Automower::Serial port open failed. Errorcode %d ", errno);
@@ -442,73 +783,69 @@ bool AutomowerSafe::setup()
         return false;
     }
 
-    memset(&term, 0, sizeof(term));
-
-    /* man termios get more info on below settings */
-    /* CS8 - character size mask
-     * CLOCAL - ignore modem control lines
-     * CREAD - enable receiver
-     */
-    term.c_cflag = B115200 | CS8 | CLOCAL | CREAD; /* control modes */
-    term.c_iflag = 0;                              /* input mode */
-    term.c_oflag = 0;                              /* output modes */
-    term.c_lflag = 0;                              /* local modes */
-
-    tcflush(serialFd, TCIFLUSH);
-    term.c_cflag |= (CLOCAL | CREAD);
-
-    /*
-    VMIN specifies the minimum number of bytes to read before read() returns.
-    VTIME is the time to wait (in tenths of a second) before returning from
-    read (). VMIN and VTIME are used only when the ICANON flag is clear in
-    the c_lflag parameter. In the previous example, you probably noticed
-    that c_cc[VMIN] and c_cc[VTIME] were set to 1 to enable non-blocking
-    reads. Many programmers are confused by VMIN and VTIME, but the rules are
-    reasonably simple; four possible combinations of VMIN and VTIME are
-    possible, as follows (from POSIX.1, 7.1.1.7):
-
-    VMIN > 0 and VTIME > 0
-            TIME is an interbyte timer that is activated after the first byte
-            is received and is reset after each received byte. If the timer
-            expires, at least one byte has been received because the timer
-            is not activated until after a byte has been received.
-    VMIN > 0 and VTIME = 0
-            There is no timer, so read() returns when MIN bytes have been
-            received or when a signal is received.
-    VMIN = 0 and VTIME > 0
-            Because MIN is 0, TIME is a read () operation timer that is
-            activated as soon as read() is called. The read() operation
-            returns as soon as a byte is received or when the timer expires.
-    VMIN = 0 and VTIME = 0
-            The read() operation returns immediately with the data that is
-            in the input buffer. If the input buffer is empty, read()
-            returns immediately with zero bytes of data.
-    */
-
-    cfsetospeed(&term, (speed_t)B115200);
-    cfsetispeed(&term, (speed_t)B115200);
-
-    term.c_cflag |= (CLOCAL | CREAD);    /* ignore modem controls */
-    term.c_cflag &= ~CSIZE;
-    term.c_cflag |= CS8;         /* 8-bit characters */
-    term.c_cflag &= ~PARENB;     /* no parity bit */
-    term.c_cflag &= ~CSTOPB;     /* only need 1 stop bit */
-    term.c_cflag &= ~CRTSCTS;    /* no hardware flowcontrol */
-
-    /* setup for non-canonical mode */
-    term.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON);
-    term.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
-    term.c_oflag &= ~OPOST;
-
-    /* fetch bytes as they become available */
-    term.c_cc[VMIN] = 1;
-    term.c_cc[VTIME] = 0;
-    tcsetattr(serialFd, TCSANOW, &term);
+    if (serialConfig.usbLatencyTimer > 0)
+    {
+        if (setUsbLatencyTimer(pSerialPort, serialConfig.usbLatencyTimer))
+        {
+            ROS_INFO("Automower::USB latency timer set to %d ms", serialConfig.usbLatencyTimer);
+        }
+        else
+        {
+            int current = getUsbLatencyTimer(pSerialPort);
+            if (current >= 0)
+            {
+                ROS_WARN("Automower::Could not set USB latency timer, still %d ms (permissions?)", current);
+            }
+        }
+    }
 
     ROS_INFO("Serial setup complete");
 
     return true;
 }
+
+void AutomowerSafe::benchmarkSerialLink()
+{
+    if (serialBenchmarkSamples <= 0)
+    {
+        return;
+    }
+
+    hcp_tResultStorage response;
+    const hcp_tResult& result = response.result;
+    const char* msg = "DeviceInformation.GetDeviceIdentification()";
+
+    double minRtt = 1e9;
+    double maxRtt = 0.0;
+    double sumRtt = 0.0;
+    int samples = 0;
+
+    for (int i = 0; i < serialBenchmarkSamples; i++)
+    {
+        ros::WallTime start = ros::WallTime::now();
+        if (!sendMessage(msg, sizeof(msg), response))
+        {
+            break;
+        }
+        double rtt = (ros::WallTime::now() - start).toSec();
+
+        minRtt = std::min(minRtt, rtt);
+        maxRtt = std::max(maxRtt, rtt);
+        sumRtt += rtt;
+        samples++;
+    }
+
+    if (samples == 0)
+    {
+        ROS_WARN("Automower::Serial benchmark failed, no responses");
+        return;
+    }
+
+    double meanRtt = sumRtt / samples;
+    ROS_INFO("Automower::Serial benchmark @ %d baud: rtt min %.2f ms, mean %.2f ms, max %.2f ms over %d commands => ~%.0f commands/s",
+             serialConfig.baudRate, minRtt * 1000.0, meanRtt * 1000.0, maxRtt * 1000.0, samples, 1.0 / meanRtt);
+}
+
 void AutomowerSafe::imuResetCallback(const geometry_msgs::Pose::ConstPtr& msg)
 {
 
@@ -552,6 +889,12 @@ void AutomowerSafe::powerCallback(const am_driver::WheelPower::ConstPtr& power)
 
 void AutomowerSafe::modeCallback(const std_msgs::UInt16::ConstPtr& msg)
 {
+    if (standby)
+    {
+        // The primary handles it, its modes are taken over from the mirror
+        return;
+    }
+
     if (msg->data < 0x90)
     {
         // Not for us...
@@ -656,26 +999,61 @@ void AutomowerSafe::modeCallback(const std_msgs::UInt16::ConstPtr& msg)
     }
 }
 
-bool AutomowerSafe::sendMessage(const char* msg, int len, hcp_tResult& result)
+hcp_tCodec* AutomowerSafe::getHcpSession()
 {
+    const std::thread::id thread = std::this_thread::get_id();
+    {
+        std::lock_guard<std::mutex> lock(hcpSessionMutex);
+        std::map<std::thread::id, hcp_tCodec*>::iterator it = hcpSessions.find(thread);
+        if (it != hcpSessions.end())
+        {
+            return it->second;
+        }
+    }
 
-    // std::cout << msg << std::endl;
-    static boost::mutex mtx_serial;
+    if (!waitForModel())
+    {
+        return NULL;
+    }
 
-    mtx_serial.lock();
+    hcp_tCodec* session = new hcp_tCodec;
+    if (hcp_OpenSession(hcpState, codecName, (hcp_Size_t)modelId, session) != HCP_NOERROR)
+    {
+        ROS_ERROR("Could not create new Codec instance.");
+        delete session;
+        return NULL;
+    }
 
-    double endSendTime;
+    std::lock_guard<std::mutex> lock(hcpSessionMutex);
+    hcpSessions[thread] = session;
+    return session;
+}
 
-    if ((serialPortState == AM_SP_STATE_OFFLINE) || (serialPortState == AM_SP_STATE_ERROR))
+bool AutomowerSafe::sendMessage(const char* msg, int len, hcp_tResultStorage& response, int* wireBytes)
+{
+
+    // std::cout << msg << std::endl;
+    hcp_tCodec* session = getHcpSession();
+    if (session == NULL)
     {
-        mtx_serial.unlock();
         return false;
     }
 
     hcp_Uint8 buf[255];
     hcp_Int numBytes = 0;
 
-    numBytes = hcp_Encode(hcpState, codecId, (hcp_szStr)msg, buf, 255);
+    numBytes = hcp_EncodeSession(session, (hcp_szStr)msg, buf, 255);
+    const int numBytesSent = numBytes;
+
+    // Only the exchange on the serial link needs to be exclusive, encoding
+    // and decoding use the session of the calling thread. Wheel power and
+    // stop commands are served before queued telemetry.
+    SerialArbiterLock lock(serialArbiter, serialPriority(msg));
+
+    if ((serialPortState == AM_SP_STATE_OFFLINE) || (serialPortState == AM_SP_STATE_ERROR))
+    {
+        return false;
+    }
 
     if (numBytes <0)
     {
@@ -689,134 +1067,316 @@ bool AutomowerSafe::sendMessage(const char* msg, int len, hcp_tResult& result)
             ROS_ERROR("JSON encoding failed with error %d for command %s ", numBytes, msg);
         }
 
+        recorder.record(FLIGHT_ERROR, msg, numBytes);
         serialPortState = AM_SP_STATE_ERROR;
         return false;
     }
 
-    if (serialLog) {
-        std::cout << "SEND: " << std::hex;
-        for (int i=0; i<numBytes; i++)
-        {
-            std::cout << std::hex << (int)buf[i] << " ";
-        }
-        std::cout << std::dec;
-    }
+    // Whatever is waiting in the input queue now belongs to an earlier command
+    discardLateResponses();
 
     int cnt = 0;
     cnt = write(serialFd, buf, numBytes);
+    if (cnt > 0)
+    {
+        serialCapture.record(CAPTURE_TX, buf, cnt);
+    }
+
+    recorder.record(FLIGHT_COMMAND, msg, cnt, serialPriority(msg));
 
     if (cnt != numBytes)
     {
         ROS_ERROR("Automower::Could not send on serial port!");
+        recorder.record(FLIGHT_ERROR, "write", cnt, errno);
         serialPortState = AM_SP_STATE_ERROR;
         return false;
     }
-    endSendTime = ros::WallTime::now().toSec()-startTime;
+    const double timeout = getCommandTimeout(msg);
+    const ros::WallTime sentTime = ros::WallTime::now();
+    const ros::WallTime deadline = sentTime + ros::WallDuration(timeout);
+
+    // hcp_DecodeInto resets the result header on every call, the parameters
+    // are only written once the response is complete
+    const hcp_tResult& result = response.result;
+    bool isComplete = false;
 
-    numBytes = 0; // to be assigned after read again
     cnt = 0;
-    int res;
-    int payloadLength = 0;
+    while (!isComplete)
+    {
+        int res = readSerial(buf, sizeof(buf), deadline);
+
+        if (res > 0)
+        {
+            serialCapture.record(CAPTURE_RX, buf, res);
+        }
+
+        if (res == 0)
+        {
+            handleResponseTimeout(session, msg, timeout);
+            return false;
+        }
+
+        if ((res < 0) || ((cnt == 0) && (buf[0] == 0)))
+        {
+            if (res > 0)
+            {
+                ROS_WARN("Automower::Error receiving...rebooting??");
+            }
+            else
+            {
+                ROS_WARN("Automower::Failed to get response...sleeping?");
+            }
+
+            recorder.record(FLIGHT_ERROR, "receive", res, (res > 0) ? buf[0] : errno);
+            serialPortState = AM_SP_STATE_ERROR;
+            return false;
+        }
+
+        int offset = 0;
+        while ((offset < res) && !isComplete)
+        {
+            numBytes = hcp_DecodeInto(session, &buf[offset], res - offset, &response);
+            isComplete = (result.command.length != 0) || (result.error != HCP_NOERROR);
+            if (numBytes <= 0)
+            {
+                break;
+            }
+            offset += numBytes;
+        }
+        cnt += res;
+
+        // Bytes following a complete response were not asked for
+        if (offset < res)
+        {
+            discardedBytes += res - offset;
+        }
+    }
+
+    consecutiveTimeouts = 0;
+
+    // The link works, a standby has no reason to take over
+    stateMirror.beat();
+
+    recorder.record(FLIGHT_RESPONSE, msg, result.error, result.deviceError, cnt,
+                    (int32_t)((ros::WallTime::now() - sentTime).toSec() * 1e6));
+
+    if (result.error != HCP_NOERROR)
+    {
+        ROS_WARN("Automower::Error receiving...not logged in?");
+        return false;
+    }
+
 
-    // Clear answer buffer (only using one byte...but reused from above)
-    memset(buf, 0, 255);
 
-    memset(&result, 0, sizeof(result));
+    //std::cout << "SAFE::result.parameterCount= " << result.parameterCount << std::endl;
 
-    // Read one byte
-    res = read(serialFd, &buf[0], 1);
+    if (wireBytes != NULL)
+    {
+        *wireBytes = numBytesSent + cnt;
+    }
+
+    return true;
+}
 
-    //    double responseTime = ros::WallTime::now().toSec() - startTime - endSendTime;
-    double responseTime = 0;
+bool AutomowerSafe::queryMessage(const char* msg, hcp_tResult& result)
+{
+    // A new entry starts at tick 0 and is never current
+    CachedResponse& cached = responseCache[msg];
+    if (cached.tick == responseCacheTick)
+    {
+        responseCacheHits++;
+        responseCacheSavedBytes += cached.wireBytes;
+        result = cached.response.result;
+        return true;
+    }
 
+    cached.tick = 0;
+    if (!sendMessage(msg, strlen(msg), cached.response, &cached.wireBytes))
+    {
+        return false;
+    }
+    cached.tick = responseCacheTick;
 
+    // The parameters point into the cache entry, which is not written again
+    // before the next tick
+    result = cached.response.result;
+    return true;
+}
 
-    if (res > 0 && buf[0] > 0)
+void AutomowerSafe::dumpFlightRecorder(const char* reason)
+{
+    const double now = ros::WallTime::now().toSec();
+    if (!recorder.isActive() || (now - lastFlightDumpTime < FLIGHT_DUMP_MIN_INTERVAL))
     {
-        if (serialLog) { std::cout << endSendTime << "\t" << responseTime << "\t READ:  " << std::hex << (int)buf[0] << " " << std::flush; }
+        return;
+    }
+    lastFlightDumpTime = now;
 
-        cnt++;
-        numBytes = hcp_Decode(hcpState, codecId, buf, 1, &result);
+    char path[300];
+    snprintf(path, sizeof(path), "%s-%s-%04d.log", flightRecorderPath.c_str(), reason, flightDumpCount++);
+    if (recorder.dump(path))
+    {
+        ROS_WARN("Automower::Flight recorder written to %s", path);
     }
     else
     {
-        if ((res == 1) && (buf[0]==0))
-        {
-            ROS_WARN("Automower::Error receiving...rebooting??");
-        }
-        else
+        ROS_ERROR("Automower::Could not write flight recorder to %s", path);
+    }
+}
+
+void AutomowerSafe::reportSerialQueue()
+{
+    const double now = ros::WallTime::now().toSec();
+    if (now - serialQueueReportTime < SERIAL_QUEUE_REPORT_PERIOD)
+    {
+        return;
+    }
+    serialQueueReportTime = now;
+
+    static const char* const classNames[SERIAL_PRIORITY_CLASSES] = {"actuation", "control", "telemetry"};
+    SerialWaitStats stats[SERIAL_PRIORITY_CLASSES];
+    serialArbiter.takeStats(stats);
+    for (int c = 0; c < SERIAL_PRIORITY_CLASSES; c++)
+    {
+        if (stats[c].count == 0)
         {
-            ROS_WARN("Automower::Failed to get response...sleeping?");
+            continue;
         }
-
-        if (serialLog) {std::cout << "\n first read byte is zero => FAILED!  res = " << res << "  buf[0]= " << int(buf[0]) << " errno =" << errno  << "respTime " << responseTime  <<std::endl;}
-        serialPortState = AM_SP_STATE_ERROR;
-        mtx_serial.unlock();
-        return false;
+        ROS_INFO("Automower::Serial queue %s: %lu commands, wait mean %.2f ms, max %.2f ms, %lu promoted",
+                 classNames[c], (unsigned long)stats[c].count, stats[c].totalWait / stats[c].count * 1000.0,
+                 stats[c].maxWait * 1000.0, (unsigned long)stats[c].promoted);
     }
+}
 
-    // TODO: Give up?
-    while (((res > 0) && (result.command.length == 0)) || (result.error != HCP_NOERROR))
+void AutomowerSafe::reportResponseCache()
+{
+    const double now = ros::WallTime::now().toSec();
+    const double elapsed = now - responseCacheReportTime;
+    if (elapsed < RESPONSE_CACHE_REPORT_PERIOD)
     {
-        res = read(serialFd, &buf[0], 1);
+        return;
+    }
+
+    ROS_INFO("Automower::Response cache: %lu commands served from cache, %.1f bytes/s serial traffic saved",
+             responseCacheHits, responseCacheSavedBytes / elapsed);
+
+    responseCacheHits = 0;
+    responseCacheSavedBytes = 0;
+    responseCacheReportTime = now;
+}
+
+int AutomowerSafe::readSerial(hcp_Uint8* buf, int maxLen, const ros::WallTime& deadline)
+{
+    struct pollfd pfd;
+    pfd.fd = serialFd;
+    pfd.events = POLLIN;
 
+    while (true)
+    {
+        int res = read(serialFd, buf, maxLen);
         if (res > 0)
         {
-            cnt++;
-            numBytes = hcp_Decode(hcpState, codecId, buf, 1, &result);
-            if (serialLog) { std::cout << std::hex << (int)buf[0] << " " << std::flush; }
+            return res;
         }
-        else
+        if ((res < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
         {
-            if ((res == 1) && (buf[0]==0))
-            {
-                ROS_WARN("Automower::Error receiving ...... Automower rebooting??");
-            }
-            else
-            {
-                ROS_WARN("Automower::Failed to get response......sleeping?");
-            }
+            return -1;
+        }
+
+        double remaining = (deadline - ros::WallTime::now()).toSec();
+        if (remaining <= 0.0)
+        {
+            return 0;
+        }
+
+        pfd.revents = 0;
+        res = poll(&pfd, 1, (int)ceil(remaining * 1000.0));
+        if ((res < 0) && (errno != EINTR))
+        {
+            return -1;
+        }
+        if ((res > 0) && (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)))
+        {
+            return -1;
+        }
+    }
+}
+
+void AutomowerSafe::discardLateResponses()
+{
+    hcp_Uint8 buf[255];
+    int total = 0;
+    int res;
 
-            if (serialLog) {std::cout << "first read byte is zero => FAILED!  res = " << res << "  buf[0]= " << int(buf[0]) << " errno =" << errno  << "respTime " << responseTime  <<std::endl;}
-            serialPortState = AM_SP_STATE_ERROR;
-            return false;
-        }
+    while ((res = read(serialFd, buf, sizeof(buf))) > 0)
+    {
+        serialCapture.record(CAPTURE_RX, buf, res);
+        total += res;
     }
 
-    if (serialLog) {  std::cout << std::dec << std::endl; }
-
-    if (res <= 0)
+    if (total == 0)
     {
-        ROS_WARN("Automower::Failed to get response...sleeping?");
-        serialPortState = AM_SP_STATE_ERROR;
+        return;
+    }
 
-        mtx_serial.unlock();
-        return false;
+    discardedBytes += total;
+    if (awaitingLateResponse)
+    {
+        lateResponseCount++;
+        awaitingLateResponse = false;
+        DEBUG_LOG("Automower::Discarded late response (" << total << " bytes)");
     }
+}
 
-    if (result.error != HCP_NOERROR)
+double AutomowerSafe::getCommandTimeout(const char* msg) const
+{
+    if (!commandTimeouts.empty())
     {
-        ROS_WARN("Automower::Error receiving...not logged in?");
-        mtx_serial.unlock();
-        return false;
+        const char* paren = strchr(msg, '(');
+        std::string command = (paren != NULL) ? std::string(msg, paren - msg) : std::string(msg);
+
+        std::map<std::string, double>::const_iterator it = commandTimeouts.find(command);
+        if (it != commandTimeouts.end())
+        {
+            return it->second;
+        }
     }
 
+    return responseTimeout;
+}
 
+void AutomowerSafe::handleResponseTimeout(hcp_tCodec* session, const char* msg, double timeout)
+{
+    responseTimeoutCount++;
+    consecutiveTimeouts++;
 
-    //std::cout << "SAFE::result.parameterCount= " << result.parameterCount << std::endl;
+    // Abandon the partial frame, a late answer is thrown away before the next command
+    hcp_ResetSession(session);
+    tcflush(serialFd, TCIFLUSH);
+    awaitingLateResponse = true;
 
-    mtx_serial.unlock();
-    return true;
+    ROS_WARN("Automower::No response to %s within %.0f ms (timeouts: %lu, late responses: %lu, discarded bytes: %lu)",
+             msg, timeout * 1000.0, responseTimeoutCount, lateResponseCount, discardedBytes);
+    recorder.record(FLIGHT_ERROR, msg, consecutiveTimeouts, (int32_t)(timeout * 1000.0));
+
+    if (consecutiveTimeouts >= maxConsecutiveTimeouts)
+    {
+        ROS_WARN("Automower::Failed to get response...sleeping?");
+        consecutiveTimeouts = 0;
+        serialPortState = AM_SP_STATE_ERROR;
+    }
 }
 
 bool AutomowerSafe::initAutomowerBoard()
 {
+    StartupScope scope("board init");
     ROS_INFO("Automower::initAutomowerBoard");
 
 
-    hcp_tResult result;
+    hcp_tResultStorage response;
+    const hcp_tResult& result = response.result;
     const char* msg = "DeviceInformation.GetDeviceIdentification()";
-    if (!sendMessage(msg, sizeof(msg), result))
+    if (!sendMessage(msg, sizeof(msg), response))
     {
         ROS_WARN("Failed to initAutomowerBoard");
         return false;
@@ -878,13 +1438,14 @@ bool AutomowerSafe::initAutomowerBoard()
 
     leftWheelPid.Init(50.0, 10.0*x, 1.0/x);
     rightWheelPid.Init(50.0, 10.0*x, 1.0/x);
+    tunedRegulatorFreq = regulatorFreq;
 
     lastComtestWheelMotorPower = 15;
 
     char msg1[100];
     snprintf(msg1, sizeof(msg1), "MowerApp.SetMode(modeOfOperation:%d)",IMOWERAPP_MODE_AUTO);
 
-    if (!sendMessage(msg1, sizeof(msg1), result))
+    if (!sendMessage(msg1, sizeof(msg1), response))
     {
         ROS_ERROR("Automower::Failed setting Auto Mode.");
         cuttingDiscOn = lastCuttingDiscOn;
@@ -912,7 +1473,7 @@ bool AutomowerSafe::getEncoderData()
     // Get the Rotation Counter
     //
     const char* leftCounterMsg = "Wheels.GetRotationCounter(index:1)";
-    if (!sendMessage(leftCounterMsg, sizeof(leftCounterMsg), result))
+    if (!queryMessage(leftCounterMsg, result))
     {
         return false;
 
@@ -926,7 +1487,7 @@ bool AutomowerSafe::getEncoderData()
 
 
     const char* rightCounterMsg = "Wheels.GetRotationCounter(index:0)";
-    if (!sendMessage(rightCounterMsg, sizeof(rightCounterMsg), result))
+    if (!queryMessage(rightCounterMsg, result))
     {
         return false;
     }
@@ -949,7 +1510,7 @@ bool AutomowerSafe::getWheelData()
     hcp_tResult result;
 
     const char* msg = "RealTimeData.GetWheelMotorData()";
-    if (!sendMessage(msg, sizeof(msg), result))
+    if (!queryMessage(msg, result))
     {
         return false;
     }
@@ -987,6 +1548,9 @@ bool AutomowerSafe::getWheelData()
     motorFeedbackDiffDrive.right.controlPower = std::copysign(result.parameters[3].value.i16, power_r);
     motorFeedbackDiffDrive.right.controlOmega = wanted_rv / (0.5 * WHEEL_DIAMETER);
 
+    recorder.record(FLIGHT_SENSOR, "wheelSpeed", (int32_t)(current_lv * 1000.0), (int32_t)(current_rv * 1000.0),
+                    wheelCurrent.left, wheelCurrent.right);
+
     return true;
 }
 
@@ -1107,7 +1671,7 @@ bool AutomowerSafe::getPitchAndRoll()
 {
     hcp_tResult result;
     const char* accelerometerMsg = "RealTimeData.GetSensorData()";
-    if (!sendMessage(accelerometerMsg, sizeof(accelerometerMsg), result))
+    if (!queryMessage(accelerometerMsg, result))
     {
         return false;
     }
@@ -1136,7 +1700,7 @@ bool AutomowerSafe::getGPSData()
 {
     hcp_tResult result;
     const char* GPS_Msg = "RealTimeData.GetGPSData()";
-    if (!sendMessage(GPS_Msg, sizeof(GPS_Msg), result))
+    if (!queryMessage(GPS_Msg, result))
     {
         return false;
     }
@@ -1213,13 +1777,14 @@ bool AutomowerSafe::getStateData()
     // State and Mode check
     //
     const char* msg2 = "MowerApp.GetState()";
-    if (!sendMessage(msg2, sizeof(msg2), result))
+    if (!queryMessage(msg2, result))
     {
         ROS_INFO("Couldn't get mower state...");
         return false;
     }
     int state = result.parameters[0].value.u8;
     sensorStatus.mowerInternalState = state;
+    recorder.record(FLIGHT_SENSOR, "mowerState", state);
     switch (state)
     {
     case IMOWERAPP_STATE_OFF:
@@ -1259,6 +1824,15 @@ bool AutomowerSafe::getStateData()
         break;
     }
 
+    // Main and sub state of the keep-alive getSensorStatus() sends, read here
+    // too so the mower stays awake with sensorStatusCheckFreq at 0
+    const char* keepAliveMsg = "CurrentStatus.GetStatusKeepAlive()";
+    if (queryMessage(keepAliveMsg, result) && (result.parameterCount > 2))
+    {
+        recorder.record(FLIGHT_SENSOR, "mainState", result.parameters[0].value.u8,
+                        result.parameters[1].value.u8, result.parameters[2].value.u8);
+    }
+
     return true;
 }
 
@@ -1269,14 +1843,17 @@ bool AutomowerSafe::getSensorStatus()
     //
     // SensorStatus
     //
-    sensorStatus.sensorStatus = 0;
+    // While driving with adaptivePolling, loop detection and the charger
+    // connection are read at a lower rate and keep their value in between
+    const bool readDetails = !pollingMoving || (ros::Time::now() >= nextStatusDetailTime);
+    sensorStatus.sensorStatus &= readDetails ? 0 : (HVA_SS_LOOP_ON | HVA_SS_IN_CS);
 
     const char* loopMsg = "SystemSettings.GetLoopDetection()";
-    if (!sendMessage(loopMsg, sizeof(loopMsg), result))
+    if (readDetails && !queryMessage(loopMsg, result))
     {
         return false;
     }
-    if (result.parameterCount == 1)
+    if (readDetails && (result.parameterCount == 1))
     {
         // 1 - Active,
         if (result.parameters[0].value.b == 1)
@@ -1298,11 +1875,19 @@ bool AutomowerSafe::getSensorStatus()
     // STOP button
     //
     const char* userStopMsg = "SafetySupervisor.GetStatus()";
-    if (!sendMessage(userStopMsg, sizeof(userStopMsg), result))
+    if (!queryMessage(userStopMsg, result))
     {
         ROS_WARN("Can't get Safety supervisor status");
         return false;
     }
+    const bool userStopPressed = result.parameters[0].value.b;
+    if (userStopPressed && !lastUserStopPressed)
+    {
+        recorder.record(FLIGHT_SENSOR, "userStop", 1);
+        dumpFlightRecorder("user_stop");
+    }
+    lastUserStopPressed = userStopPressed;
+
     if (result.parameters[0].value.b)
     {
         sensorStatus.sensorStatus |= HVA_SS_USER_STOP;
@@ -1350,14 +1935,27 @@ bool AutomowerSafe::getSensorStatus()
         userStop = false;
     }
 
+    //
+    // Tilt, from the accelerometer response getPitchAndRoll() also reads
+    //
+    const char* tiltMsg = "RealTimeData.GetSensorData()";
+    if (queryMessage(tiltMsg, result) && (result.parameterCount > 5))
+    {
+        const double pitch = result.parameters[2].value.i16 / 10.0;
+        const double roll = result.parameters[3].value.i16 / 10.0;
+        if ((fabs(pitch) > TOO_STEEP_ANGLE) || (fabs(roll) > TOO_STEEP_ANGLE) || result.parameters[5].value.u8)
+        {
+            sensorStatus.sensorStatus |= HVA_SS_TOO_STEEP;
+        }
+    }
 
     // Check if inside charging station
     const char* msgCPC = "Charger.IsChargingPowerConnected()";
-    if (!sendMessage(msgCPC, sizeof(msgCPC), result))
+    if (readDetails && !queryMessage(msgCPC, result))
     {
         return false;
     }
-    if (result.parameterCount == 1)
+    if (readDetails && (result.parameterCount == 1))
     {
         // 1 - Active,
         if (result.parameters[0].value.b == 1)
@@ -1375,11 +1973,16 @@ bool AutomowerSafe::getSensorStatus()
 
     // Send Keep alive message to prevent automower to go to sleep mode
     const char* msgK = "CurrentStatus.GetStatusKeepAlive()";
-    if (!sendMessage(msgK, sizeof(msgK), result))
+    if (!queryMessage(msgK, result))
     {
         return false;
     }
 
+    if (readDetails && (sensorStatusCheckFreq > 1e-6))
+    {
+        nextStatusDetailTime = ros::Time::now() + ros::Duration(1.0 / (sensorStatusCheckFreq * POLL_SCALE_SLOW));
+    }
+
     return true;
 }
 
@@ -1391,7 +1994,7 @@ bool AutomowerSafe::getLoopData()
     // LoopSensor
     //
     const char* loopAmsg = "LoopSampler.GetLoopSignalMaster(loop:0)";
-    if (!sendMessage(loopAmsg, sizeof(loopAmsg), result))
+    if (!queryMessage(loopAmsg, result))
     {
         return false;
     }
@@ -1411,7 +2014,7 @@ bool AutomowerSafe::getLoopData()
     }
 
     const char* loopFmsg = "LoopSampler.GetLoopSignalMaster(loop:1)";
-    if (!sendMessage(loopFmsg, sizeof(loopFmsg), result))
+    if (!queryMessage(loopFmsg, result))
     {
         return false;
     }
@@ -1426,7 +2029,7 @@ bool AutomowerSafe::getLoopData()
     }
 
     const char* loopNmsg = "LoopSampler.GetLoopSignalMaster(loop:2)";
-    if (!sendMessage(loopNmsg, sizeof(loopNmsg), result))
+    if (!queryMessage(loopNmsg, result))
     {
         return false;
     }
@@ -1450,7 +2053,7 @@ bool AutomowerSafe::getBatteryData()
     // Battery check
     //
     const char* msg = "RealTimeData.GetBatteryData()";
-    if (!sendMessage(msg, sizeof(msg), result))
+    if (!queryMessage(msg, result))
     {
         return false;
     }
@@ -1472,6 +2075,7 @@ bool AutomowerSafe::getBatteryData()
     batteryStatus.batteryACurrent = batAcurrent;
     batteryStatus.batteryBVoltage = batBvoltage;
     batteryStatus.batteryBCurrent = batBcurrent;
+    recorder.record(FLIGHT_SENSOR, "battery", batAvoltage, batAcurrent, batBvoltage, batBcurrent);
 
     batStatus_pub.publish(batteryStatus);
 
@@ -1492,9 +2096,10 @@ void AutomowerSafe::stopWheels()
 //    wheelPower.left = power_l;
 //    wheelPower.right = power_r;
 
-    hcp_tResult result;
+    hcp_tResultStorage response;
+    const hcp_tResult& result = response.result;
     const char* powerOffMsg = "Wheels.PowerOff()";
-    if (!sendMessage(powerOffMsg, sizeof(powerOffMsg), result))
+    if (!sendMessage(powerOffMsg, sizeof(powerOffMsg), response))
     {
         return;
     }
@@ -1558,10 +2163,13 @@ void AutomowerSafe::sendWheelPower(double power_left, double power_right)
     }
 
     // Send it out...
-    hcp_tResult result;
+    hcp_tResultStorage response;
+    const hcp_tResult& result = response.result;
     char powerMsg[100];
     snprintf(powerMsg, sizeof(powerMsg), "HardwareControl.WheelMotorsPower(leftWheelMotorPower:%d, rightWheelMotorPower:%d)", power_l, power_r);
-    if (!sendMessage(powerMsg, sizeof(powerMsg), result))
+    recorder.record(FLIGHT_REGULATOR, "wheelPower", power_l, power_r,
+                    (int32_t)(wanted_lv * 1000.0), (int32_t)(wanted_rv * 1000.0));
+    if (!sendMessage(powerMsg, sizeof(powerMsg), response))
     {
         ROS_WARN("Can't set power, unknown reason");
         return;
@@ -1572,13 +2180,14 @@ void AutomowerSafe::sendWheelPower(double power_left, double power_right)
 
 bool AutomowerSafe::doSerialComTest()
 {
-    hcp_tResult result;
+    hcp_tResultStorage response;
+    const hcp_tResult& result = response.result;
     int i;
 
     if (printCharge)
     {
         const char* msg = "RealTimeData.GetBatteryData()";
-        if (!sendMessage(msg, sizeof(msg), result))
+        if (!sendMessage(msg, sizeof(msg), response))
         {
             return false;
         }
@@ -1596,7 +2205,7 @@ bool AutomowerSafe::doSerialComTest()
 
     // Send Keep alive message to prevent automower to go to sleep mode
     const char* msgK = "CurrentStatus.GetStatusKeepAlive()";
-    if (!sendMessage(msgK, sizeof(msgK), result))
+    if (!sendMessage(msgK, sizeof(msgK), response))
     {
         return false;
     }
@@ -1607,12 +2216,12 @@ bool AutomowerSafe::doSerialComTest()
 
     for (i = 0; i  < 50; i++)
     {
-        if (!sendMessage(msgA, sizeof(msgA), result))
+        if (!sendMessage(msgA, sizeof(msgA), response))
         {
             return false;
         }
 
-        if (!sendMessage(msgB, sizeof(msgB), result))
+        if (!sendMessage(msgB, sizeof(msgB), response))
         {
             return false;
         }
@@ -1628,6 +2237,335 @@ bool AutomowerSafe::doSerialComTest()
 
 }
 
+void AutomowerSafe::adaptPollingRates()
+{
+    PollingRates rates;
+    rates.wheelSensor = wheelSensorFreq;
+    rates.encoderSensor = encoderSensorFreq;
+    rates.regulator = regulatorFreq;
+    rates.state = stateCheckFreq;
+    rates.loop = loopSensorFreq;
+    rates.pitchRoll = m_PitchAndRollFromAccelerometer ? pitchRollFreq : 0.0;
+    rates.battery = batteryCheckFreq;
+    rates.GPS = GPSCheckFreq;
+    rates.status = sensorStatusCheckFreq;
+
+    const int mode = sensorStatus.controlState;
+    const bool autonomous = (mode == AM_STATE_RANDOM) || (mode == AM_STATE_PARK);
+    const bool moving = isMoving();
+    const bool charging = (sensorStatus.sensorStatus & (HVA_SS_CHARGING | HVA_SS_IN_CS)) != 0;
+
+    if (!adaptivePolling)
+    {
+        pollingRates = rates;
+        pollingMoving = false;
+        return;
+    }
+
+    const PollingRates configured = rates;
+
+    // Safety status, keep-alive and mower state are never slowed down
+    if (!moving)
+    {
+        rates.wheelSensor *= POLL_SCALE_SLOW;
+        rates.encoderSensor *= POLL_SCALE_SLOW;
+        rates.pitchRoll *= POLL_SCALE_SLOW;
+        rates.GPS *= POLL_SCALE_SLOW;
+    }
+    if (!charging)
+    {
+        rates.battery *= POLL_SCALE_SLOW;
+    }
+    if ((mode != AM_STATE_MANUAL) && !autonomous)
+    {
+        rates.loop *= POLL_SCALE_SLOW;
+    }
+
+    // Serial exchanges per second the slower polling frees
+    double freed = (configured.wheelSensor - rates.wheelSensor) +
+                   (configured.encoderSensor - rates.encoderSensor) * POLL_EXCHANGES_ENCODER +
+                   (configured.loop - rates.loop) * POLL_EXCHANGES_LOOP +
+                   (configured.pitchRoll - rates.pitchRoll) +
+                   (configured.battery - rates.battery) +
+                   (configured.GPS - rates.GPS);
+    if (moving)
+    {
+        // Loop detection and charger connection, see getSensorStatus()
+        freed += configured.status * (1.0 - POLL_SCALE_SLOW) * POLL_EXCHANGES_STATUS_DETAIL;
+    }
+
+    // Only worth it while driving. Regulating by speed needs a fresh wheel
+    // speed for every regulation, which costs one more exchange.
+    if (moving && (regulatorMaxFreq > regulatorFreq))
+    {
+        const int exchanges = regulateBySpeed ? 2 : 1;
+        rates.regulator = std::min(regulatorMaxFreq, regulatorFreq + freed / exchanges);
+        if (regulateBySpeed)
+        {
+            rates.wheelSensor = std::max(rates.wheelSensor, rates.regulator);
+        }
+    }
+
+    if ((moving != pollingMoving) || (fabs(rates.battery - pollingRates.battery) > 1e-6))
+    {
+        ROS_DEBUG("Automower::Polling %s%s: wheel %.1f Hz, regulator %.1f Hz, %.1f exchanges/s freed",
+                  moving ? "moving" : "standing", charging ? ", charging" : "",
+                  rates.wheelSensor, rates.regulator, freed);
+    }
+
+    pollingRates = rates;
+    pollingMoving = moving;
+
+    if (fabs(pollingRates.regulator - tunedRegulatorFreq) > 0.5)
+    {
+        tuneWheelPids(pollingRates.regulator);
+    }
+}
+
+void AutomowerSafe::tuneWheelPids(double frequency)
+{
+    // Same x factor as in initAutomowerBoard, the regulation equals the one
+    // at 50 Hz. The accumulated error is kept so the wheels do not jerk.
+    double x = 50.0 / frequency;
+
+    leftWheelPid.SetGains(50.0, 10.0*x, 1.0/x);
+    rightWheelPid.SetGains(50.0, 10.0*x, 1.0/x);
+    tunedRegulatorFreq = frequency;
+}
+
+double AutomowerSafe::measureCommandCost(const char* const* commands)
+{
+    hcp_tResultStorage response;
+    double cost = 0.0;
+
+    for (int c = 0; commands[c] != NULL; c++)
+    {
+        double sumRtt = 0.0;
+        int wireBytes = 0;
+        for (int i = 0; i < SERIAL_BUDGET_SAMPLES; i++)
+        {
+            ros::WallTime start = ros::WallTime::now();
+            if (!sendMessage(commands[c], strlen(commands[c]), response, &wireBytes))
+            {
+                return -1.0;
+            }
+            sumRtt += (ros::WallTime::now() - start).toSec();
+        }
+
+        // Never less than the frames take on the wire, 10 bits per byte
+        const double wireTime = wireBytes * 10.0 / serialConfig.baudRate;
+        const double rtt = std::max(sumRtt / SERIAL_BUDGET_SAMPLES, wireTime);
+        ROS_INFO("Automower::Serial budget: %s %d bytes, %.2f ms", commands[c], wireBytes, rtt * 1000.0);
+        cost += rtt;
+    }
+    return cost;
+}
+
+void AutomowerSafe::checkSerialBudget()
+{
+    if (!serialBudget)
+    {
+        return;
+    }
+
+    if ((pollingCosts.wheelSensor < 0) || (pollingCosts.encoderSensor < 0) || (pollingCosts.regulator < 0) ||
+        (pollingCosts.state < 0) || (pollingCosts.loop < 0) || (pollingCosts.pitchRoll < 0) ||
+        (pollingCosts.battery < 0) || (pollingCosts.GPS < 0) || (pollingCosts.status < 0))
+    {
+        ROS_WARN("Automower::Serial budget: could not time the polled commands, budget not enforced");
+        memset(&pollingCosts, 0, sizeof(pollingCosts));
+        budgetRate = 0.0;
+        return;
+    }
+
+    // Reserved for the wheel commands, at the highest rate they may run, and
+    // for the safety status, keep-alive and mower state which always run at
+    // their configured rate
+    const double regulatorRate = adaptivePolling ? std::max(regulatorFreq, regulatorMaxFreq) : regulatorFreq;
+    const double wheelSensorRate = (adaptivePolling && regulateBySpeed) ? std::max(wheelSensorFreq, regulatorRate) : wheelSensorFreq;
+    const double wheelLoad = regulatorRate * pollingCosts.regulator + wheelSensorRate * pollingCosts.wheelSensor;
+    const double safetyLoad = sensorStatusCheckFreq * pollingCosts.status + stateCheckFreq * pollingCosts.state;
+    const double reservedLoad = wheelLoad + safetyLoad;
+
+    const double pitchRollRate = m_PitchAndRollFromAccelerometer ? pitchRollFreq : 0.0;
+    const double pollingLoad = encoderSensorFreq * pollingCosts.encoderSensor +
+                               loopSensorFreq * pollingCosts.loop +
+                               pitchRollRate * pollingCosts.pitchRoll +
+                               batteryCheckFreq * pollingCosts.battery +
+                               GPSCheckFreq * pollingCosts.GPS;
+
+    ROS_INFO("Automower::Serial budget: wheel commands %.0f%%, status and state %.0f%%, polling %.0f%% of the link, %.0f%% usable",
+             wheelLoad * 100.0, safetyLoad * 100.0, pollingLoad * 100.0, serialBudgetShare * 100.0);
+
+    const double maxRate = std::max(std::max(wheelSensorRate, regulatorRate),
+                                    std::max(encoderSensorFreq, sensorStatusCheckFreq));
+    if (maxRate > updateRate)
+    {
+        ROS_WARN("Automower::Serial budget: rates above updateRate (%.1f Hz) are limited to one call per update",
+                 updateRate);
+    }
+
+    // The mower may already be driven, so a link that is too slow leaves the
+    // reserved commands as they are and only holds the other getters back
+    if (reservedLoad + SERIAL_BUDGET_MIN_SHARE > serialBudgetShare)
+    {
+        ROS_ERROR("Automower::Serial budget: the wheel commands, status and state need %.0f%% of the link, lower regulatorFreq, wheelSensorFreq, sensorStatusCheckFreq or stateCheckFreq",
+                  reservedLoad * 100.0);
+        ROS_ERROR("Automower::Serial budget: the other getters are limited to %.0f%% of the link",
+                  SERIAL_BUDGET_MIN_SHARE * 100.0);
+    }
+    else if (reservedLoad + pollingLoad > serialBudgetShare)
+    {
+        if (serialBudgetScale)
+        {
+            const double scale = (serialBudgetShare - reservedLoad) / pollingLoad;
+            encoderSensorFreq *= scale;
+            loopSensorFreq *= scale;
+            pitchRollFreq *= scale;
+            batteryCheckFreq *= scale;
+            GPSCheckFreq *= scale;
+            ROS_WARN("Automower::Serial budget: polling rates scaled by %.2f to fit, encoder %.1f Hz, loop %.1f Hz, pitch/roll %.1f Hz, battery %.1f Hz, GPS %.1f Hz",
+                     scale, encoderSensorFreq, loopSensorFreq, pitchRollFreq, batteryCheckFreq, GPSCheckFreq);
+        }
+        else
+        {
+            ROS_ERROR("Automower::Serial budget: the configured rates need %.0f%% of the link, lower the *Freq parameters or set serialBudgetScale",
+                      (reservedLoad + pollingLoad) * 100.0);
+            ROS_ERROR("Automower::Serial budget: the other getters are deferred to fit");
+        }
+    }
+
+    // The bucket must at least hold the most expensive getter call
+    budgetRate = std::max(serialBudgetShare - reservedLoad, SERIAL_BUDGET_MIN_SHARE);
+    const double maxCost = std::max(std::max(std::max(pollingCosts.encoderSensor, pollingCosts.loop),
+                                             std::max(pollingCosts.pitchRoll, pollingCosts.battery)),
+                                    pollingCosts.GPS);
+    budgetCapacity = std::max(budgetRate * SERIAL_BUDGET_BURST, maxCost);
+    budgetTokens = budgetCapacity;
+    budgetRefillTime = ros::WallTime::now();
+
+    adaptPollingRates();
+}
+
+void AutomowerSafe::calibrateSerialLink()
+{
+    // Until done the budget is not enforced, each step takes a few exchanges
+    switch (serialCalibrationStep++)
+    {
+    case 0:
+        benchmarkSerialLink();
+        break;
+    case 1:
+        pollingCosts.wheelSensor = serialBudget ? measureCommandCost(BUDGET_WHEEL_COMMANDS) : 0.0;
+        break;
+    case 2:
+        pollingCosts.encoderSensor = serialBudget ? measureCommandCost(BUDGET_ENCODER_COMMANDS) : 0.0;
+        break;
+    case 3:
+        pollingCosts.regulator = serialBudget ? measureCommandCost(BUDGET_REGULATOR_COMMANDS) : 0.0;
+        break;
+    case 4:
+        pollingCosts.state = serialBudget ? measureCommandCost(BUDGET_STATE_COMMANDS) : 0.0;
+        break;
+    case 5:
+        pollingCosts.loop = serialBudget ? measureCommandCost(BUDGET_LOOP_COMMANDS) : 0.0;
+        break;
+    case 6:
+        pollingCosts.pitchRoll = serialBudget ? measureCommandCost(BUDGET_PITCHROLL_COMMANDS) : 0.0;
+        break;
+    case 7:
+        pollingCosts.battery = serialBudget ? measureCommandCost(BUDGET_BATTERY_COMMANDS) : 0.0;
+        break;
+    case 8:
+        pollingCosts.GPS = serialBudget ? measureCommandCost(BUDGET_GPS_COMMANDS) : 0.0;
+        break;
+    case 9:
+        pollingCosts.status = serialBudget ? measureCommandCost(BUDGET_STATUS_COMMANDS) : 0.0;
+        break;
+    default:
+        serialBenchmarkDone = true;
+        checkSerialBudget();
+        break;
+    }
+}
+
+bool AutomowerSafe::isMoving() const
+{
+    const int mode = sensorStatus.controlState;
+    const bool autonomous = (mode == AM_STATE_RANDOM) || (mode == AM_STATE_PARK);
+    return autonomous ||
+           (fabs(wanted_lv) > POLL_MOTION_THRESHOLD) || (fabs(wanted_rv) > POLL_MOTION_THRESHOLD) ||
+           (fabs(current_lv) > POLL_MOTION_THRESHOLD) || (fabs(current_rv) > POLL_MOTION_THRESHOLD);
+}
+
+void AutomowerSafe::reportStartup()
+{
+    StartupTrace& trace = StartupTrace::instance();
+    trace.mark("first wheel command");
+    isStartupReported = true;
+
+    const std::vector<StartupPhase> phases = trace.phases();
+    for (size_t i = 0; i < phases.size(); i++)
+    {
+        const StartupPhase& phase = phases[i];
+        if (phase.end == phase.begin)
+        {
+            ROS_INFO("Automower::Startup %7.1f ms %s", phase.begin * 1e-6, phase.name);
+        }
+        else if (phase.end == 0)
+        {
+            ROS_INFO("Automower::Startup %7.1f ms %s, still running", phase.begin * 1e-6, phase.name);
+        }
+        else
+        {
+            ROS_INFO("Automower::Startup %7.1f ms %s, %.1f ms", phase.begin * 1e-6, phase.name,
+                     (phase.end - phase.begin) * 1e-6);
+        }
+    }
+
+    const double elapsed = trace.now() * 1e-9;
+    if (elapsed > STARTUP_TARGET)
+    {
+        ROS_WARN("Automower::First wheel command %.0f ms after start, target %.0f ms",
+                 elapsed * 1000.0, STARTUP_TARGET * 1000.0);
+    }
+}
+
+void AutomowerSafe::refillSerialBudget()
+{
+    const ros::WallTime now = ros::WallTime::now();
+    budgetTokens = std::min(budgetCapacity, budgetTokens + (now - budgetRefillTime).toSec() * budgetRate);
+    budgetRefillTime = now;
+
+    const double elapsed = now.toSec() - budgetReportTime;
+    if (elapsed >= SERIAL_BUDGET_REPORT_PERIOD)
+    {
+        if (budgetDeferred > 0)
+        {
+            ROS_WARN("Automower::Serial budget: %lu getter calls deferred in %.0f s", budgetDeferred, elapsed);
+        }
+        budgetDeferred = 0;
+        budgetReportTime = now.toSec();
+    }
+}
+
+bool AutomowerSafe::admitPoll(double cost)
+{
+    if (budgetRate <= 0.0)
+    {
+        return true;
+    }
+
+    // A deferred getter stays due and is tried again next update
+    if (budgetTokens < cost)
+    {
+        budgetDeferred++;
+        return false;
+    }
+    budgetTokens -= cost;
+    return true;
+}
+
 bool AutomowerSafe::isTimeOut(ros::Duration elapsedTime, double frequency)
 {
     if (fabs(frequency) < 1e-6)
@@ -1650,9 +2588,10 @@ void AutomowerSafe::handleCollisionInjections(ros::Duration dt)
         case 1:
         {
             ROS_INFO("Collision.SetSimulation(onOff:1)");
-            hcp_tResult result; 
+            hcp_tResultStorage response;
+            const hcp_tResult& result = response.result;
             const char* msg = "Collision.SetSimulation(onOff:1)";
-            if (!sendMessage(msg, sizeof(msg), result))
+            if (!sendMessage(msg, sizeof(msg), response))
             {
                 eventQueue->raiseEvent("/COM_ERROR");
             }
@@ -1662,9 +2601,10 @@ void AutomowerSafe::handleCollisionInjections(ros::Duration dt)
         case 2:
         {
             ROS_INFO("Collision.SetSimulatedStatus(status:1)");
-            hcp_tResult result; 
+            hcp_tResultStorage response;
+            const hcp_tResult& result = response.result;
             const char* msg =  "Collision.SetSimulatedStatus(status:1)";
-            if (!sendMessage(msg, sizeof(msg), result))
+            if (!sendMessage(msg, sizeof(msg), response))
             {
                 eventQueue->raiseEvent("/COM_ERROR");
             }
@@ -1680,9 +2620,10 @@ void AutomowerSafe::handleCollisionInjections(ros::Duration dt)
             if (isTimeOut(timeSinceCollision, 1))
             {
                 ROS_INFO( "Collision.SetSimulatedStatus(status:0)");
-                hcp_tResult result; 
+                hcp_tResultStorage response;
+                const hcp_tResult& result = response.result;
                 const char* msg =  "Collision.SetSimulatedStatus(status:0)";
-                if (!sendMessage(msg, sizeof(msg), result))
+                if (!sendMessage(msg, sizeof(msg), response))
                 {
                     eventQueue->raiseEvent("/COM_ERROR");
                 }
@@ -1693,10 +2634,11 @@ void AutomowerSafe::handleCollisionInjections(ros::Duration dt)
         }
         case 4:
         {
-            hcp_tResult result; 
+            hcp_tResultStorage response;
+            const hcp_tResult& result = response.result;
             ROS_INFO("Collision.SetSimulation(onOff:0)");
             const char* msg = "Collision.SetSimulation(onOff:0)";
-            if (!sendMessage(msg, sizeof(msg), result))
+            if (!sendMessage(msg, sizeof(msg), response))
             {
                 eventQueue->raiseEvent("/COM_ERROR");
             }
@@ -1709,9 +2651,10 @@ void AutomowerSafe::handleCollisionInjections(ros::Duration dt)
         case 5:
         {
             ROS_INFO("Collision.SetSimulation(onOff:1)");
-            hcp_tResult result; 
+            hcp_tResultStorage response;
+            const hcp_tResult& result = response.result;
             const char* msg = "Collision.SetSimulation(onOff:1)";
-            if (!sendMessage(msg, sizeof(msg), result))
+            if (!sendMessage(msg, sizeof(msg), response))
             {
                 eventQueue->raiseEvent("/COM_ERROR");
             }
@@ -1721,9 +2664,10 @@ void AutomowerSafe::handleCollisionInjections(ros::Duration dt)
         case 6:
         {
             ROS_INFO("Collision.SetSimulatedStatus(status:0)");
-            hcp_tResult result; 
+            hcp_tResultStorage response;
+            const hcp_tResult& result = response.result;
             const char* msg =  "Collision.SetSimulatedStatus(status:0)";
-            if (!sendMessage(msg, sizeof(msg), result))
+            if (!sendMessage(msg, sizeof(msg), response))
             {
                 eventQueue->raiseEvent("/COM_ERROR");
             }
@@ -1735,9 +2679,10 @@ void AutomowerSafe::handleCollisionInjections(ros::Duration dt)
         case 7:
         {
             ROS_INFO("Collision.SetSimulation(onOff:0)");
-            hcp_tResult result; 
+            hcp_tResultStorage response;
+            const hcp_tResult& result = response.result;
             const char* msg = "Collision.SetSimulation(onOff:0)";
-            if (!sendMessage(msg, sizeof(msg), result))
+            if (!sendMessage(msg, sizeof(msg), response))
             {
                 eventQueue->raiseEvent("/COM_ERROR");
             }
@@ -1752,6 +2697,7 @@ bool AutomowerSafe::go()
 	{
     if (serialPortState == AM_SP_STATE_ERROR)
     {
+        dumpFlightRecorder("com_error");
         if (!serialComTest)
         {
             nextAutomowerInitTime = ros::Time::now() + ros::Duration(2.0);  // only wait a short time
@@ -1803,8 +2749,16 @@ bool AutomowerSafe::go()
 }
 bool AutomowerSafe::update(ros::Duration dt)
 {
+    if (standby)
+    {
+        return watchPrimary();
+    }
+    mirrorDriverState();
+
     if (serialPortState == AM_SP_STATE_ERROR)
     {
+        dumpFlightRecorder("com_error");
+
         if (!serialComTest)
         {
             nextAutomowerInitTime = ros::Time::now() + ros::Duration(2.0);  // only wait a short time
@@ -1827,7 +2781,6 @@ bool AutomowerSafe::update(ros::Duration dt)
             serialPortState = AM_SP_STATE_INITIALISING;
             if (initAutomowerBoard())
             {
-
                 ROS_INFO("Automower::Serial port ONLINE!");
                 serialPortState = AM_SP_STATE_ONLINE;
             }
@@ -1860,6 +2813,10 @@ bool AutomowerSafe::update(ros::Duration dt)
         {
             eventQueue->raiseEvent("/RANDOM");
         }
+        else if (requestedState == AM_STATE_PARK)
+        {
+            eventQueue->raiseEvent("/PARKING");
+        }
     }
 
     if (serialComTest)
@@ -1885,7 +2842,13 @@ bool AutomowerSafe::update(ros::Duration dt)
     // Communication with mower if serial port connected
     if (serialPortState == AM_SP_STATE_CONNECTED )
     {
-        if (isTimeOut(timeSinceWheelSensor, wheelSensorFreq))
+        // Responses cached in the previous tick are stale from here on
+        responseCacheTick++;
+
+        adaptPollingRates();
+        refillSerialBudget();
+
+        if (isTimeOut(timeSinceWheelSensor, pollingRates.wheelSensor))
         {
             getWheelData();
 //            double rate = 1.0/timeSinceWheelSensor.toSec();
@@ -1894,7 +2857,8 @@ bool AutomowerSafe::update(ros::Duration dt)
             newData = true;
 
         }
-        if (isTimeOut(timeSinceEncoderSensor, encoderSensorFreq))
+        if (isTimeOut(timeSinceEncoderSensor, pollingRates.encoderSensor) &&
+            admitPoll(pollingCosts.encoderSensor))
         {
             getEncoderData();
 //            double rate = 1.0/timeSinceEncoderSensor.toSec();
@@ -1903,7 +2867,7 @@ bool AutomowerSafe::update(ros::Duration dt)
             newData = true;
 
         }
-        if (isTimeOut(timeSinceRegulator, regulatorFreq))
+        if (isTimeOut(timeSinceRegulator, pollingRates.regulator))
         {
             if (regulateBySpeed)
             {
@@ -1922,38 +2886,53 @@ bool AutomowerSafe::update(ros::Duration dt)
                 newData = true;
             }
         }
-        if (isTimeOut(timeSinceStatus, sensorStatusCheckFreq))
+        if (!isStartupReported && (timeSinceRegulator.toSec() < 1e-6))
+        {
+            reportStartup();
+        }
+        // Measured after the first wheel command, one step per update and
+        // only standing still as zero power is one of the timed commands
+        if (!serialBenchmarkDone && isStartupReported && !isMoving())
+        {
+            calibrateSerialLink();
+        }
+        // Safety status, keep-alive and mower state have their share reserved
+        if (isTimeOut(timeSinceStatus, pollingRates.status))
         {
             getSensorStatus();
             timeSinceStatus *= 0;
             newData = true;
         }
-        if (isTimeOut(timeSinceState, stateCheckFreq))
+        if (isTimeOut(timeSinceState, pollingRates.state))
         {
             getStateData();
             timeSinceState *= 0;
             newData = true;
         }
-        if (isTimeOut(timeSinceLoop, loopSensorFreq))
+        if (isTimeOut(timeSinceLoop, pollingRates.loop) &&
+            admitPoll(pollingCosts.loop))
         {
             getLoopData();
             timeSinceLoop *= 0;
             newData = true;
         }
         if (m_PitchAndRollFromAccelerometer &&
-                 isTimeOut(timeSincePitchRoll, pitchRollFreq))
+                 isTimeOut(timeSincePitchRoll, pollingRates.pitchRoll) &&
+                 admitPoll(pollingCosts.pitchRoll))
         {
             getPitchAndRoll();
             timeSincePitchRoll *= 0;
             newData = true;
         }
-        if (isTimeOut(timeSincebattery, batteryCheckFreq))
+        if (isTimeOut(timeSincebattery, pollingRates.battery) &&
+            admitPoll(pollingCosts.battery))
         {
             getBatteryData();
             timeSincebattery *= 0;
             newData = true;
         }
-        if (isTimeOut(timeSinceGPS, GPSCheckFreq))
+        if (isTimeOut(timeSinceGPS, pollingRates.GPS) &&
+            admitPoll(pollingCosts.GPS))
         {
             getGPSData();
             timeSinceGPS *= 0;
@@ -1962,9 +2941,10 @@ bool AutomowerSafe::update(ros::Duration dt)
 
         if (newSound)
         {
-            hcp_tResult result; 
+            hcp_tResultStorage response;
+            const hcp_tResult& result = response.result;
             const char* msg = soundCmd;
-            if (!sendMessage(msg, sizeof(msg), result))
+            if (!sendMessage(msg, sizeof(msg), response))
             {
                 eventQueue->raiseEvent("/COM_ERROR");
             }
@@ -1972,6 +2952,9 @@ bool AutomowerSafe::update(ros::Duration dt)
         }
 
         handleCollisionInjections(dt);
+
+        reportResponseCache();
+        reportSerialQueue();
     }
 
     if (!newData)
@@ -2114,6 +3097,12 @@ bool AutomowerSafe::update(ros::Duration dt)
 
         // Publish the pose
         pose_pub.publish(robot_pose);
+
+        sensorSnapshot.x = xpos;
+        sensorSnapshot.y = ypos;
+        sensorSnapshot.yaw = yaw;
+        sensorSnapshot.linearVelocity = vx;
+        sensorSnapshot.angularVelocity = vYaw;
     }
 
     if (timeSinceLoop.toSec() < 1e-6)
@@ -2136,17 +3125,185 @@ bool AutomowerSafe::update(ros::Duration dt)
         sensorStatus_pub.publish(sensorStatus);
     }
 
+    publishSensorSnapshot();
+
+    return true;
+}
+
+void AutomowerSafe::mirrorDriverState()
+{
+    if (!stateMirror.isOpen())
+    {
+        return;
+    }
+
+    if (serialPortState != AM_SP_STATE_CONNECTED)
+    {
+        // Nobody drives the mower, a standby would not do better
+        if (isMirrorLive)
+        {
+            stateMirror.release();
+            isMirrorLive = false;
+        }
+        return;
+    }
+
+    DriverState state;
+    memset(&state, 0, sizeof(state));
+    state.controlState = sensorStatus.controlState;
+    state.requestedState = requestedState;
+    state.cuttingDiscOn = cuttingDiscOn;
+    state.cuttingHeight = cuttingHeight;
+    state.loopOn = requestedLoopOn;
+
+    state.x = xpos;
+    state.y = ypos;
+    state.yaw = yaw;
+    state.lastYaw = last_yaw;
+    state.leftPulses = leftPulses;
+    state.rightPulses = rightPulses;
+    state.lastLeftPulses = lastLeftPulses;
+    state.lastRightPulses = lastRightPulses;
+
+    stateMirror.write(state);
+    isMirrorLive = true;
+}
+
+bool AutomowerSafe::watchPrimary()
+{
+    // A failed read keeps the last state, its heartbeat ages
+    DriverState state;
+    if (stateMirror.read(state))
+    {
+        mirroredState = state;
+    }
+
+    const uint64_t heartbeat = stateMirror.heartbeat();
+    if (heartbeat == 0)
+    {
+        return true;
+    }
+
+    const double silence = StateMirror::heartbeatAge(heartbeat) * 1e-9;
+    if (silence < standbyTimeout)
+    {
+        return true;
+    }
+
+    return takeOver(silence);
+}
+
+bool AutomowerSafe::takeOver(double silence)
+{
+    const ros::WallTime start = ros::WallTime::now();
+    const pid_t primary = (pid_t)mirroredState.primaryPid;
+
+    ROS_WARN("Automower::No heartbeat from driver %d for %.0f ms, taking over", primary, silence * 1000.0);
+    recorder.record(FLIGHT_ERROR, "takeover", primary, (int32_t)(silence * 1000.0));
+
+    // A hung primary would keep sending, SIGABRT also dumps its flight
+    // recorder. The port is only opened once it has exited.
+    if ((primary > 0) && (primary != getpid()))
+    {
+        kill(primary, SIGABRT);
+        if (!waitForExit(primary, TAKEOVER_EXIT_WAIT))
+        {
+            ROS_WARN("Automower::Driver %d still running after SIGABRT, killing it", primary);
+            kill(primary, SIGKILL);
+            if (!waitForExit(primary, TAKEOVER_EXIT_WAIT))
+            {
+                // Tried again next update
+                ROS_ERROR("Automower::Driver %d does not exit, not taking over", primary);
+                return true;
+            }
+        }
+    }
+
+    if (!connectSerial())
+    {
+        // Tried again next update
+        return true;
+    }
+    openSensorSnapshot();
+
+    // Odometry goes on from the primary's, the pulses counted meanwhile
+    // are integrated by the first encoder update
+    xpos = mirroredState.x;
+    ypos = mirroredState.y;
+    yaw = mirroredState.yaw;
+    last_yaw = mirroredState.lastYaw;
+    leftPulses = mirroredState.leftPulses;
+    rightPulses = mirroredState.rightPulses;
+    lastLeftPulses = mirroredState.lastLeftPulses;
+    lastRightPulses = mirroredState.lastRightPulses;
+
+    requestedState = mirroredState.requestedState;
+    if ((mirroredState.controlState == AM_STATE_MANUAL) || (mirroredState.controlState == AM_STATE_RANDOM) ||
+        (mirroredState.controlState == AM_STATE_PARK))
+    {
+        requestedState = mirroredState.controlState;
+    }
+    cuttingDiscOn = (mirroredState.cuttingDiscOn != 0);
+    cuttingHeight = mirroredState.cuttingHeight;
+    requestedLoopOn = (mirroredState.loopOn != 0);
+
+    // The board is set up and the link measured by the primary, update()
+    // raises the event of the mirrored mode
+    serialBenchmarkDone = true;
+    serialPortState = AM_SP_STATE_ONLINE;
+    standby = false;
+
+    ROS_INFO("Automower::Primary after %.1f ms, %s mode", (ros::WallTime::now() - start).toSec() * 1000.0,
+             (requestedState == AM_STATE_RANDOM) ? "random" : (requestedState == AM_STATE_PARK) ? "park" : "manual");
     return true;
 }
 
+void AutomowerSafe::publishSensorSnapshot()
+{
+    if (!snapshotPublisher.isOpen())
+    {
+        return;
+    }
+
+    // Odometry is filled in by update() when it is integrated
+    sensorSnapshot.update++;
+    sensorSnapshot.pitch = m_pitch;
+    sensorSnapshot.roll = m_roll;
+
+    sensorSnapshot.leftSpeed = current_lv;
+    sensorSnapshot.rightSpeed = current_rv;
+    sensorSnapshot.leftCurrent = wheelCurrent.left;
+    sensorSnapshot.rightCurrent = wheelCurrent.right;
+    sensorSnapshot.leftPulses = leftPulses;
+    sensorSnapshot.rightPulses = rightPulses;
+    sensorSnapshot.leftPower = power_l;
+    sensorSnapshot.rightPower = power_r;
+
+    sensorSnapshot.loopA = loop.A0.frontCenter;
+    sensorSnapshot.loopF = loop.F.frontCenter;
+    sensorSnapshot.loopN = loop.N.frontCenter;
+
+    sensorSnapshot.batteryAVoltage = batteryStatus.batteryAVoltage;
+    sensorSnapshot.batteryACurrent = batteryStatus.batteryACurrent;
+    sensorSnapshot.batteryBVoltage = batteryStatus.batteryBVoltage;
+    sensorSnapshot.batteryBCurrent = batteryStatus.batteryBCurrent;
+
+    sensorSnapshot.sensorStatus = sensorStatus.sensorStatus;
+    sensorSnapshot.controlState = sensorStatus.controlState;
+    sensorSnapshot.mowerState = sensorStatus.mowerInternalState;
+
+    snapshotPublisher.publish(sensorSnapshot);
+}
+
 void AutomowerSafe::pauseMower()
 {
     DEBUG_LOG("AutoMowerSafe::pauseMower()");
 
-    hcp_tResult result;
+    hcp_tResultStorage response;
+    const hcp_tResult& result = response.result;
 
     const char* msg = "MowerApp.Pause()";
-    if (!sendMessage(msg, sizeof(msg), result))
+    if (!sendMessage(msg, sizeof(msg), response))
     {
         eventQueue->raiseEvent("/COM_ERROR");
     }
@@ -2155,9 +3312,10 @@ void AutomowerSafe::startMower()
 {
     DEBUG_LOG("AutoMowerSafe::startMower()");
 
-    hcp_tResult result;
+    hcp_tResultStorage response;
+    const hcp_tResult& result = response.result;
     const char* msg = "MowerApp.StartTrigger()";
-    if (!sendMessage(msg, sizeof(msg), result))
+    if (!sendMessage(msg, sizeof(msg), response))
     {
         eventQueue->raiseEvent("/COM_ERROR");
     }
@@ -2166,11 +3324,12 @@ void AutomowerSafe::setParkMode()
 {
     DEBUG_LOG("AutoMowerSafe::parkMower()");
 
-    hcp_tResult result;
+    hcp_tResultStorage response;
+    const hcp_tResult& result = response.result;
     char msg[100];
     snprintf(msg, sizeof(msg), "MowerApp.SetMode(modeOfOperation:%d)",IMOWERAPP_MODE_HOME);
 
-    if (!sendMessage(msg, sizeof(msg), result))
+    if (!sendMessage(msg, sizeof(msg), response))
     {
         eventQueue->raiseEvent("/COM_ERROR");
     }
@@ -2179,11 +3338,12 @@ void AutomowerSafe::setAutoMode()
 {
     DEBUG_LOG("AutoMowerSafe::setAutoMode()");
 
-    hcp_tResult result;
+    hcp_tResultStorage response;
+    const hcp_tResult& result = response.result;
     char msg[100];
     snprintf(msg, sizeof(msg), "MowerApp.SetMode(modeOfOperation:%d)",IMOWERAPP_MODE_AUTO);
 
-    if (!sendMessage(msg, sizeof(msg), result))
+    if (!sendMessage(msg, sizeof(msg), response))
     {
         eventQueue->raiseEvent("/COM_ERROR");
     }
@@ -2192,17 +3352,18 @@ void AutomowerSafe::cutDiscHandling()
 {
     DEBUG_LOG("AutoMowerSafe::cutDiscHandling()");
 
-    hcp_tResult result;
+    hcp_tResultStorage response;
+    const hcp_tResult& result = response.result;
     if (cuttingDiscOn)
     {
         const char* msg = "BladeMotor.On()";
-        if (!sendMessage(msg, sizeof(msg), result))
+        if (!sendMessage(msg, sizeof(msg), response))
         {
             eventQueue->raiseEvent("/COM_ERROR");
             return;
         }
         const char* msg1 = "BladeMotor.Run()";
-        if (!sendMessage(msg1, sizeof(msg1), result))
+        if (!sendMessage(msg1, sizeof(msg1), response))
         {
             eventQueue->raiseEvent("/COM_ERROR");
             return;
@@ -2219,11 +3380,12 @@ void AutomowerSafe::loopDetectionHandling()
 {
     DEBUG_LOG("AutoMowerSafe::loopDetectionHandling()" );
 
-    hcp_tResult result;
+    hcp_tResultStorage response;
+    const hcp_tResult& result = response.result;
 
     char msg[100];
     snprintf(msg, sizeof(msg), "SystemSettings.SetLoopDetection(loopDetection:%d)", requestedLoopOn);
-    if (!sendMessage(msg, sizeof(msg), result))
+    if (!sendMessage(msg, sizeof(msg), response))
     {
         ROS_ERROR("Automower::Failed setting LoopDetection on/off");
         eventQueue->raiseEvent("/COM_ERROR");
@@ -2234,14 +3396,15 @@ void AutomowerSafe::loopDetectionHandling()
 
 void AutomowerSafe::cuttingHeightHandling()
 {
-    hcp_tResult result;
+    hcp_tResultStorage response;
+    const hcp_tResult& result = response.result;
     DEBUG_LOG("AutoMowerSafe::cuttingHeightHandling()" );
     ROS_INFO("Automower::set new cutting height= %d mm", cuttingHeight);
 
     char msg[100];
     snprintf(msg, sizeof(msg), "HeightMotor.SetHeight(height:%d)", cuttingHeight);
 
-    if (!sendMessage(msg, sizeof(msg), result))
+    if (!sendMessage(msg, sizeof(msg), response))
     {
         ROS_ERROR("Automower::Failed setting cutting height.");
         cuttingHeight = lastCuttingHeight;
@@ -2253,11 +3416,12 @@ void AutomowerSafe::cuttingHeightHandling()
 
 void AutomowerSafe::cutDiscOff()
 {
-    hcp_tResult result;
+    hcp_tResultStorage response;
+    const hcp_tResult& result = response.result;
     DEBUG_LOG("AutoMowerSafe::cutDiscOff()" );
 
     const char* msg = "BladeMotor.Brake()";
-    if (!sendMessage(msg, sizeof(msg), result))
+    if (!sendMessage(msg, sizeof(msg), response))
     {
         eventQueue->raiseEvent("/COM_ERROR");
     }
@@ -2266,6 +3430,7 @@ void AutomowerSafe::cutDiscOff()
 
 void AutomowerSafe::newControlMainState(int aNewState)
 {
+    recorder.record(FLIGHT_TRANSITION, "controlState", sensorStatus.controlState, aNewState);
     sensorStatus.controlState = aNewState;
 }
 
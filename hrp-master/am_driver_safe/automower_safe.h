@@ -31,6 +31,20 @@
 
 #include <sys/select.h>
 
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+#include "am_driver_safe/automower_arbiter.h"
+#include "am_driver_safe/automower_capture.h"
+#include "am_driver_safe/automower_recorder.h"
+#include "am_driver_safe/automower_snapshot.h"
+#include "am_driver_safe/automower_standby.h"
+#include "am_driver_safe/automower_startup.h"
+#include "am_driver_safe/automower_serial.h"
 
 #include <hq_decision_making/hq_FSM.h>
 #include <hq_decision_making/hq_ROSTask.h>
@@ -90,12 +104,18 @@ class PidRegulator
 {
 public:
     void Init(double in_p, double in_i, double in_d)
+    {
+        SetGains(in_p, in_i, in_d);
+
+        Restart();
+    }
+
+    // Changes the gains, the accumulated error is kept
+    void SetGains(double in_p, double in_i, double in_d)
     {
         p = in_p;
         i = in_i;
         d = in_d;
-
-        Restart();
     }
 
     void Restart()
@@ -174,8 +194,26 @@ private:
     void modeCallback(const std_msgs::UInt16::ConstPtr& msg);
     
     std::string resultToString(hcp_tResult result);
+    void loadModel();
+    bool waitForModel();
     bool initAutomowerBoard();
-    bool sendMessage(const char* msg, int len, hcp_tResult& result);
+    bool connectSerial();
+    void openSensorSnapshot();
+    void mirrorDriverState();
+    bool watchPrimary();
+    bool takeOver(double silence);
+    void benchmarkSerialLink();
+    bool sendMessage(const char* msg, int len, hcp_tResultStorage& response, int* wireBytes = NULL);
+    bool queryMessage(const char* msg, hcp_tResult& result);
+    void reportResponseCache();
+    void reportSerialQueue();
+    void dumpFlightRecorder(const char* reason);
+    void publishSensorSnapshot();
+    hcp_tCodec* getHcpSession();
+    int readSerial(hcp_Uint8* buf, int maxLen, const ros::WallTime& deadline);
+    void discardLateResponses();
+    double getCommandTimeout(const char* msg) const;
+    void handleResponseTimeout(hcp_tCodec* session, const char* msg, double timeout);
     void imuResetCallback(const geometry_msgs::Pose::ConstPtr& msg);
     void regulateVelocity();
     void setPower();
@@ -192,6 +230,15 @@ private:
     bool getBatteryData();
 
     bool isTimeOut(ros::Duration elapsedTime, double frequency);
+    void adaptPollingRates();
+    double measureCommandCost(const char* const* commands);
+    void checkSerialBudget();
+    void calibrateSerialLink();
+    bool isMoving() const;
+    void reportStartup();
+    void refillSerialBudget();
+    bool admitPoll(double cost);
+    void tuneWheelPids(double frequency);
 
     bool executeTifCommand(am_driver_safe::TifCmd::Request& req,
                                       am_driver_safe::TifCmd::Response& res);
@@ -243,6 +290,43 @@ private:
     double pitchRollFreq;
     double sensorStatusCheckFreq;
 
+    // Rates update() polls with. The configured rates above, or with
+    // adaptivePolling lowered for signals the current mode does not need
+    // and the serial exchanges freed given to the regulator.
+    typedef struct
+    {
+        double wheelSensor;
+        double encoderSensor;
+        double regulator;
+        double state;
+        double loop;
+        double pitchRoll;
+        double battery;
+        double GPS;
+        double status;
+    } PollingRates;
+    bool adaptivePolling;
+    double regulatorMaxFreq;
+    PollingRates pollingRates;
+    bool pollingMoving;
+    double tunedRegulatorFreq;
+    ros::Time nextStatusDetailTime;
+
+    // Serial bandwidth budget. The wheel commands (regulator and the wheel
+    // speed it regulates on), the safety status and the mower state have
+    // their share of the link reserved, the other getters take link time
+    // from a token bucket refilled with the rest of serialBudgetShare.
+    bool serialBudget;
+    double serialBudgetShare;
+    bool serialBudgetScale;
+    PollingRates pollingCosts;      // seconds of link time per getter call
+    double budgetRate;              // link seconds per second, 0 if not enforced
+    double budgetCapacity;
+    double budgetTokens;
+    ros::WallTime budgetRefillTime;
+    unsigned long budgetDeferred;
+    double budgetReportTime;
+
     ros::Duration timeSinceWheelSensor;
     ros::Duration timeSinceEncoderSensor;
     ros::Duration timeSinceRegulator;
@@ -281,6 +365,13 @@ private:
     std::string pSerialPort;
     bool serialComTest;
     bool serialLog;
+    std::string serialLogPath;
+    int serialLogFileSize;
+    int serialLogFiles;
+    bool flightRecorder;
+    int flightRecorderSize;
+    std::string flightRecorderPath;
+    std::string sensorSnapshotName;
 
     // Mower parameters (treated as const, that is why capital letters...sorry)
     double WHEEL_DIAMETER;
@@ -290,6 +381,23 @@ private:
 
     // Serial port handle
     int serialFd;
+    SerialConfig serialConfig;
+    int serialBenchmarkSamples;
+    bool serialBenchmarkDone;
+    int serialCalibrationStep;
+    bool isStartupReported;
+
+    // Response deadlines (seconds), default and per "Family.Command"
+    double responseTimeout;
+    std::map<std::string, double> commandTimeouts;
+    int maxConsecutiveTimeouts;
+
+    // Response timeout statistics
+    int consecutiveTimeouts;
+    bool awaitingLateResponse;
+    unsigned long responseTimeoutCount;
+    unsigned long lateResponseCount;
+    unsigned long discardedBytes;
 
     // Serial port state
     int serialPortState;
@@ -329,9 +437,68 @@ private:
     hcp_tState* hcpState;
     tCodecSet hcpCodecs;
     std::string jsonFile;
-    hcp_Size_t codecId;
+    char codecName[5];
     hcp_Int modelId;
 
+    // The model is loaded by modelLoader while ROS and the serial port are
+    // set up, the first session of each thread waits for it
+    std::thread modelLoader;
+    std::mutex modelMutex;
+    std::condition_variable modelCondition;
+    bool isModelLoaded;
+    bool isModelValid;
+
+    // The state only holds the loaded model. Every thread that talks to the
+    // mower encodes and decodes with its own session, responses are decoded
+    // into storage owned by the caller of sendMessage. The sessions are
+    // kept until the destructor, which closes them before the state; a
+    // thread started later with the id of a finished one reuses its session.
+    std::mutex hcpSessionMutex;
+    std::map<std::thread::id, hcp_tCodec*> hcpSessions;
+    // Serialises the request/response exchanges on the serial link, the
+    // waiting threads are served by the class of their command
+    SerialArbiter serialArbiter;
+    double serialMaxQueueWait;
+    double serialQueueReportTime;
+    // Raw serial traffic, recorded while owning the serial link
+    WireCapture serialCapture;
+    // Latest commands, responses, sensor values, regulator outputs and state
+    // changes, written to disk on communication errors, user stops and fatal
+    // signals
+    FlightRecorder recorder;
+    int flightDumpCount;
+    double lastFlightDumpTime;
+    bool lastUserStopPressed;
+    // Latest sensor values for processes on the same machine, published
+    // by the primary after the ROS messages of every update with new data
+    SnapshotPublisher snapshotPublisher;
+    SensorSnapshot sensorSnapshot;
+    // Hot standby. The primary mirrors its state every update and beats
+    // after every exchange with the mower, a standby keeps the model loaded
+    // without the serial port and takes over when the heartbeat is older
+    // than standbyTimeout.
+    std::string stateMirrorName;
+    bool standby;
+    double standbyTimeout;
+    StateMirror stateMirror;
+    DriverState mirroredState;
+    bool isMirrorLive;
+
+    // Responses of read-only commands, by TIF string. A command is sent at
+    // most once per update() tick, later getters in the same tick read the
+    // cached response. Only used from the thread calling update().
+    typedef struct
+    {
+        hcp_tResultStorage response;
+        unsigned long tick;
+        int wireBytes;          // request and response, as sent and received
+    } CachedResponse;
+    std::map<std::string, CachedResponse> responseCache;
+    unsigned long responseCacheTick;
+    unsigned long responseCacheHits;
+    unsigned long responseCacheSavedBytes;
+    double responseCacheReportTime;
+
     PidRegulator leftWheelPid;
     PidRegulator rightWheelPid;
 
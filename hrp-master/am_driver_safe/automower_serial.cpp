@@ -0,0 +1,196 @@
+/*
+ * automower_serial.cpp
+ *
+ *  Serial link setup for the Automower HRP interface.
+ */
+
+#include "am_driver_safe/automower_serial.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/serial.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <fstream>
+
+namespace Husqvarna
+{
+
+SerialConfig defaultSerialConfig()
+{
+    SerialConfig config;
+    config.baudRate = 115200;
+    config.hardwareFlowControl = false;
+    config.lowLatency = true;
+    config.usbLatencyTimer = 1;
+    return config;
+}
+
+speed_t baudRateToSpeed(int baudRate)
+{
+    switch (baudRate)
+    {
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+    case 460800:  return B460800;
+    case 921600:  return B921600;
+    default:      return 0;
+    }
+}
+
+int openSerialPort(const std::string& port, const SerialConfig& config)
+{
+    speed_t speed = baudRateToSpeed(config.baudRate);
+    if (speed == 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = open(port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    /* exclusive, another open() fails with EBUSY until this fd is closed */
+    if (ioctl(fd, TIOCEXCL) < 0)
+    {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    struct termios term;
+    memset(&term, 0, sizeof(term));
+
+    /* raw 8N1, see man termios */
+    cfsetospeed(&term, speed);
+    cfsetispeed(&term, speed);
+
+    term.c_cflag |= (CLOCAL | CREAD);    /* ignore modem controls */
+    term.c_cflag &= ~CSIZE;
+    term.c_cflag |= CS8;         /* 8-bit characters */
+    term.c_cflag &= ~PARENB;     /* no parity bit */
+    term.c_cflag &= ~CSTOPB;     /* only need 1 stop bit */
+    if (config.hardwareFlowControl)
+    {
+        term.c_cflag |= CRTSCTS;
+    }
+    else
+    {
+        term.c_cflag &= ~CRTSCTS;
+    }
+
+    /* setup for non-canonical mode */
+    term.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON);
+    term.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+    term.c_oflag &= ~OPOST;
+
+    /* never block in read(), callers wait for data with poll() */
+    term.c_cc[VMIN] = 0;
+    term.c_cc[VTIME] = 0;
+
+    tcflush(fd, TCIOFLUSH);
+    if (tcsetattr(fd, TCSANOW, &term) < 0)
+    {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    if (config.lowLatency)
+    {
+        // Not fatal, not every tty driver implements TIOCSSERIAL
+        setSerialLowLatency(fd, true);
+    }
+
+    return fd;
+}
+
+bool setSerialLowLatency(int fd, bool enable)
+{
+    struct serial_struct serinfo;
+    if (ioctl(fd, TIOCGSERIAL, &serinfo) < 0)
+    {
+        return false;
+    }
+
+    if (enable)
+    {
+        serinfo.flags |= ASYNC_LOW_LATENCY;
+    }
+    else
+    {
+        serinfo.flags &= ~ASYNC_LOW_LATENCY;
+    }
+
+    return ioctl(fd, TIOCSSERIAL, &serinfo) == 0;
+}
+
+static std::string latencyTimerPath(const std::string& port)
+{
+    // Resolve links such as /dev/serial/by-id/... to the real ttyUSBx
+    char resolved[PATH_MAX];
+    if (realpath(port.c_str(), resolved) == NULL)
+    {
+        return "";
+    }
+
+    std::string name(resolved);
+    std::string::size_type slash = name.find_last_of('/');
+    if (slash != std::string::npos)
+    {
+        name = name.substr(slash + 1);
+    }
+
+    return "/sys/bus/usb-serial/devices/" + name + "/latency_timer";
+}
+
+bool setUsbLatencyTimer(const std::string& port, int milliseconds)
+{
+    std::string path = latencyTimerPath(port);
+    if (path.empty() || (access(path.c_str(), F_OK) != 0))
+    {
+        return false;
+    }
+
+    std::ofstream file(path.c_str());
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file << milliseconds << std::endl;
+
+    return file.good() && (getUsbLatencyTimer(port) == milliseconds);
+}
+
+int getUsbLatencyTimer(const std::string& port)
+{
+    std::string path = latencyTimerPath(port);
+    if (path.empty())
+    {
+        return -1;
+    }
+
+    std::ifstream file(path.c_str());
+    int value = -1;
+    if (!(file >> value))
+    {
+        return -1;
+    }
+
+    return value;
+}
+
+}
@@ -0,0 +1,47 @@
+/*
+ * automower_serial.h
+ *
+ *  Serial link setup for the Automower HRP interface. Free from ROS, as
+ *  opendlv-device-hedgehog opens its serial ports with it too.
+ */
+
+#ifndef AUTOMOWER_SERIAL_H
+#define AUTOMOWER_SERIAL_H
+
+#include <string>
+#include <termios.h>
+
+namespace Husqvarna
+{
+
+typedef struct
+{
+    int baudRate;               // in bits/s, e.g. 115200
+    bool hardwareFlowControl;   // RTS/CTS
+    bool lowLatency;            // ASYNC_LOW_LATENCY on the tty driver
+    int usbLatencyTimer;        // ms, only for usb-serial adapters, <= 0 leaves it untouched
+} SerialConfig;
+
+// Default configuration, matches what the mower board expects
+SerialConfig defaultSerialConfig();
+
+// Returns the termios speed for a baud rate or 0 if not supported
+speed_t baudRateToSpeed(int baudRate);
+
+// Opens the port non-blocking in raw 8N1 mode and exclusive (TIOCEXCL, a
+// second open fails with EBUSY unless by root). Returns the fd or -1 (errno set).
+int openSerialPort(const std::string& port, const SerialConfig& config);
+
+// Sets or clears ASYNC_LOW_LATENCY, returns false if the driver refuses
+bool setSerialLowLatency(int fd, bool enable);
+
+// Writes the usb-serial latency timer in sysfs, returns false if the
+// port has no such setting (e.g. ttyACM) or it cannot be written
+bool setUsbLatencyTimer(const std::string& port, int milliseconds);
+
+// Reads back the usb-serial latency timer, -1 if not available
+int getUsbLatencyTimer(const std::string& port);
+
+}
+
+#endif
@@ -0,0 +1,237 @@
+/*
+ * automower_snapshot.cpp
+ *
+ *  Latest sensor values of the Automower HRP driver in POSIX shared memory.
+ */
+
+#include "am_driver_safe/automower_snapshot.h"
+#include "am_driver_safe/automower_internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace Husqvarna
+{
+
+namespace
+{
+
+// Not FUTEX_PRIVATE_FLAG, waiters are in other processes
+long futex(std::atomic<uint32_t>* word, int operation, uint32_t value, const struct timespec* timeout)
+{
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), operation, value, timeout, NULL, 0);
+}
+
+SensorSnapshotRegion* mapRegion(int fd, int protection)
+{
+    void* memory = mmap(NULL, sizeof(SensorSnapshotRegion), protection, MAP_SHARED, fd, 0);
+    ::close(fd);
+    return (memory == MAP_FAILED) ? NULL : static_cast<SensorSnapshotRegion*>(memory);
+}
+
+}
+
+SnapshotPublisher::SnapshotPublisher()
+    : region(NULL)
+    , isCreator(false)
+{
+}
+
+SnapshotPublisher::~SnapshotPublisher()
+{
+    close();
+}
+
+bool SnapshotPublisher::open(const std::string& objectName)
+{
+    close();
+
+    isCreator = true;
+    int fd = shm_open(objectName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if ((fd < 0) && (errno == EEXIST))
+    {
+        // Left by a former publisher, e.g. the primary a standby took over from
+        isCreator = false;
+        fd = shm_open(objectName.c_str(), O_RDWR, 0);
+    }
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if ((fstat(fd, &info) != 0) ||
+        ((info.st_size < (off_t)sizeof(SensorSnapshotRegion)) && (ftruncate(fd, sizeof(SensorSnapshotRegion)) != 0)))
+    {
+        ::close(fd);
+        return false;
+    }
+    region = mapRegion(fd, PROT_READ | PROT_WRITE);
+    if (region == NULL)
+    {
+        return false;
+    }
+    name = objectName;
+
+    // Readers of a region set up for this version go on with its sequence
+    // and the waiters they registered
+    if ((region->magic == SENSOR_SNAPSHOT_MAGIC) && (region->version == SENSOR_SNAPSHOT_VERSION) &&
+        (region->size == sizeof(SensorSnapshot)))
+    {
+        return true;
+    }
+
+    // Readers check the version last, so they never see a half set up region
+    region->version = 0;
+    region->magic = SENSOR_SNAPSHOT_MAGIC;
+    region->size = sizeof(SensorSnapshot);
+    region->sequence.store(0, std::memory_order_relaxed);
+    region->waiters.store(0, std::memory_order_relaxed);
+    memset(&region->snapshot, 0, sizeof(region->snapshot));
+    std::atomic_thread_fence(std::memory_order_release);
+    region->version = SENSOR_SNAPSHOT_VERSION;
+    return true;
+}
+
+void SnapshotPublisher::close()
+{
+    if (region != NULL)
+    {
+        munmap(region, sizeof(SensorSnapshotRegion));
+        if (isCreator)
+        {
+            shm_unlink(name.c_str());
+        }
+        region = NULL;
+    }
+}
+
+bool SnapshotPublisher::isOpen() const
+{
+    return region != NULL;
+}
+
+void SnapshotPublisher::publish(const SensorSnapshot& snapshot)
+{
+    if (region == NULL)
+    {
+        return;
+    }
+
+    // Odd if the previous publisher died while writing
+    const uint32_t sequence = region->sequence.load(std::memory_order_relaxed) | 1;
+    region->sequence.store(sequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy(&region->snapshot, &snapshot, sizeof(snapshot));
+    region->snapshot.timestamp = monotonicNow();
+
+    // Sequentially consistent with the waiter count, a reader that
+    // registers after this store sees the new sequence and does not sleep
+    region->sequence.store(sequence + 1, std::memory_order_seq_cst);
+
+    // The system call is only paid for while someone is waiting
+    if (region->waiters.load(std::memory_order_seq_cst) > 0)
+    {
+        futex(&region->sequence, FUTEX_WAKE, INT_MAX, NULL);
+    }
+}
+
+SnapshotReader::SnapshotReader()
+    : region(NULL)
+{
+}
+
+SnapshotReader::~SnapshotReader()
+{
+    close();
+}
+
+bool SnapshotReader::open(const std::string& objectName)
+{
+    close();
+
+    // Read-write for the waiter count, the snapshot itself is never written
+    int fd = shm_open(objectName.c_str(), O_RDWR, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if ((fstat(fd, &info) != 0) || (info.st_size < (off_t)sizeof(SensorSnapshotRegion)))
+    {
+        ::close(fd);
+        return false;
+    }
+    region = mapRegion(fd, PROT_READ | PROT_WRITE);
+    if (region == NULL)
+    {
+        return false;
+    }
+
+    if ((region->magic != SENSOR_SNAPSHOT_MAGIC) || (region->version != SENSOR_SNAPSHOT_VERSION) ||
+        (region->size != sizeof(SensorSnapshot)))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SnapshotReader::close()
+{
+    if (region != NULL)
+    {
+        munmap(region, sizeof(SensorSnapshotRegion));
+        region = NULL;
+    }
+}
+
+uint32_t SnapshotReader::read(SensorSnapshot& snapshot) const
+{
+    if (region == NULL)
+    {
+        return 0;
+    }
+
+    uint32_t sequence = 0;
+    return seqlockRead(region->sequence, &snapshot, &region->snapshot, sizeof(snapshot), sequence) ? sequence : 0;
+}
+
+bool SnapshotReader::wait(uint32_t sequence, int timeoutMs) const
+{
+    if (region == NULL)
+    {
+        return false;
+    }
+
+    struct timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+
+    region->waiters.fetch_add(1, std::memory_order_seq_cst);
+    uint32_t current = region->sequence.load(std::memory_order_seq_cst);
+    while ((current == sequence) || (current & 1))
+    {
+        // Returns at once if the word changed since it was loaded
+        if ((futex(&region->sequence, FUTEX_WAIT, current, &timeout) != 0) && (errno == ETIMEDOUT))
+        {
+            break;
+        }
+        current = region->sequence.load(std::memory_order_seq_cst);
+    }
+    region->waiters.fetch_sub(1, std::memory_order_seq_cst);
+
+    return (current != sequence) && !(current & 1);
+}
+
+}
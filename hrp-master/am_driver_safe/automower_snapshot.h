@@ -0,0 +1,135 @@
+/*
+ * automower_snapshot.h
+ *
+ *  Latest sensor values of the Automower HRP driver in POSIX shared memory,
+ *  for consumers on the same machine that do not want to go through the
+ *  middleware. One writer publishes a SensorSnapshot per update, readers
+ *  copy the latest one under a sequence lock and can block on the sequence
+ *  word as a futex until the next one arrives.
+ *
+ *  Bump SENSOR_SNAPSHOT_VERSION whenever SensorSnapshot changes, readers
+ *  refuse regions with another version.
+ */
+
+#ifndef AUTOMOWER_SNAPSHOT_H
+#define AUTOMOWER_SNAPSHOT_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+namespace Husqvarna
+{
+
+#define SENSOR_SNAPSHOT_MAGIC (0x53534d41)     // "AMSS"
+#define SENSOR_SNAPSHOT_VERSION (1)
+
+typedef struct
+{
+    uint64_t timestamp;         // CLOCK_MONOTONIC in ns when published
+    uint64_t update;            // number of the publishing update, starts at 1
+
+    // Odometry in the odom frame
+    double x;                   // m
+    double y;                   // m
+    double yaw;                 // rad
+    double linearVelocity;      // m/s
+    double angularVelocity;     // rad/s
+    double pitch;               // rad, nose down positive
+    double roll;                // rad
+
+    // Wheels, left and right
+    double leftSpeed;           // m/s
+    double rightSpeed;          // m/s
+    int32_t leftCurrent;        // mA
+    int32_t rightCurrent;       // mA
+    int32_t leftPulses;         // accumulated encoder pulses
+    int32_t rightPulses;
+    int32_t leftPower;          // as sent, -100..100
+    int32_t rightPower;
+
+    // Loop signals at the front center sensor, A0, F and N channel
+    int32_t loopA;
+    int32_t loopF;
+    int32_t loopN;
+
+    // Batteries
+    int32_t batteryAVoltage;    // mV
+    int32_t batteryACurrent;    // mA
+    int32_t batteryBVoltage;    // mV
+    int32_t batteryBCurrent;    // mA
+
+    uint32_t sensorStatus;      // HVA_SS_* bits
+    uint32_t controlState;      // AM_STATE_*
+    uint32_t mowerState;        // IMOWERAPP_STATE_*
+} SensorSnapshot;
+
+// Layout of the shared memory object
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                      // sizeof(SensorSnapshot)
+    std::atomic<uint32_t> sequence;     // odd while written, futex word
+    std::atomic<uint32_t> waiters;      // readers blocked in wait()
+    uint32_t reserved;
+    SensorSnapshot snapshot;
+} SensorSnapshotRegion;
+
+class SnapshotPublisher
+{
+public:
+    SnapshotPublisher();
+    ~SnapshotPublisher();
+
+    // Creates or takes over the shared memory object, e.g. "/am_driver_safe_sensors".
+    // A region of this version keeps its snapshot and sequence, there must
+    // be no other live publisher.
+    bool open(const std::string& name);
+    // Unmaps, and removes the object if this publisher created it
+    void close();
+
+    bool isOpen() const;
+
+    // Only one thread may publish, readers never block it
+    void publish(const SensorSnapshot& snapshot);
+
+private:
+    SnapshotPublisher(const SnapshotPublisher&);
+    SnapshotPublisher& operator=(const SnapshotPublisher&);
+
+    std::string name;
+    SensorSnapshotRegion* region;
+    bool isCreator;
+};
+
+class SnapshotReader
+{
+public:
+    SnapshotReader();
+    ~SnapshotReader();
+
+    // Fails if the object does not exist or has another version
+    bool open(const std::string& name);
+    void close();
+
+    // Copies the latest snapshot. Returns its sequence number, 0 if
+    // nothing was published yet, or if it is being written or was left half
+    // written by a publisher that died.
+    uint32_t read(SensorSnapshot& snapshot) const;
+
+    // Blocks until a snapshot newer than sequence is published. Returns
+    // false on timeout.
+    bool wait(uint32_t sequence, int timeoutMs) const;
+
+private:
+    SnapshotReader(const SnapshotReader&);
+    SnapshotReader& operator=(const SnapshotReader&);
+
+    SensorSnapshotRegion* region;
+};
+
+}
+
+#endif
@@ -0,0 +1,155 @@
+/*
+ * automower_standby.cpp
+ *
+ *  State of the Automower HRP driver mirrored in POSIX shared memory.
+ */
+
+#include "am_driver_safe/automower_standby.h"
+#include "am_driver_safe/automower_internal.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace Husqvarna
+{
+
+StateMirror::StateMirror()
+    : region(NULL)
+{
+}
+
+StateMirror::~StateMirror()
+{
+    close();
+}
+
+bool StateMirror::open(const std::string& objectName)
+{
+    close();
+
+    int fd = shm_open(objectName.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    // A new object is zero filled, an existing one keeps the state of its driver
+    struct stat info;
+    if ((fstat(fd, &info) != 0) ||
+        ((info.st_size < (off_t)sizeof(DriverStateRegion)) && (ftruncate(fd, sizeof(DriverStateRegion)) != 0)))
+    {
+        ::close(fd);
+        return false;
+    }
+    void* memory = mmap(NULL, sizeof(DriverStateRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+        return false;
+    }
+    region = static_cast<DriverStateRegion*>(memory);
+
+    if (region->magic == 0)
+    {
+        // Both drivers may get here at once, they write the same values
+        region->version = DRIVER_MIRROR_VERSION;
+        region->size = sizeof(DriverState);
+        std::atomic_thread_fence(std::memory_order_release);
+        region->magic = DRIVER_MIRROR_MAGIC;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((region->magic != DRIVER_MIRROR_MAGIC) || (region->version != DRIVER_MIRROR_VERSION) ||
+        (region->size != sizeof(DriverState)))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void StateMirror::close()
+{
+    if (region != NULL)
+    {
+        munmap(region, sizeof(DriverStateRegion));
+        region = NULL;
+    }
+}
+
+bool StateMirror::isOpen() const
+{
+    return region != NULL;
+}
+
+void StateMirror::write(const DriverState& state)
+{
+    if (region == NULL)
+    {
+        return;
+    }
+
+    // Odd if the previous writer died while writing
+    const uint32_t sequence = region->sequence.load(std::memory_order_relaxed) | 1;
+    region->sequence.store(sequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy(&region->state, &state, sizeof(state));
+    region->state.primaryPid = (int32_t)getpid();
+
+    region->sequence.store(sequence + 1, std::memory_order_release);
+    region->heartbeat.store(monotonicNow(), std::memory_order_release);
+}
+
+void StateMirror::beat()
+{
+    if (region == NULL)
+    {
+        return;
+    }
+
+    // Fails against a concurrent release, which wins
+    uint64_t last = region->heartbeat.load(std::memory_order_relaxed);
+    if (last != 0)
+    {
+        region->heartbeat.compare_exchange_strong(last, monotonicNow(), std::memory_order_release);
+    }
+}
+
+void StateMirror::release()
+{
+    if (region == NULL)
+    {
+        return;
+    }
+
+    region->heartbeat.store(0, std::memory_order_release);
+}
+
+bool StateMirror::read(DriverState& state) const
+{
+    if (region == NULL)
+    {
+        return false;
+    }
+
+    uint32_t sequence = 0;
+    return seqlockRead(region->sequence, &state, &region->state, sizeof(state), sequence);
+}
+
+uint64_t StateMirror::heartbeat() const
+{
+    return (region != NULL) ? region->heartbeat.load(std::memory_order_acquire) : 0;
+}
+
+uint64_t StateMirror::heartbeatAge(uint64_t heartbeat)
+{
+    const uint64_t now = monotonicNow();
+    return (now > heartbeat) ? now - heartbeat : 0;
+}
+
+}
@@ -0,0 +1,101 @@
+/*
+ * automower_standby.h
+ *
+ *  State of the Automower HRP driver mirrored in POSIX shared memory, so that
+ *  a second driver process can stand by with the model loaded and take over
+ *  the serial port when the primary stops. The primary writes its heartbeat,
+ *  odometry and modes every update, the standby copies them under a sequence
+ *  lock and watches the heartbeat. The heartbeat is kept apart from the state,
+ *  so that every thread talking to the mower can refresh it.
+ *
+ *  The object is not removed when a driver exits, a crashed primary leaves
+ *  its last state behind for the standby. Bump DRIVER_MIRROR_VERSION whenever
+ *  DriverState changes.
+ */
+
+#ifndef AUTOMOWER_STANDBY_H
+#define AUTOMOWER_STANDBY_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+namespace Husqvarna
+{
+
+#define DRIVER_MIRROR_MAGIC (0x534d4d41)     // "AMMS"
+#define DRIVER_MIRROR_VERSION (2)
+
+typedef struct
+{
+    int32_t primaryPid;
+    uint32_t controlState;      // AM_STATE_*
+    uint32_t requestedState;    // AM_STATE_*
+    uint32_t cuttingDiscOn;
+    uint32_t cuttingHeight;     // mm
+    uint32_t loopOn;
+
+    // Odometry in the odom frame, as integrated by the primary
+    double x;                   // m
+    double y;                   // m
+    double yaw;                 // rad
+    double lastYaw;             // rad
+    int32_t leftPulses;         // accumulated encoder pulses, latest read
+    int32_t rightPulses;
+    int32_t lastLeftPulses;     // accumulated encoder pulses, integrated
+    int32_t lastRightPulses;
+} DriverState;
+
+// Layout of the shared memory object
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                      // sizeof(DriverState)
+    std::atomic<uint32_t> sequence;     // odd while written
+    std::atomic<uint64_t> heartbeat;    // CLOCK_MONOTONIC in ns, 0 while nobody drives the mower
+    DriverState state;
+} DriverStateRegion;
+
+class StateMirror
+{
+public:
+    StateMirror();
+    ~StateMirror();
+
+    // Maps the object, e.g. "/am_driver_safe_state", creating it if missing.
+    // Fails if it holds another version.
+    bool open(const std::string& name);
+    // Unmaps, the object stays
+    void close();
+
+    bool isOpen() const;
+
+    // Primary only, from one thread. Stamps the heartbeat and the pid.
+    void write(const DriverState& state);
+    // Primary only, from any thread, e.g. after each exchange with the mower.
+    // Refreshes the heartbeat unless it was released.
+    void beat();
+    // Clears the heartbeat, a standby then does not take over
+    void release();
+
+    // Copies the latest state. Returns false if it is being written, or was
+    // left half written by a primary that died.
+    bool read(DriverState& state) const;
+
+    // CLOCK_MONOTONIC in ns of the latest heartbeat, 0 if released
+    uint64_t heartbeat() const;
+    // ns since heartbeat
+    static uint64_t heartbeatAge(uint64_t heartbeat);
+
+private:
+    StateMirror(const StateMirror&);
+    StateMirror& operator=(const StateMirror&);
+
+    DriverStateRegion* region;
+};
+
+}
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * automower_startup.cpp
+ *
+ *  Startup tracing for the Automower HRP driver.
+ */
+
+#include "am_driver_safe/automower_startup.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace Husqvarna
+{
+
+namespace
+{
+
+uint64_t bootTimeNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Field 22 of /proc/self/stat, in clock ticks since boot
+bool processStartTime(uint64_t& start)
+{
+    FILE* file = fopen("/proc/self/stat", "r");
+    if (file == NULL)
+    {
+        return false;
+    }
+    char line[1024];
+    const bool isRead = (fgets(line, sizeof(line), file) != NULL);
+    fclose(file);
+
+    // The command name may contain spaces, count fields after its ')'
+    const char* field = isRead ? strrchr(line, ')') : NULL;
+    if (field == NULL)
+    {
+        return false;
+    }
+    for (int i = 2; (i < 22) && (field != NULL); i++)
+    {
+        field = strchr(field + 1, ' ');
+    }
+    unsigned long long ticks;
+    if ((field == NULL) || (sscanf(field, " %llu", &ticks) != 1))
+    {
+        return false;
+    }
+
+    start = (uint64_t)ticks * 1000000000ULL / (uint64_t)sysconf(_SC_CLK_TCK);
+    return true;
+}
+
+bool isEarlier(const StartupPhase& a, const StartupPhase& b)
+{
+    return a.begin < b.begin;
+}
+
+}
+
+StartupTrace& StartupTrace::instance()
+{
+    static StartupTrace trace;
+    return trace;
+}
+
+StartupTrace::StartupTrace()
+{
+    if (!processStartTime(origin) || (origin > bootTimeNow()))
+    {
+        origin = bootTimeNow();
+    }
+}
+
+uint64_t StartupTrace::now() const
+{
+    return bootTimeNow() - origin;
+}
+
+void StartupTrace::begin(const char* phase)
+{
+    StartupPhase entry;
+    entry.name = phase;
+    entry.begin = now();
+    entry.end = 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.push_back(entry);
+}
+
+void StartupTrace::end(const char* phase)
+{
+    const uint64_t time = now();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::vector<StartupPhase>::reverse_iterator it = entries.rbegin(); it != entries.rend(); ++it)
+    {
+        if ((it->end == 0) && (strcmp(it->name, phase) == 0))
+        {
+            it->end = time;
+            return;
+        }
+    }
+}
+
+void StartupTrace::mark(const char* event)
+{
+    StartupPhase entry;
+    entry.name = event;
+    entry.begin = now();
+    entry.end = entry.begin;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.push_back(entry);
+}
+
+std::vector<StartupPhase> StartupTrace::phases() const
+{
+    std::vector<StartupPhase> sorted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sorted = entries;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), isEarlier);
+    return sorted;
+}
+
+StartupScope::StartupScope(const char* name)
+    : phase(name)
+{
+    StartupTrace::instance().begin(phase);
+}
+
+StartupScope::~StartupScope()
+{
+    StartupTrace::instance().end(phase);
+}
+
+}
@@ -0,0 +1,75 @@
+/*
+ * automower_startup.h
+ *
+ *  Startup tracing for the Automower HRP driver. The node and the driver
+ *  note when each initialisation phase begins and ends, from whatever thread
+ *  runs it, and the trace is reported once the first wheel command is sent.
+ *  Times are since the start of the process as given by the kernel (10 ms
+ *  resolution), so the loading of the shared libraries is included.
+ */
+
+#ifndef AUTOMOWER_STARTUP_H
+#define AUTOMOWER_STARTUP_H
+
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Husqvarna
+{
+
+typedef struct
+{
+    const char* name;           // string literal
+    uint64_t begin;             // ns since process start
+    uint64_t end;               // 0 while running, == begin for a mark
+} StartupPhase;
+
+class StartupTrace
+{
+public:
+    // One trace per process, shared by the node and the driver
+    static StartupTrace& instance();
+
+    // Thread-safe. Names must be string literals, a phase is identified by
+    // its name.
+    void begin(const char* phase);
+    void end(const char* phase);
+    // A point in time, e.g. "first wheel command"
+    void mark(const char* event);
+
+    // ns since process start
+    uint64_t now() const;
+
+    // Phases ordered by their begin
+    std::vector<StartupPhase> phases() const;
+
+private:
+    StartupTrace();
+    StartupTrace(const StartupTrace&);
+    StartupTrace& operator=(const StartupTrace&);
+
+    uint64_t origin;            // CLOCK_BOOTTIME of the process start
+    mutable std::mutex mutex;
+    std::vector<StartupPhase> entries;
+};
+
+// Traces the enclosing scope as one phase
+class StartupScope
+{
+public:
+    explicit StartupScope(const char* name);
+    ~StartupScope();
+
+private:
+    StartupScope(const StartupScope&);
+    StartupScope& operator=(const StartupScope&);
+
+    const char* phase;
+};
+
+}
+
+#endif
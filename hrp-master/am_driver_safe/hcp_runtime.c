@@ -121,6 +121,33 @@ struct hcp_tState {
 	 * \param	pDest	[IN]	Object to map.
 	 */
 	static void hcp_InitializeRuntime(hcp_tState* pState, hcp_tRuntime* pDest);
+	/** Finds the codec library and model for a new codec.
+	 *--------------------------------------------------------
+	 * \param	pState	[IN]	State where the library and model exist.
+	 * \param	Codec	[IN]	Name of the codec library.
+	 * \param	ModelId	[IN]	Id of the model.
+	 * \param	ppLibrary	[OUT]	Found library.
+	 * \param	ppModel	[OUT]	Found model.
+	 */
+	static hcp_Int hcp_FindCodecParts(hcp_tState* pState, hcp_cszStr Codec, const hcp_Size_t ModelId, hcp_tCodecLibrary** ppLibrary, hcp_tModel** ppModel);
+	/** Sets up a codec object.
+	 *--------------------------------------------------------
+	 * \par	Description:
+	 *		Binds a zeroed codec to a library and a model and creates\n
+	 *		its own command set and library context.
+	 *
+	 * \param	pState	[IN]	State where the library and model exist.
+	 * \param	pLibrary	[IN]	Codec library to use.
+	 * \param	pModel	[IN]	Model to create the commands from.
+	 * \param	pCodec	[OUT]	Codec to set up.
+	 */
+	static hcp_Int hcp_SetupCodec(hcp_tState* pState, hcp_tCodecLibrary* pLibrary, hcp_tModel* pModel, hcp_tCodec* pCodec);
+	/** Releases the command set owned by a codec.
+	 *--------------------------------------------------------
+	 * \param	pState	[IN]	State which allocated the commands.
+	 * \param	pCommands	[IN]	Command set to release.
+	 */
+	static void hcp_ReleaseCommands(hcp_tState* pState, hcp_tCommandSet* pCommands);
 	/** Compares two codecs objects for equality.
 	 *--------------------------------------------------------
 	 * \par	Description:
@@ -271,6 +298,7 @@ hcp_Int hcp_CloseState(hcp_tState* pState) {
 			hcp_Size_t index = pState->codecs.header.length - 1;
 
 			do {
+				hcp_ReleaseCommands(pState, &((hcp_tCodec*)hcp_ValueAt(&pState->codecs.header, index))->commands);
 				hcp_Pop(&pState->codecs.header, index);
 			} while (index-- != 0);
 		}
@@ -314,12 +342,89 @@ hcp_Int hcp_CloseCodec(hcp_tState* pState, const hcp_Size_t Id) {
 			return HCP_INVALIDID;
 		}
 
+		hcp_ReleaseCommands(pState, &((hcp_tCodec*)hcp_ValueAt(&pState->codecs.header, index))->commands);
 		hcp_Pop(&pState->codecs.header, index);
 	}
 
 	return HCP_NOERROR;
 }
 
+hcp_Int hcp_ResetCodec(hcp_tState* pState, const hcp_Size_t Id) {
+	if (pState == HCP_NULL) {
+		return HCP_INVALIDSTATE;
+	}
+
+	hcp_Int error = HCP_NOERROR;
+
+	// locked region
+	{
+		hcp_Boolean found = HCP_FALSE;
+		hcp_Size_t index = hcp_FindFirst(&pState->codecs.header, 0, (void*)Id, &found);
+
+		if (found == HCP_FALSE) {
+			return HCP_INVALIDID;
+		}
+
+		error = hcp_ResetSession((hcp_tCodec*)hcp_ValueAt(&pState->codecs.header, index));
+	}
+
+	return error;
+}
+
+hcp_Int hcp_ResetSession(hcp_tCodec* pSession) {
+	if (pSession == HCP_NULL || pSession->parent == HCP_NULL) {
+		return HCP_INVALIDID;
+	}
+
+	// the library setup brings the codec context (receive buffer etc.) back
+	// to the same state as right after the codec was created
+	if (pSession->library->setup != HCP_NULL) {
+		return pSession->library->setup(&pSession->parent->runtime, &pSession->context);
+	}
+
+	return HCP_NOERROR;
+}
+
+hcp_Int hcp_OpenSession(hcp_tState* pState, hcp_cszStr Codec, const hcp_Size_t ModelId, hcp_tCodec* pSession) {
+	if (pState == HCP_NULL) {
+		return HCP_INVALIDSTATE;
+	}
+
+	if (pSession == HCP_NULL) {
+		return HCP_INVALIDID;
+	}
+
+	hcp_Memset(pState, pSession, 0, sizeof(hcp_tCodec));
+
+	hcp_tCodecLibrary* library = HCP_NULL;
+	hcp_tModel* model = HCP_NULL;
+	hcp_Int error = hcp_FindCodecParts(pState, Codec, ModelId, &library, &model);
+
+	if (error == HCP_NOERROR) {
+		// sessions are not registered in the state, the id stays zero
+		error = hcp_SetupCodec(pState, library, model, pSession);
+	}
+
+	if (error != HCP_NOERROR) {
+		hcp_CloseSession(pSession);
+	}
+
+	return error;
+}
+
+hcp_Int hcp_CloseSession(hcp_tCodec* pSession) {
+	if (pSession == HCP_NULL) {
+		return HCP_INVALIDID;
+	}
+
+	if (pSession->parent != HCP_NULL) {
+		hcp_ReleaseCommands(pSession->parent, &pSession->commands);
+	}
+
+	hcp_Memset(HCP_NULL, pSession, 0, sizeof(hcp_tCodec));
+	return HCP_NOERROR;
+}
+
 
 
 hcp_Int hcp_NewState(hcp_tState* pState, hcp_tHost* pHost) {
@@ -375,7 +480,6 @@ hcp_Int hcp_Encode(hcp_tState* pState, hcp_Size_t CodecId, hcp_cszStr Command, h
 
 	hcp_Size_t index = -1;
 	hcp_tCodec* codec = HCP_NULL;
-	hcp_Int error = HCP_NOERROR;
 
 	// locked region 
 	{
@@ -391,36 +495,43 @@ hcp_Int hcp_Encode(hcp_tState* pState, hcp_Size_t CodecId, hcp_cszStr Command, h
 		return HCP_INVALIDID;
 	}
 
-	// locked region
-	{
-		hcp_tCommand* output = HCP_NULL;
-		hcp_tString input;
+	return hcp_EncodeSession(codec, Command, pDestination, MaxLength);
+}
 
-		input.zeroTerm = HCP_TRUE;
-		input.value = Command;
-		input.length = hcp_szStrLen(Command);
+hcp_Int hcp_EncodeSession(hcp_tCodec* pSession, hcp_cszStr Command, hcp_Uint8* pDestination, hcp_Uint32 MaxLength) {
+	if (pSession == HCP_NULL || pSession->parent == HCP_NULL) {
+		return HCP_INVALIDID;
+	}
 
-		error = hcp_ParseTifCommand(&input, &codec->commands, &output);
+	hcp_Int error = HCP_NOERROR;
+	hcp_tCommand* output = HCP_NULL;
+	hcp_tString input;
 
-		if (error == HCP_NOERROR && output != HCP_NULL) {
-			// call library
-			if (codec->library->encode == HCP_NULL) {
-				error = HCP_SERIALIZENOTSUPPORTED;
-			}
-			else {
-				hcp_tBlob destination;
+	input.zeroTerm = HCP_TRUE;
+	input.value = Command;
+	input.length = hcp_szStrLen(Command);
 
-				destination.value = pDestination;
-				destination.maxLength = MaxLength;
-				destination.length = 0;
+	// only the session's own command set is written to
+	error = hcp_ParseTifCommand(&input, &pSession->commands, &output);
 
-				error = codec->library->encode(&pState->runtime,&codec->template_->protocol,
-					output, &destination, &codec->context);
+	if (error == HCP_NOERROR && output != HCP_NULL) {
+		// call library
+		if (pSession->library->encode == HCP_NULL) {
+			error = HCP_SERIALIZENOTSUPPORTED;
+		}
+		else {
+			hcp_tBlob destination;
 
-				if (error == HCP_NOERROR) {
-					// on success, the return value is the number of bytes written
-					error = (hcp_Int)destination.length;
-				}
+			destination.value = pDestination;
+			destination.maxLength = MaxLength;
+			destination.length = 0;
+
+			error = pSession->library->encode(&pSession->parent->runtime, &pSession->template_->protocol,
+				output, &destination, &pSession->context);
+
+			if (error == HCP_NOERROR) {
+				// on success, the return value is the number of bytes written
+				error = (hcp_Int)destination.length;
 			}
 		}
 	}
@@ -430,7 +541,10 @@ hcp_Int hcp_Encode(hcp_tState* pState, hcp_Size_t CodecId, hcp_cszStr Command, h
 }
 
 hcp_Int hcp_Decode(hcp_tState* pState, hcp_Size_t CodecId, const hcp_Uint8* pSource, const hcp_Size_t Length, hcp_tResult* pResult) {
-	hcp_Int error = HCP_NOERROR;
+	if (pState == HCP_NULL) {
+		return HCP_INVALIDSTATE;
+	}
+
 	hcp_Boolean found = HCP_FALSE;
 	hcp_Size_t codecIndex = hcp_FindFirst(&pState->codecs.header, 0, (void*)CodecId, &found);
 
@@ -438,61 +552,149 @@ hcp_Int hcp_Decode(hcp_tState* pState, hcp_Size_t CodecId, const hcp_Uint8* pSou
 		return HCP_INVALIDID;
 	}
 
-	hcp_tCodec* codec = (hcp_tCodec*)hcp_ValueAt(&pState->codecs.header, codecIndex);
+	return hcp_DecodeSession((hcp_tCodec*)hcp_ValueAt(&pState->codecs.header, codecIndex), pSource, Length, pResult);
+}
+
+hcp_Int hcp_DecodeSession(hcp_tCodec* pSession, const hcp_Uint8* pSource, const hcp_Size_t Length, hcp_tResult* pResult) {
+	if (pSession == HCP_NULL || pSession->parent == HCP_NULL) {
+		return HCP_INVALIDID;
+	}
+
+	hcp_tState* state = pSession->parent;
+	hcp_tRuntime* runtime = &state->runtime;
+	hcp_tProtocol* protocol = &pSession->template_->protocol;
+	hcp_tCodecLibrary* library = pSession->library;
 	hcp_Int bytesRead = 0;
 
-	// locked area
-	{
-		hcp_tProtocol* protocol = &codec->template_->protocol;
-		hcp_tCodecLibrary* library = codec->library;
+	if (library->decode == HCP_NULL) {
+		bytesRead = HCP_DESERIALIZENOTSUPPORTED;
+	}
+	else {
+		hcp_tCommand* command = HCP_NULL;
+		hcp_tBlob source;
 
-		if (library->decode == HCP_NULL) {
-			bytesRead = HCP_DESERIALIZENOTSUPPORTED;
-		}
-		else {
-			hcp_tCommand* command = HCP_NULL;
-			hcp_tBlob source;
-
-			source.value = (hcp_Uint8*)pSource;
-			source.length = Length;
-			source.maxLength = Length;
-
-			hcp_tCommandSet* commandSet = &codec->commands;
-			hcp_tBuffer* context = &codec->context;
-
-			bytesRead = library->decode(&pState->runtime, protocol, &source, commandSet, &command, context);
-
-			if (pResult != HCP_NULL) {
-				if (bytesRead < 0) {
-					pResult->error = bytesRead;
-
-					if (library->lastError != HCP_NULL) {
-						pResult->deviceError = library->lastError(&pState->runtime, &codec->context, &pResult->message);
-					} else {
-						pResult->deviceError = bytesRead;
-					}
-					
-					pResult->parameterCount = 0;
-					pResult->parameters = HCP_NULL;
+		source.value = (hcp_Uint8*)pSource;
+		source.length = Length;
+		source.maxLength = Length;
+
+		// the decoded parameters are written to the session's own command set
+		bytesRead = library->decode(runtime, protocol, &source, &pSession->commands, &command, &pSession->context);
+
+		if (pResult != HCP_NULL) {
+			if (bytesRead < 0) {
+				pResult->error = bytesRead;
+
+				if (library->lastError != HCP_NULL) {
+					pResult->deviceError = library->lastError(runtime, &pSession->context, &pResult->message);
+				} else {
+					pResult->deviceError = bytesRead;
+				}
+				
+				pResult->parameterCount = 0;
+				pResult->parameters = HCP_NULL;
+			}
+			else {
+				pResult->error = HCP_NOERROR;
+				// libraries should really return a command, but if they dont we still
+				// dont want everything to crash and burn...
+				if (command != HCP_NULL) {
+					pResult->deviceError = HCP_NOERROR;
+					pResult->parameterCount = command->outParams.header.length;
+					pResult->parameters = (hcp_tParameter*)command->outParams.header.values;
+					pResult->command = command->template_->header.command;
+					pResult->family = command->template_->header.family;
 				}
 				else {
-					pResult->error = HCP_NOERROR;
-					// libraries should really return a command, but if they dont we still
-					// dont want everything to crash and burn...
-					if (command != HCP_NULL) {
-						pResult->deviceError = HCP_NOERROR;
-						pResult->parameterCount = command->outParams.header.length;
-						pResult->parameters = (hcp_tParameter*)command->outParams.header.values;
-						pResult->command = command->template_->header.command;
-						pResult->family = command->template_->header.family;
-					}
-					else {
-						hcp_Memset(pState, pResult, 0, sizeof(hcp_tResult));
-					}
+					hcp_Memset(state, pResult, 0, sizeof(hcp_tResult));
 				}
-			}	
+			}
 		}
-	} 
+	}
+
+	return bytesRead;
+}
+
+hcp_Int hcp_DecodeInto(hcp_tCodec* pSession, const hcp_Uint8* pSource, const hcp_Size_t Length, hcp_tResultStorage* pDest) {
+	if (pSession == HCP_NULL || pSession->parent == HCP_NULL || pDest == HCP_NULL) {
+		return HCP_INVALIDID;
+	}
+
+	hcp_tState* state = pSession->parent;
+	hcp_tResult* result = &pDest->result;
+
+	hcp_Memset(state, result, 0, sizeof(hcp_tResult));
+
+	hcp_Int bytesRead = hcp_DecodeSession(pSession, pSource, Length, result);
+
+	if (bytesRead < 0 || result->parameters == HCP_NULL) {
+		return bytesRead;
+	}
+
+	// move the parameters out of the session's command set, string and blob
+	// values still point into the session's receive buffer so they are
+	// copied as well
+	const hcp_tParameter* source = result->parameters;
+	hcp_Size_t valuesLength = 0;
+	hcp_Size_t i = 0;
+	hcp_Int error = HCP_NOERROR;
+
+	if (result->parameterCount > HCP_MAXSIZE_RESULTPARAMS) {
+		error = HCP_VECTORFULL;
+	}
+
+	for (i = 0; error == HCP_NOERROR && i < result->parameterCount; i++) {
+		hcp_tParameter* parameter = &pDest->parameters[i];
+		hcp_Memcpy(state, parameter, &source[i], sizeof(hcp_tParameter));
+
+		switch (parameter->template_->type) {
+			case HCP_STRING_ID: {
+				hcp_tString* str = &parameter->value.str;
+				// include the trailing \0 if there is one
+				hcp_Size_t length = str->zeroTerm == HCP_TRUE ? str->length + 1 : str->length;
+
+				if (str->value == HCP_NULL) {
+					break;
+				}
+
+				if (valuesLength + length > HCP_MAXSIZE_BUFFER) {
+					error = HCP_BLOBOUTOFRANGE;
+					break;
+				}
+
+				hcp_Memcpy(state, &pDest->values[valuesLength], str->value, length);
+				str->value = (hcp_Char const*)&pDest->values[valuesLength];
+				valuesLength += length;
+			} break;
+			case HCP_BLOB_ID: {
+				hcp_tBlob* blob = &parameter->value.blb;
+
+				if (blob->value == HCP_NULL) {
+					break;
+				}
+
+				if (valuesLength + blob->length > HCP_MAXSIZE_BUFFER) {
+					error = HCP_BLOBOUTOFRANGE;
+					break;
+				}
+
+				hcp_Memcpy(state, &pDest->values[valuesLength], blob->value, blob->length);
+				blob->value = &pDest->values[valuesLength];
+				blob->maxLength = blob->length;
+				valuesLength += blob->length;
+			} break;
+			default: break;
+		}
+	}
+
+	if (error != HCP_NOERROR) {
+		result->error = error;
+		result->deviceError = error;
+		result->parameters = HCP_NULL;
+		result->parameterCount = 0;
+	}
+	else {
+		result->parameters = pDest->parameters;
+	}
 
 	return bytesRead;
 }
@@ -503,56 +705,27 @@ hcp_Int hcp_NewCodec(hcp_tState* pState,hcp_cszStr Codec,const hcp_Size_t Templa
 
 	// locked region
 	{
-		hcp_Boolean found = HCP_FALSE;
-		// locate the specified tif-t using which the codec will
-		// get it's commands populated
-		hcp_Size_t templateIndex = hcp_FindFirst(&pState->templates.header, 0, (void*)TemplateId, &found);
+		hcp_tCodecLibrary* library = HCP_NULL;
+		hcp_tModel* t = HCP_NULL;
 
-		if (found == HCP_FALSE) {
-			error = HCP_INVALIDTEMPLATEID;
-		}
-		else {
-			hcp_tModel* t = (hcp_tModel*)hcp_ValueAt(&pState->templates.header, templateIndex);
-
-			// locate the specified codec library to use with the codec
-			hcp_Boolean found = HCP_FALSE;
-
-			hcp_Size_t libraryIndex = hcp_FindFirst(&pState->libraries.header, 0, (void*)Codec, &found);
-
-			if (found == HCP_FALSE) {
-				error = HCP_INVALIDLIB;
-			} else {
-				hcp_tCodecLibrary* library = (hcp_tCodecLibrary*)hcp_ValueAt(&pState->libraries.header, libraryIndex);
-
-				hcp_Size_t codecIndex = 0;
-				error = hcp_PushEmpty(&pState->codecs.header, &codecIndex);
-
-				if (error == HCP_NOERROR) {
-					hcp_tCodec* obj = (hcp_tCodec*)hcp_ValueAt(&pState->codecs.header, codecIndex);
-
-					obj->id = pState->nextId++;
-					obj->parent = pState;
-					obj->template_ = t;
-					obj->library = library;
-					obj->context.length = sizeof(obj->context.value);
-
-					//hcp_InitializeBuffer(&obj->context);
-
-					*pId = (hcp_Size_t)obj->id;
-					// populate the codec's commands using the TIF-file
-					error = hcp_InitializeCommands(pState, &obj->commands, t);
-					
-					if (error == HCP_NOERROR) {
-						// let the codec setup it's internal state
-						if (obj->library->setup != HCP_NULL) {
-							error = obj->library->setup(&pState->runtime, &obj->context);
-						}
-					}
-
-					if (error != HCP_NOERROR) {
-						// if parsing fails, remove the new instance from the list
-						hcp_Pop(&pState->codecs.header, codecIndex);
-					}
+		error = hcp_FindCodecParts(pState, Codec, TemplateId, &library, &t);
+
+		if (error == HCP_NOERROR) {
+			hcp_Size_t codecIndex = 0;
+			error = hcp_PushEmpty(&pState->codecs.header, &codecIndex);
+
+			if (error == HCP_NOERROR) {
+				hcp_tCodec* obj = (hcp_tCodec*)hcp_ValueAt(&pState->codecs.header, codecIndex);
+
+				obj->id = pState->nextId++;
+				*pId = (hcp_Size_t)obj->id;
+
+				error = hcp_SetupCodec(pState, library, t, obj);
+
+				if (error != HCP_NOERROR) {
+					// if parsing fails, remove the new instance from the list
+					hcp_ReleaseCommands(pState, &obj->commands);
+					hcp_Pop(&pState->codecs.header, codecIndex);
 				}
 			}
 		}
@@ -800,6 +973,67 @@ hcp_Boolean hcp_IsLibrary(void* pLibrary, void* pState) {
 	return library->name == HCP_NULL ? HCP_FALSE : HCP_TRUE;
 }
 
+hcp_Int hcp_FindCodecParts(hcp_tState* pState, hcp_cszStr Codec, const hcp_Size_t ModelId, hcp_tCodecLibrary** ppLibrary, hcp_tModel** ppModel) {
+	hcp_Boolean found = HCP_FALSE;
+	// locate the specified tif-t using which the codec will
+	// get it's commands populated
+	hcp_Size_t templateIndex = hcp_FindFirst(&pState->templates.header, 0, (void*)ModelId, &found);
+
+	if (found == HCP_FALSE) {
+		return HCP_INVALIDTEMPLATEID;
+	}
+
+	// locate the specified codec library to use with the codec
+	hcp_Size_t libraryIndex = hcp_FindFirst(&pState->libraries.header, 0, (void*)Codec, &found);
+
+	if (found == HCP_FALSE) {
+		return HCP_INVALIDLIB;
+	}
+
+	*ppModel = (hcp_tModel*)hcp_ValueAt(&pState->templates.header, templateIndex);
+	*ppLibrary = (hcp_tCodecLibrary*)hcp_ValueAt(&pState->libraries.header, libraryIndex);
+	return HCP_NOERROR;
+}
+
+hcp_Int hcp_SetupCodec(hcp_tState* pState, hcp_tCodecLibrary* pLibrary, hcp_tModel* pModel, hcp_tCodec* pCodec) {
+	pCodec->parent = pState;
+	pCodec->template_ = pModel;
+	pCodec->library = pLibrary;
+	pCodec->context.length = sizeof(pCodec->context.value);
+
+	// populate the codec's commands using the TIF-file
+	hcp_Int error = hcp_InitializeCommands(pState, &pCodec->commands, pModel);
+
+	if (error == HCP_NOERROR) {
+		// let the codec setup it's internal state
+		if (pLibrary->setup != HCP_NULL) {
+			error = pLibrary->setup(&pState->runtime, &pCodec->context);
+		}
+	}
+
+	return error;
+}
+
+void hcp_ReleaseCommands(hcp_tState* pState, hcp_tCommandSet* pCommands) {
+	// in static mode the vectors use the fixed arrays of their owners
+	if (hcp_IsDynamic(pState) == HCP_FALSE) {
+		return;
+	}
+
+	hcp_Size_t i = 0;
+	for (i = 0; i < pCommands->header.length; i++) {
+		hcp_tCommand* command = (hcp_tCommand*)hcp_ValueAt(&pCommands->header, i);
+
+		hcp_Free(pState, command->inParams.header.values);
+		hcp_Free(pState, command->outParams.header.values);
+	}
+
+	hcp_Free(pState, pCommands->header.values);
+	pCommands->header.values = HCP_NULL;
+	pCommands->header.length = 0;
+	pCommands->header.capacity = 0;
+}
+
 void hcp_RTMemset(hcp_tRuntime* pRuntime, void* pDest, const unsigned char Value, const hcp_Size_t DestSize) {
 	if (pRuntime == HCP_NULL) {
 		return;
@@ -156,6 +156,20 @@ typedef void(*hcp_tUnlock)(const void* _pPtr, void* _pHostCtx);
 	} hcp_tResult;
 #pragma pack(pop)
 
+	/**	Caller-owned storage for a decoded response.
+	 * \par	Description:
+	 *		Filled by [hcp_DecodeInto]. The parameters of [result] point into [parameters] and string/blob\n
+	 *		values point into [values], so the result stays valid until the storage is reused and may be\n
+	 *		handed to another thread while the session decodes the next response.
+	 */
+#pragma pack(push, 8)
+	typedef struct {
+		hcp_tResult result;		/* decoded response */
+		hcp_tParameter parameters[HCP_MAXSIZE_RESULTPARAMS];	/* output parameters of [result] */
+		hcp_Uint8 values[HCP_MAXSIZE_BUFFER];	/* string and blob values referenced by [parameters] */
+	} hcp_tResultStorage;
+#pragma pack(pop)
+
 /**	Host memory mapping structure
  *-----------------------------------------------------------------------------
  * \par	Description: Implement a host structure to enable dynamic memory in HCP. By\n
@@ -203,6 +217,40 @@ typedef struct {
 	 *	@return	Returns HCP_NOERROR if the instance was successfully created. Call [hcp_GetMessage] to resolve an error message otherwise.
 	 */
 	HCP_API hcp_Int HCP_CALL hcp_CloseCodec(hcp_tState* pState, hcp_Size_t CodecId);
+	/**
+	 *	Resets the receive state of a codec instance, discarding any partially decoded message. Use this
+	 *	when a response is abandoned (e.g. on timeout) so that the next call to [hcp_Decode] starts from
+	 *	a clean frame boundary.
+	 *	@param pState	State where the codec was created.
+	 *	@param CodecId	Codec instance id, obtained when calling [hcp_NewCodec].
+	 *	@return	Returns HCP_NOERROR if the codec was reset. Call [hcp_GetMessage] to resolve an error message otherwise.
+	 */
+	HCP_API hcp_Int HCP_CALL hcp_ResetCodec(hcp_tState* pState, hcp_Size_t CodecId);
+	/**
+	 *	Creates a codec session in caller-owned storage. A session holds everything that changes while encoding and
+	 *	decoding (command set, parameters, receive buffer), the state it was opened on is only read. Sessions on the same
+	 *	state may therefore be used from different threads without locking, as long as no codec library or model is
+	 *	loaded while any session is open. A single session must not be used by two threads at the same time.
+	 *	Unlike [hcp_NewCodec], opening a session does not modify the state.
+	 *	@param pState	HCP state where the loaded codec library and model exists.
+	 *	@param Codec	Name of the codec to use (output when calling hcp_LoadCodec).
+	 *	@param ModelId	Id of the object model to use (output when calling hcp_LoadModel).
+	 *	@param pSession	Session object to initialize, must stay at the same address until [hcp_CloseSession].
+	 *	@return	Returns HCP_NOERROR if the session was successfully created. Call [hcp_GetMessage] to resolve an error message otherwise.
+	 */
+	HCP_API hcp_Int HCP_CALL hcp_OpenSession(hcp_tState* pState, hcp_cszStr Codec, hcp_Size_t ModelId, hcp_tCodec* pSession);
+	/**
+	 *	Closes a session and releases its command set.
+	 *	@param pSession	Session opened with [hcp_OpenSession].
+	 *	@return	Returns HCP_NOERROR if the session was closed. Call [hcp_GetMessage] to resolve an error message otherwise.
+	 */
+	HCP_API hcp_Int HCP_CALL hcp_CloseSession(hcp_tCodec* pSession);
+	/**
+	 *	Resets the receive state of a session, see [hcp_ResetCodec].
+	 *	@param pSession	Session opened with [hcp_OpenSession].
+	 *	@return	Returns HCP_NOERROR if the session was reset. Call [hcp_GetMessage] to resolve an error message otherwise.
+	 */
+	HCP_API hcp_Int HCP_CALL hcp_ResetSession(hcp_tCodec* pSession);
 	/**
 	 *	Loads a new object model (JSON) into a HCP-state.
 	 *	@param pState	State where the model should be made avalible.
@@ -234,6 +282,15 @@ typedef struct {
 	 *			indicates an error. Call [hcp_GetMessage] to resolve an error message.
 	 */
 	HCP_API hcp_Int HCP_CALL hcp_Encode(hcp_tState* pState, hcp_Size_t CodecId, hcp_cszStr Command, hcp_Uint8* pDestination, hcp_Uint32 MaxLength);
+	/**
+	 *	Encodes a request into a byte-array using a session, see [hcp_Encode].
+	 *	@param pSession	Session opened with [hcp_OpenSession].
+	 *	@param pDestination	Output destination buffer.
+	 *	@param MaxLength	Size of [pDestination].
+	 *	@return	On success, returns a value greater to zero which indicates how many bytes that were written to [pDestination]. A value less than zero
+	 *			indicates an error. Call [hcp_GetMessage] to resolve an error message.
+	 */
+	HCP_API hcp_Int HCP_CALL hcp_EncodeSession(hcp_tCodec* pSession, hcp_cszStr Command, hcp_Uint8* pDestination, hcp_Uint32 MaxLength);
 	/**
 	 *	Decodes a range of bytes into a response object. A empty result object [pResult] indicates that not enough bytes has been received to make
 	 *	a complete message.
@@ -246,6 +303,28 @@ typedef struct {
 	 *			should be passed back to [hcp_Decode] once [pResult] is processed.
 	 */
 	HCP_API hcp_Int HCP_CALL hcp_Decode(hcp_tState* pState, hcp_Size_t CodecId, hcp_Uint8 const* pSource, hcp_Size_t Length, hcp_tResult* pResult);
+	/**
+	 *	Decodes a range of bytes into a response object using a session, see [hcp_Decode]. The parameters of [pResult] point into the
+	 *	session and stay valid until the next call to [hcp_DecodeSession] or [hcp_EncodeSession] on the same session.
+	 *	@param pSession	Session that was used when calling [hcp_EncodeSession].
+	 *	@param pSource	Array contaning the bytes to decode.
+	 *	@param Length	[pSource] length.
+	 *	@param pResult	Destination result object, will be empty (memset-ed) if no complete message is found.
+	 *	@return Returns the number of bytes consumed from [pSource].
+	 */
+	HCP_API hcp_Int HCP_CALL hcp_DecodeSession(hcp_tCodec* pSession, hcp_Uint8 const* pSource, hcp_Size_t Length, hcp_tResult* pResult);
+	/**
+	 *	Decodes a range of bytes into caller-owned storage using a session, see [hcp_DecodeSession]. Only the result header is
+	 *	reset, the parameters and values of [pDest] are written once a complete message has been decoded. The result does not
+	 *	reference the session and stays valid until [pDest] is reused.
+	 *	@param pSession	Session that was used when calling [hcp_EncodeSession].
+	 *	@param pSource	Array contaning the bytes to decode.
+	 *	@param Length	[pSource] length.
+	 *	@param pDest	Destination storage. [pDest]->result.error is HCP_VECTORFULL or HCP_BLOBOUTOFRANGE if the response does
+	 *					not fit.
+	 *	@return Returns the number of bytes consumed from [pSource].
+	 */
+	HCP_API hcp_Int HCP_CALL hcp_DecodeInto(hcp_tCodec* pSession, hcp_Uint8 const* pSource, hcp_Size_t Length, hcp_tResultStorage* pDest);
 	/**
 	 *	Returns the number of bytes required for a hcp_tState object.
 	 */
@@ -65,6 +65,7 @@
 #define HCP_MAXSIZE_PROTOCOLS 1	/* Maximum number of allowed codecs*/
 #define HCP_MAXSIZE_TIFTEMPLATES 1	/* Maximum allowed number of TIF-templates (TIF-files) */
 #define HCP_MAXSIZE_LIBRARIES 2	/* maximum number of product libraries that can be loaded when no dynamic memory is avalible */
+#define HCP_MAXSIZE_RESULTPARAMS 32	/* maximum number of output parameters in a caller-owned result (hcp_tResultStorage) */
 
 #define HCP_TYPE_INVALID 0
 #define HCP_TYPE_TSTRING 1
@@ -0,0 +1,225 @@
+/*
+ * tests-serial-arbiter.cpp
+ *
+ *  Unit tests for the serial link arbiter of the Automower HRP driver.
+ */
+
+#include "am_driver_safe/automower_arbiter.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Husqvarna;
+
+namespace
+{
+
+int failures = 0;
+
+#define CHECK(condition)                                                                    \
+    do                                                                                      \
+    {                                                                                       \
+        if (!(condition))                                                                   \
+        {                                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+            failures++;                                                                     \
+        }                                                                                   \
+    } while (false)
+
+// Long enough for a started thread to queue up
+const std::chrono::milliseconds SETTLE(20);
+
+typedef struct
+{
+    SerialPriority priority;
+    const char* name;
+} Request;
+
+Request makeRequest(SerialPriority priority, const char* name)
+{
+    Request request;
+    request.priority = priority;
+    request.name = name;
+    return request;
+}
+
+// Queues the requests one by one while the link is held, then releases it
+// and returns the order in which they were served.
+std::vector<std::string> serve(SerialArbiter& arbiter, const std::vector<Request>& requests,
+                               std::chrono::milliseconds ageFirst)
+{
+    std::vector<std::string> order;
+    std::vector<std::thread> threads;
+
+    arbiter.acquire(SERIAL_PRIORITY_ACTUATION);
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        const Request request = requests[i];
+        threads.push_back(std::thread([&arbiter, &order, request]()
+        {
+            SerialArbiterLock lock(arbiter, request.priority);
+            // Written while owning the link
+            order.push_back(request.name);
+        }));
+        std::this_thread::sleep_for((i == 0) ? SETTLE + ageFirst : SETTLE);
+    }
+    arbiter.release();
+
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+    return order;
+}
+
+double threadCpuTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void testClassification()
+{
+    CHECK(serialPriority("HardwareControl.WheelMotorsPower(leftWheelMotorPower:10, rightWheelMotorPower:10)") == SERIAL_PRIORITY_ACTUATION);
+    CHECK(serialPriority("Wheels.PowerOff()") == SERIAL_PRIORITY_ACTUATION);
+    CHECK(serialPriority("BladeMotor.Brake()") == SERIAL_PRIORITY_ACTUATION);
+    CHECK(serialPriority("RealTimeData.GetSensorData()") == SERIAL_PRIORITY_TELEMETRY);
+    CHECK(serialPriority("Wheels.GetRotationCounter(index:0)") == SERIAL_PRIORITY_TELEMETRY);
+    CHECK(serialPriority("MowerApp.GetState()") == SERIAL_PRIORITY_TELEMETRY);
+    CHECK(serialPriority("MowerApp.SetMode(modeOfOperation:1)") == SERIAL_PRIORITY_CONTROL);
+    CHECK(serialPriority("SafetySupervisor.GetStatus()") == SERIAL_PRIORITY_CONTROL);
+}
+
+void testOrderByClass()
+{
+    SerialArbiter arbiter;
+    arbiter.setMaxWait(10.0);
+
+    std::vector<Request> requests;
+    requests.push_back(makeRequest(SERIAL_PRIORITY_TELEMETRY, "telemetry 1"));
+    requests.push_back(makeRequest(SERIAL_PRIORITY_CONTROL, "control 1"));
+    requests.push_back(makeRequest(SERIAL_PRIORITY_TELEMETRY, "telemetry 2"));
+    requests.push_back(makeRequest(SERIAL_PRIORITY_ACTUATION, "actuation"));
+    requests.push_back(makeRequest(SERIAL_PRIORITY_CONTROL, "control 2"));
+
+    const std::vector<std::string> order = serve(arbiter, requests, std::chrono::milliseconds(0));
+    CHECK(order.size() == 5);
+    if (order.size() == 5)
+    {
+        CHECK(order[0] == "actuation");
+        CHECK(order[1] == "control 1");
+        CHECK(order[2] == "control 2");
+        CHECK(order[3] == "telemetry 1");
+        CHECK(order[4] == "telemetry 2");
+    }
+
+    SerialWaitStats stats[SERIAL_PRIORITY_CLASSES];
+    arbiter.takeStats(stats);
+    CHECK(stats[SERIAL_PRIORITY_ACTUATION].count == 2);
+    CHECK(stats[SERIAL_PRIORITY_CONTROL].count == 2);
+    CHECK(stats[SERIAL_PRIORITY_TELEMETRY].count == 2);
+    CHECK(stats[SERIAL_PRIORITY_TELEMETRY].promoted == 0);
+    CHECK(stats[SERIAL_PRIORITY_TELEMETRY].maxWait > 0.05);
+
+    // Cleared by takeStats
+    arbiter.takeStats(stats);
+    CHECK(stats[SERIAL_PRIORITY_TELEMETRY].count == 0);
+}
+
+void testAging()
+{
+    SerialArbiter arbiter;
+    arbiter.setMaxWait(0.05);
+
+    // The telemetry waiter ages past maxWait before the others queue up. It
+    // overtakes control, but never actuation.
+    std::vector<Request> requests;
+    requests.push_back(makeRequest(SERIAL_PRIORITY_TELEMETRY, "telemetry"));
+    requests.push_back(makeRequest(SERIAL_PRIORITY_CONTROL, "control"));
+    requests.push_back(makeRequest(SERIAL_PRIORITY_ACTUATION, "actuation"));
+
+    const std::vector<std::string> order = serve(arbiter, requests, std::chrono::milliseconds(100));
+    CHECK(order.size() == 3);
+    if (order.size() == 3)
+    {
+        CHECK(order[0] == "actuation");
+        CHECK(order[1] == "telemetry");
+        CHECK(order[2] == "control");
+    }
+
+    SerialWaitStats stats[SERIAL_PRIORITY_CLASSES];
+    arbiter.takeStats(stats);
+    CHECK(stats[SERIAL_PRIORITY_TELEMETRY].promoted == 1);
+    CHECK(stats[SERIAL_PRIORITY_ACTUATION].promoted == 0);
+}
+
+void testAgingDisabled()
+{
+    const double settings[] = {0.0, -1.0, NAN};
+    for (size_t i = 0; i < sizeof(settings) / sizeof(settings[0]); i++)
+    {
+        SerialArbiter arbiter;
+        arbiter.setMaxWait(settings[i]);
+
+        std::vector<Request> requests;
+        requests.push_back(makeRequest(SERIAL_PRIORITY_TELEMETRY, "telemetry"));
+        requests.push_back(makeRequest(SERIAL_PRIORITY_CONTROL, "control"));
+
+        const std::vector<std::string> order = serve(arbiter, requests, std::chrono::milliseconds(100));
+        CHECK(order.size() == 2);
+        if (order.size() == 2)
+        {
+            CHECK(order[0] == "control");
+            CHECK(order[1] == "telemetry");
+        }
+    }
+}
+
+void testWaitersSleep()
+{
+    // Neither a disabled nor a tiny limit may turn waiting into spinning
+    const double settings[] = {0.0, 1e-9};
+    for (size_t i = 0; i < sizeof(settings) / sizeof(settings[0]); i++)
+    {
+        SerialArbiter arbiter;
+        arbiter.setMaxWait(settings[i]);
+        arbiter.acquire(SERIAL_PRIORITY_ACTUATION);
+
+        double cpuTime = 0.0;
+        std::thread waiter([&arbiter, &cpuTime]()
+        {
+            const double start = threadCpuTime();
+            SerialArbiterLock lock(arbiter, SERIAL_PRIORITY_TELEMETRY);
+            cpuTime = threadCpuTime() - start;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        arbiter.release();
+        waiter.join();
+
+        CHECK(cpuTime < 0.02);
+    }
+}
+
+}
+
+int main()
+{
+    testClassification();
+    testOrderByClass();
+    testAging();
+    testAgingDisabled();
+    testWaitersSleep();
+    if (failures != 0)
+    {
+        std::cerr << failures << " check(s) failed." << std::endl;
+    }
+    return (failures == 0) ? 0 : 1;
+}
@@ -306,7 +306,7 @@ public:
 	void spinOne(){ Spinner s(*this); s.spinOne(); }
 	void spin(double rate=EQ_SPINNER_DIF_RATE){ Spinner s(*this); s.spin(rate); }
 	void async_spin(double rate=EQ_SPINNER_DIF_RATE, double start_delay=0.0){
-		boost::this_thread::sleep(boost::posix_time::seconds(start_delay));
+		if(start_delay>0) boost::this_thread::sleep(boost::posix_time::seconds(start_delay));
 		_spinner = boost::shared_ptr<Spinner>(new Spinner (*this));
 		_spinner->start(rate);
 	}
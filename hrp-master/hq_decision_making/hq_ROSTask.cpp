@@ -381,9 +381,12 @@ RosEventQueue::RosEventQueue():decision_making::EventQueue(), do_not_publish_spi
 	std::string node_name = ros::this_node::getName();
 	std::string topic_name = "/decision_making/"+node_name+"/events";
 	publisher = ros::NodeHandle().advertise<std_msgs::String>(topic_name, 100);
-	{boost::this_thread::sleep(boost::posix_time::seconds(1.0));}
 	subscriber= ros::NodeHandle().subscribe<std_msgs::String>(topic_name, 100, &RosEventQueue::onNewEvent, this);
-	{boost::this_thread::sleep(boost::posix_time::seconds(1.0));}
+	// Events go through the own topic, ready once the subscriber is connected to the publisher.
+	// In the same process that happens within subscribe(), the wait is only a fallback.
+	ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(2.0);
+	while(publisher.getNumSubscribers()==0 and ros::WallTime::now()<deadline)
+	{boost::this_thread::sleep(boost::posix_time::milliseconds(1));}
 }
 RosEventQueue::RosEventQueue(EventQueue* parent):decision_making::EventQueue(parent), do_not_publish_spin(true){
 }
@@ -419,7 +422,6 @@ void ros_decision_making_init(int &argc, char **argv){
 	RosDiagnostic::get();
 	RosConstraints::getAdder();
 	RosConstraints::getRemover();
-	boost::this_thread::sleep(boost::posix_time::seconds(1.0));
 }
 
 
@@ -1,260 +1,712 @@
 #include "automower.hpp"
 
-AutomowerSafe::AutomowerSafe() :
-
-m_linearSpeedRequest{};
-m_angularSpeedRequest{};
-
-{
-}
-  
-void Automower::RequestLinearSpeed(opendlv::proxy::GroundMotionRequest const &linearSpeedRequest) noexcept
-{
-m_linearSpeedRequest=linearSpeedRequest
-}
-
-void Automower::RequestAngularSpeed(opendlv::proxy::GroundMotionRequest const &angularSpeedRequest) noexcept
-{
-m_angularSpeedRequest=angularSpeedRequest
-}
-
-void Automower::velocity()
-{
-   opendlv::proxy::GroundMotionRequest linearSpeedRequest;
-   opendlv::proxy::GroundMotionRequest angularSpeedRequest;
-   {
-
-    float lin_vel = linearSpeedRequest;
-    float ang_vel = angumarSpeedRequest;
-
-    wanted_lv = lin_vel - ang_vel * AUTMOWER_WHEEL_BASE_WIDTH / 2;
-    wanted_rv = lin_vel + ang_vel * AUTMOWER_WHEEL_BASE_WIDTH / 2;
-   }
-}
-
-
-int Automower::sendMessage(unsigned char *msg, int len, unsigned char *ansmsg, int maxAnsLength, bool retry)
-{
- /*
- 	std::cout << "SEND: " << std::hex;
-	for (int i=0; i<len; i++)
-	{
-		std::cout << "0x" << (int)msg[i] << " ";
-	}
-	std::cout << std::dec << std::endl;
-*/	
-	
-	// Sending
-	int cnt=0;
-	cnt = write(serialFd, msg, len);
-	
-	if(cnt != len)
-	{
-		std::cerr << "ERROR : AutomowerHIL::Could not send on serial port!" << std::endl;
-		exit(1);
-	}
-
-	cnt = 0;
-	int res;
-	int payloadLength = 0;
-	
-	// Clear answer buffer
-	memset(ansmsg, 0, maxAnsLength);
-	
-	// Keep reading until we find an STX
-	
-	// receive STX
-	while (ansmsg[cnt] != 0x02)
-	{
-		res = read(serialFd, &ansmsg[cnt], 1);
-	}
-	cnt++;
-
-	// Read MESSAGE TYPE
-	res = read(serialFd, &ansmsg[cnt], 1);
-	//std::cout << "MESSAGE TYPE: " << (int)ansmsg[cnt] << std::endl;
-	cnt++;
-	
-	// Read LENGTH
-	res = read(serialFd, &ansmsg[cnt], 1);
-	payloadLength = ansmsg[cnt];
-	//std::cout << "PAYLOAD LENGTH: " << (int)payloadLength << std::endl;
-	cnt++;
-	
-	// Read PAYLOAD
-	unsigned char readBytes = 0;
-	unsigned max_retries = 100;
-	while ((readBytes < payloadLength) && (max_retries > 0))
-	{
-		int bytes = read(serialFd, &ansmsg[cnt], payloadLength-readBytes);
-		if (bytes > 0)
-		{
-			readBytes += bytes;
-			cnt += bytes;
-		}
-		max_retries--;
-	}
-	
-	// Read CRC
-	// TODO: Use it!
-	res = read(serialFd, &ansmsg[cnt], 1);
-	cnt++;
-
-	// Read ETX
-	res = read(serialFd, &ansmsg[cnt], 1);
-	cnt++;
-
-/*
-	std::cout << "CNT: " << cnt << std::endl;
-	std::cout << "RESPONSE: " << std::hex;
-	for (int i=0; i<cnt; i++)
-	{
-		std::cout << "0x" << (int)ansmsg[i] << " ";
-	}
-	std::cout << std::dec << std::endl;
-*/
-
-	// Check some stuff
-	if (ansmsg[0] != 0x02)
-	{
-		// FAILED
-		return 0;
-	}
-	if (ansmsg[cnt-1] != 0x03)
-	{
-		// FAILED
-		return 0;
-	}
-
-	return cnt;
-
-}   
-
-
-std::string Automower::loadJsonModel(std::string fileName)
-{
-    std::string line;
-    std::ifstream file(fileName.c_str());
-    std::cout << "Loading from:" << fileName << "..." << std::endl;
-
-    std::string str;
-    std::string fileContents;
-    if (file.is_open())
-    {
-        while (std::getline(file, str))
-        {
-            fileContents += str;
-            fileContents.push_back('\n');
-        }
-        return fileContents;
-    }
-    else
-    {
-        std::cerr << "Could not load JSON file!!!" << std::endl;
-        return str;
-    }
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+int32_t const IMOWERAPP_MODE_AUTO{0};
+
+}
+
+Automower::PidRegulator::PidRegulator() noexcept
+  : m_p{0.0}
+  , m_i{0.0}
+  , m_d{0.0}
+  , m_pErr{0.0}
+  , m_iErr{0.0}
+  , m_dErr{0.0}
+{
+}
+
+void Automower::PidRegulator::init(double p, double i, double d) noexcept
+{
+  m_p = p;
+  m_i = i;
+  m_d = d;
+  restart();
 }
 
-bool Automower::initAutomowerBoard()
+void Automower::PidRegulator::restart() noexcept
 {
-  std::cout << "AutomowerSafe::initAutomowwerBoard" << std::endl;
-  
+  m_pErr = 0.0;
+  m_iErr = 0.0;
+  m_dErr = 0.0;
+}
 
-void Automower::regulateVelocity()
+double Automower::PidRegulator::update(double currentSignal, double wantedSignal) noexcept
 {
-    if (!m_regulatingActive)
-    {
-        return;
+  double const errOld{m_pErr};
+  double const err{wantedSignal - currentSignal};
+
+  m_pErr = err;
+  m_iErr = m_iErr + errOld;
+  m_dErr = err - errOld;
+
+  return m_p * m_pErr + m_i * m_iErr + m_d * m_dErr;
+}
+
+Automower::Automower(cluon::OD4Session &od4, HcpModel &model, Config const &config) noexcept
+  : m_od4{od4}
+  , m_model{model}
+  , m_config{config}
+  , m_session{}
+  , m_hasSession{false}
+  , m_serialFd{-1}
+  , m_wakeFd{-1}
+  , m_wheelBaseWidth{0.464500}
+  , m_wheelDiameter{0.245}
+  , m_motionRequests{}
+  , m_powerCommands{}
+  , m_isRunning{false}
+  , m_userStop{true}
+  , m_currentLeftSpeed{0.0f}
+  , m_currentRightSpeed{0.0f}
+  , m_leftWheelPid{}
+  , m_rightWheelPid{}
+  , m_wheelsOff{true}
+  , m_polledCommands{}
+  , m_transaction{}
+  , m_response{}
+  , m_pendingPower{0, 0, true}
+  , m_lastPower{0, 0, true}
+  , m_consecutiveTimeouts{0}
+  , m_awaitingLateResponse{false}
+  , m_responseTimeoutCount{0}
+  , m_lateResponseCount{0}
+  , m_discardedBytes{0}
+{
+  // PID parameters are tuned for 50 Hz, x rescales them to the regulator frequency.
+  double const x{50.0 / static_cast<double>(m_config.regulatorFreq)};
+  m_leftWheelPid.init(50.0, 10.0 * x, 1.0 / x);
+  m_rightWheelPid.init(50.0, 10.0 * x, 1.0 / x);
+
+  // The wheel data drives the regulator and is polled at its rate, everything
+  // else at the rate the ROS driver used for it.
+  auto const regulatorPeriod{std::chrono::microseconds(
+      static_cast<int64_t>(1000000.0f / m_config.regulatorFreq))};
+  m_polledCommands = {
+    {"RealTimeData.GetWheelMotorData()", regulatorPeriod, {}, &Automower::onWheelMotorData},
+    {"SafetySupervisor.GetStatus()", std::chrono::milliseconds(100), {}, &Automower::onSafetyStatus},
+    {"RealTimeData.GetSensorData()", std::chrono::milliseconds(200), {}, &Automower::onSensorData},
+    {"Charger.IsChargingPowerConnected()", std::chrono::seconds(1), {}, &Automower::onChargingPower},
+    {"RealTimeData.GetBatteryData()", std::chrono::seconds(1), {}, &Automower::onBatteryData},
+    {"RealTimeData.GetGPSData()", std::chrono::seconds(1), {}, &Automower::onGpsData},
+    {"CurrentStatus.GetStatusKeepAlive()", std::chrono::seconds(1), {}, &Automower::onKeepAlive}
+  };
+
+  if (setUp()) {
+    auto const start{std::chrono::steady_clock::now()};
+    for (auto &polled : m_polledCommands) {
+      polled.nextDue = start;
     }
+    m_isRunning.store(true);
+  } else {
+    tearDown();
+  }
+}
 
-    power_l = leftWheelPid.Update(current_lv, wanted_lv);
-    power_r = rightWheelPid.Update(current_rv, wanted_rv);
+Automower::~Automower()
+{
+  tearDown();
+}
 
-    sendWheelPower(power_l, power_r);
+bool Automower::isRunning() const noexcept
+{
+  return m_isRunning.load();
 }
- 
 
-bool Automower::getWheelData()
-{ 
-    hcp_tResult result;
+std::string const &Automower::serialPort() const noexcept
+{
+  return m_config.serialPort;
+}
 
-    const char* msg = "RealTimeData.GetWheelMotorData()";
-    if (!sendMessage(msg, sizeof(msg), result))
-    {
-        return false;
+void Automower::setGroundMotionRequest(opendlv::proxy::GroundMotionRequest const &request) noexcept
+{
+  MotionRequest motionRequest{request.vx(), request.yawRate(), std::chrono::steady_clock::now()};
+  m_motionRequests.post(motionRequest);
+}
+
+void Automower::regulate() noexcept
+{
+  MotionRequest request;
+  bool const isNew{m_motionRequests.fetch(request)};
+
+  auto const now{std::chrono::steady_clock::now()};
+  bool const isStale{request.received.time_since_epoch().count() == 0
+    || (now - request.received) > m_config.requestTimeout};
+
+  if (isStale || m_userStop.load()) {
+    if (!m_wheelsOff) {
+      if (m_config.verbose) {
+        std::cout << (isStale ? "No recent ground motion request" : "User stop active")
+          << ", powering off wheels." << std::endl;
+      }
+      m_leftWheelPid.restart();
+      m_rightWheelPid.restart();
+      m_powerCommands.post(WheelPowerCommand{0, 0, true});
+      wakeReactor();
+      m_wheelsOff = true;
     }
+    return;
+  }
+
+  double const wantedLeft{request.vx - request.yawRate * m_wheelBaseWidth / 2.0};
+  double const wantedRight{request.vx + request.yawRate * m_wheelBaseWidth / 2.0};
+
+  double const powerLeft{m_leftWheelPid.update(m_currentLeftSpeed.load(), wantedLeft)};
+  double const powerRight{m_rightWheelPid.update(m_currentRightSpeed.load(), wantedRight)};
+
+  WheelPowerCommand command;
+  command.left = static_cast<int16_t>(std::max(-100.0, std::min(100.0, powerLeft)));
+  command.right = static_cast<int16_t>(std::max(-100.0, std::min(100.0, powerRight)));
+  command.powerOff = false;
+  m_powerCommands.post(command);
+  wakeReactor();
+  m_wheelsOff = false;
+
+  if (m_config.verbose && isNew) {
+    std::cout << "Ground motion request vx=" << request.vx << " yawRate=" << request.yawRate
+      << " -> wheel speeds " << wantedLeft << ", " << wantedRight << " m/s" << std::endl;
+  }
+}
 
-    int16_t tmpValue;
-    tmpValue = result.parameters[1].value.i16;
-    current_lv = ((double)tmpValue) / 1000.0;
- }	
-	
-void AutomowerSafe::stopWheels()
+bool Automower::setUp() noexcept
 {
+  m_hasSession = m_model.openSession(m_session);
+  if (!m_hasSession) {
+    return false;
+  }
+
+  m_serialFd = Husqvarna::openSerialPort(m_config.serialPort, m_config.serial);
+  if (m_serialFd < 0) {
+    std::cerr << "Could not open " << m_config.serialPort << ": " << strerror(errno) << std::endl;
+    return false;
+  }
+  if (m_config.serial.usbLatencyTimer > 0) {
+    Husqvarna::setUsbLatencyTimer(m_config.serialPort, m_config.serial.usbLatencyTimer);
+  }
+
+  return initAutomowerBoard();
+}
 
-    //DEBUG_LOG ("AutomowerSafe::stopWheels()")
-    // Clear power
-    
-    power_l = 0;
-    power_r = 0;
+void Automower::tearDown() noexcept
+{
+  if (m_serialFd >= 0) {
+    close(m_serialFd);
+    m_serialFd = -1;
+  }
+  if (m_hasSession) {
+    m_model.closeSession(m_session);
+    m_hasSession = false;
+  }
+}
+
+bool Automower::initAutomowerBoard() noexcept
+{
+  hcp_tResultStorage response;
+  hcp_tResult const &result{response.result};
+  if (!transact("DeviceInformation.GetDeviceIdentification()", response)) {
+    std::cerr << "Failed to identify the mower board." << std::endl;
+    return false;
+  }
+
+  uint8_t const deviceType{result.parameters[0].value.u8};
+  uint8_t const mowerType{result.parameters[1].value.u8};
+  if (deviceType != 10) {
+    std::cerr << "Mower device not found, device type " << static_cast<int32_t>(deviceType) << "." << std::endl;
+    return false;
+  }
+
+  if ((mowerType == 7) || (mowerType == 8)) {
+    // 430X or 450X
+    m_wheelBaseWidth = 0.464500;
+    m_wheelDiameter = 0.245;
+  } else if ((mowerType == 14) || (mowerType == 10) || (mowerType == 4)) {
+    // P0 and P1
+    m_wheelBaseWidth = 0.3314;
+    m_wheelDiameter = 0.210;
+  }
+  std::cout << "Mower type " << static_cast<int32_t>(mowerType) << ", wheel base "
+    << m_wheelBaseWidth << " m, wheel diameter " << m_wheelDiameter << " m." << std::endl;
+
+  char msg[100];
+  snprintf(msg, sizeof(msg), "MowerApp.SetMode(modeOfOperation:%d)", IMOWERAPP_MODE_AUTO);
+  if (!transact(msg, response)) {
+    std::cerr << "Failed setting auto mode." << std::endl;
+    return false;
+  }
+
+  if (!transact("MowerApp.Pause()", response)) {
+    std::cerr << "Failed pausing the mower." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+int32_t Automower::serialFd() const noexcept
+{
+  return m_serialFd;
+}
+
+void Automower::attach(int32_t wakeFd) noexcept
+{
+  m_wakeFd.store(wakeFd);
+}
+
+std::chrono::steady_clock::time_point Automower::service(std::chrono::steady_clock::time_point now) noexcept
+{
+  if (m_transaction.isActive) {
+    if (now < m_transaction.deadline) {
+      return m_transaction.deadline;
+    }
+    m_transaction.isActive = false;
+    handleResponseTimeout(m_transaction.command);
+  }
+
+  while (m_isRunning.load()) {
+    // Actuation goes first, the sensor polls fill the gaps in between.
+    WheelPowerCommand power;
+    if (m_powerCommands.fetch(power)) {
+      if (sendWheelPower(power)) {
+        return m_transaction.deadline;
+      }
+      continue;
+    }
 
-//    wheelPower.left = power_l;
-//    wheelPower.right = power_r;
+    auto next = std::min_element(m_polledCommands.begin(), m_polledCommands.end(),
+      [](PolledCommand const &a, PolledCommand const &b) {
+        return a.nextDue < b.nextDue;
+      });
+    if (next->nextDue > now) {
+      return next->nextDue;
+    }
 
-    hcp_tResult result;
-    const char* powerOffMsg = "Wheels.PowerOff()";
-    if (!sendMessage(powerOffMsg, sizeof(powerOffMsg), result))
-    {
-        return;
+    next->nextDue += next->period;
+    if (next->nextDue < now) {
+      // Fell behind, do not try to catch up with a burst.
+      next->nextDue = now + next->period;
+    }
+    if (beginTransaction(next->command, next->handler, m_response)) {
+      return m_transaction.deadline;
     }
+  }
+  return now + std::chrono::seconds(1);
+}
+
+void Automower::onReadable() noexcept
+{
+  if (m_transaction.isActive) {
+    receive();
+  } else {
+    discardLateResponses();
+  }
+}
 
+void Automower::onSerialError() noexcept
+{
+  std::cerr << "Lost the serial link " << m_config.serialPort << "." << std::endl;
+  m_transaction.isActive = false;
+  m_userStop.store(true);
+  m_isRunning.store(false);
+}
+
+void Automower::shutDown() noexcept
+{
+  if (m_serialFd < 0) {
     return;
+  }
+  awaitTransaction();
+  hcp_tResultStorage response;
+  transact("Wheels.PowerOff()", response);
 }
-	
-float Automower::convertSpeedtoPower(float speed) const
+
+void Automower::wakeReactor() noexcept
 {
-  
+  uint64_t const one{1};
+  int32_t const wakeFd{m_wakeFd.load()};
+  if ((wakeFd >= 0) && (write(wakeFd, &one, sizeof(one)) < 0)) {
+    // Counter saturated, the reactor is awake anyway.
+  }
+}
 
+bool Automower::sendWheelPower(WheelPowerCommand const &power) noexcept
+{
+  if (power.powerOff || m_userStop.load()) {
+    if (m_lastPower.powerOff) {
+      return false;
+    }
+    m_pendingPower = WheelPowerCommand{0, 0, true};
+    return beginTransaction("Wheels.PowerOff()", &Automower::onWheelPowerAcknowledged, m_response);
+  }
+
+  char msg[100];
+  snprintf(msg, sizeof(msg), "HardwareControl.WheelMotorsPower(leftWheelMotorPower:%d, rightWheelMotorPower:%d)",
+      power.left, power.right);
+  m_pendingPower = power;
+  return beginTransaction(msg, &Automower::onWheelPowerAcknowledged, m_response);
 }
 
+bool Automower::beginTransaction(std::string const &msg, ResultHandler handler, hcp_tResultStorage &response) noexcept
+{
+  hcp_Uint8 buf[255];
+  hcp_Int const numBytes = hcp_EncodeSession(&m_session, msg.c_str(), buf, sizeof(buf));
+  if (numBytes < 0) {
+    if (numBytes == HCP_COMMANDNOTLOADED) {
+      std::cerr << "JSON model does not support command " << msg << "." << std::endl;
+    } else {
+      std::cerr << "JSON encoding failed with error " << numBytes << " for command " << msg << "." << std::endl;
+    }
+    return false;
+  }
+
+  // Whatever is waiting in the input queue now belongs to an earlier command
+  discardLateResponses();
+
+  if (!writeSerial(buf, numBytes)) {
+    std::cerr << "Could not send on " << m_config.serialPort << ": " << strerror(errno) << std::endl;
+    // A full output queue counts like an unanswered command, anything else
+    // means the port is gone.
+    if (errno == ETIMEDOUT) {
+      handleResponseTimeout(msg);
+    } else {
+      onSerialError();
+    }
+    return false;
+  }
+
+  m_transaction.command = msg;
+  m_transaction.handler = handler;
+  m_transaction.deadline = std::chrono::steady_clock::now() + m_config.responseTimeout;
+  m_transaction.response = &response;
+  m_transaction.receivedBytes = 0;
+  m_transaction.isActive = true;
+  m_transaction.isComplete = false;
+  m_transaction.isSuccessful = false;
+  return true;
+}
 
-void AutomowerSafe::sendWheelPower(double power_left, double power_right)
+void Automower::receive() noexcept
 {
-    if (userStop)
-    {
-        std::cerr << "User stop active, can't set power" << std::endl ;
-        stopWheels();
-        return;
+  // hcp_DecodeInto resets the result header on every call, the parameters
+  // are only written once the response is complete.
+  hcp_tResult const &result{m_transaction.response->result};
+  hcp_Uint8 buf[255];
+  while (m_transaction.isActive) {
+    ssize_t const res{read(m_serialFd, buf, sizeof(buf))};
+    if ((res == 0) || ((res < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)))) {
+      // The rest of the response has not arrived yet.
+      return;
+    }
+    if ((res < 0) || ((m_transaction.receivedBytes == 0) && (buf[0] == 0))) {
+      std::cerr << "Failed to get a response to " << m_transaction.command << ", mower "
+        << ((res < 0) ? "sleeping?" : "rebooting?") << std::endl;
+      finishTransaction(false);
+      return;
     }
 
-    if (power_l > 100)
-    {
-        power_l = 100;
+    int32_t offset{0};
+    while ((offset < res) && !m_transaction.isComplete) {
+      hcp_Int const numBytes = hcp_DecodeInto(&m_session, &buf[offset],
+          static_cast<hcp_Size_t>(res - offset), m_transaction.response);
+      m_transaction.isComplete = (result.command.length != 0) || (result.error != HCP_NOERROR);
+      if (numBytes <= 0) {
+        break;
+      }
+      offset += numBytes;
     }
+    m_transaction.receivedBytes += static_cast<int32_t>(res);
 
-    if (power_l < -100)
-    {
-        power_l = -100;
+    // Bytes following a complete response were not asked for
+    if (offset < res) {
+      m_discardedBytes += static_cast<uint64_t>(res - offset);
     }
 
-    if (power_r > 100)
-    {
-        power_r = 100;
+    if (m_transaction.isComplete) {
+      m_consecutiveTimeouts = 0;
+      if (result.error != HCP_NOERROR) {
+        std::cerr << "Error receiving the response to " << m_transaction.command << ", not logged in?" << std::endl;
+      }
+      finishTransaction(result.error == HCP_NOERROR);
     }
+  }
+}
+
+void Automower::finishTransaction(bool isSuccessful) noexcept
+{
+  m_transaction.isActive = false;
+  m_transaction.isSuccessful = isSuccessful;
+  if (isSuccessful && (m_transaction.handler != nullptr)) {
+    (this->*(m_transaction.handler))(m_transaction.response->result);
+  }
+}
 
-    if (power_r < -100)
-    {
-        power_r = -100;
+bool Automower::awaitTransaction() noexcept
+{
+  struct pollfd pfd;
+  pfd.fd = m_serialFd;
+  pfd.events = POLLIN;
+
+  while (m_transaction.isActive) {
+    auto const remaining{m_transaction.deadline - std::chrono::steady_clock::now()};
+    if (remaining <= std::chrono::steady_clock::duration::zero()) {
+      m_transaction.isActive = false;
+      handleResponseTimeout(m_transaction.command);
+      return false;
     }
 
-    // Send it out...
-    hcp_tResult result;
-    char powerMsg[100];
-    snprintf(powerMsg, sizeof(powerMsg), "HardwareControl.WheelMotorsPower(leftWheelMotorPower:%d, rightWheelMotorPower:%d)", power_l, power_r);
-    if (!sendMessage(powerMsg, sizeof(powerMsg), result))
-    {
-        std::cerr << "Can't set power, unknown reason" << std::endl;
-        return;
+    pfd.revents = 0;
+    auto const timeout{std::chrono::duration_cast<std::chrono::milliseconds>(remaining).count() + 1};
+    int32_t const res{poll(&pfd, 1, static_cast<int>(timeout))};
+    if (((res < 0) && (errno != EINTR)) || ((res > 0) && (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)))) {
+      std::cerr << "Failed to get a response to " << m_transaction.command << ", mower sleeping?" << std::endl;
+      finishTransaction(false);
+      return false;
+    }
+    if (res > 0) {
+      receive();
     }
+  }
+  return m_transaction.isSuccessful;
+}
+
+bool Automower::transact(std::string const &msg, hcp_tResultStorage &response) noexcept
+{
+  return beginTransaction(msg, nullptr, response) && awaitTransaction();
 }
 
+bool Automower::writeSerial(hcp_Uint8 const *buf, int32_t len) noexcept
+{
+  struct pollfd pfd;
+  pfd.fd = m_serialFd;
+  pfd.events = POLLOUT;
+
+  int32_t written{0};
+  while (written < len) {
+    ssize_t const res{write(m_serialFd, buf + written, static_cast<size_t>(len - written))};
+    if (res > 0) {
+      written += static_cast<int32_t>(res);
+      continue;
+    }
+    if ((res < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+      return false;
+    }
+    pfd.revents = 0;
+    int32_t const ready{poll(&pfd, 1, static_cast<int>(m_config.responseTimeout.count()))};
+    if ((ready < 0) && (errno != EINTR)) {
+      return false;
+    }
+    if (ready == 0) {
+      errno = ETIMEDOUT;
+      return false;
+    }
+    if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+      errno = EIO;
+      return false;
+    }
+  }
+  return true;
+}
+
+void Automower::discardLateResponses() noexcept
+{
+  hcp_Uint8 buf[255];
+  uint64_t total{0};
+  ssize_t res;
+  while ((res = read(m_serialFd, buf, sizeof(buf))) > 0) {
+    total += static_cast<uint64_t>(res);
+  }
+
+  if (total == 0) {
+    return;
+  }
+
+  m_discardedBytes += total;
+  if (m_awaitingLateResponse) {
+    m_lateResponseCount++;
+    m_awaitingLateResponse = false;
+  }
+}
+
+void Automower::handleResponseTimeout(std::string const &msg) noexcept
+{
+  m_responseTimeoutCount++;
+  m_consecutiveTimeouts++;
+
+  // Abandon the partial frame, a late answer is thrown away before the next command
+  hcp_ResetSession(&m_session);
+  tcflush(m_serialFd, TCIFLUSH);
+  m_awaitingLateResponse = true;
+
+  std::cerr << "No response to " << msg << " within " << m_config.responseTimeout.count()
+    << " ms (timeouts: " << m_responseTimeoutCount << ", late responses: " << m_lateResponseCount
+    << ", discarded bytes: " << m_discardedBytes << ")" << std::endl;
+
+  if (m_consecutiveTimeouts >= m_config.maxConsecutiveTimeouts) {
+    // Treat the mower as unreachable, the regulator stops the wheels and a
+    // supervisor is expected to restart the service.
+    std::cerr << "Lost contact with the mower after " << m_consecutiveTimeouts
+      << " consecutive timeouts." << std::endl;
+    m_userStop.store(true);
+    m_isRunning.store(false);
+  }
+}
+
+void Automower::onWheelPowerAcknowledged(hcp_tResult const &)
+{
+  m_lastPower = m_pendingPower;
+}
+
+void Automower::onWheelMotorData(hcp_tResult const &result)
+{
+  if (result.parameterCount < 6) {
+    return;
+  }
+
+  float const leftSpeed{static_cast<float>(result.parameters[1].value.i16) / 1000.0f};
+  float const rightSpeed{static_cast<float>(result.parameters[4].value.i16) / 1000.0f};
+  m_currentLeftSpeed.store(leftSpeed);
+  m_currentRightSpeed.store(rightSpeed);
+
+  cluon::data::TimeStamp const ts{cluon::time::now()};
+  uint32_t const id{m_config.senderStamp};
+
+  opendlv::proxy::GroundSpeedReading speed;
+  speed.groundSpeed(leftSpeed);
+  m_od4.send(speed, ts, id);
+  speed.groundSpeed(rightSpeed);
+  m_od4.send(speed, ts, id + 1);
+
+  opendlv::proxy::ElectricCurrentReading current;
+  current.electricCurrent(static_cast<float>(result.parameters[2].value.i16) / 1000.0f);
+  m_od4.send(current, ts, id);
+  current.electricCurrent(static_cast<float>(result.parameters[5].value.i16) / 1000.0f);
+  m_od4.send(current, ts, id + 1);
+
+  opendlv::logic::sensation::Equilibrioception motion;
+  motion.vx((leftSpeed + rightSpeed) / 2.0f);
+  motion.yawRate(static_cast<float>((rightSpeed - leftSpeed) / m_wheelBaseWidth));
+  m_od4.send(motion, ts, id);
+}
+
+void Automower::onSensorData(hcp_tResult const &result)
+{
+  if (result.parameterCount <= 5) {
+    return;
+  }
+
+  // Mower internally uses nose up as positive pitch, we use nose down
+  float const pitch{static_cast<float>(-result.parameters[2].value.i16 / 10.0 * M_PI / 180.0)};
+  float const roll{static_cast<float>(result.parameters[3].value.i16 / 10.0 * M_PI / 180.0)};
+
+  cluon::data::TimeStamp const ts{cluon::time::now()};
+  opendlv::proxy::AngleReading angle;
+  angle.angle(pitch);
+  m_od4.send(angle, ts, m_config.senderStamp + 20);
+  angle.angle(roll);
+  m_od4.send(angle, ts, m_config.senderStamp + 21);
+}
+
+void Automower::onSafetyStatus(hcp_tResult const &result)
+{
+  if (result.parameterCount <= 12) {
+    return;
+  }
+
+  bool const userStop{result.parameters[0].value.b != 0};
+  if (userStop && !m_userStop.load() && m_config.verbose) {
+    std::cout << "User stop pressed." << std::endl;
+  }
+  m_userStop.store(userStop);
+
+  cluon::data::TimeStamp const ts{cluon::time::now()};
+  publishSwitchState(userStop, 30, ts);
+  publishSwitchState(result.parameters[2].value.b != 0, 31, ts);
+  publishSwitchState(result.parameters[5].value.b != 0, 32, ts);
+  publishSwitchState(result.parameters[12].value.b != 0, 33, ts);
+}
+
+void Automower::onChargingPower(hcp_tResult const &result)
+{
+  if (result.parameterCount == 1) {
+    publishSwitchState(result.parameters[0].value.b == 1, 34, cluon::time::now());
+  }
+}
+
+void Automower::onBatteryData(hcp_tResult const &result)
+{
+  if (result.parameterCount <= 7) {
+    return;
+  }
+
+  cluon::data::TimeStamp const ts{cluon::time::now()};
+  uint32_t const id{m_config.senderStamp};
+
+  opendlv::proxy::VoltageReading voltage;
+  voltage.voltage(static_cast<float>(result.parameters[0].value.u16) / 1000.0f);
+  m_od4.send(voltage, ts, id + 10);
+  voltage.voltage(static_cast<float>(result.parameters[5].value.u16) / 1000.0f);
+  m_od4.send(voltage, ts, id + 11);
+
+  opendlv::proxy::ElectricCurrentReading current;
+  current.electricCurrent(static_cast<float>(result.parameters[2].value.i16) / 1000.0f);
+  m_od4.send(current, ts, id + 10);
+  current.electricCurrent(static_cast<float>(result.parameters[7].value.i16) / 1000.0f);
+  m_od4.send(current, ts, id + 11);
+}
+
+void Automower::onGpsData(hcp_tResult const &result)
+{
+  if (result.parameterCount != 15) {
+    return;
+  }
+
+  uint8_t const north{result.parameters[3].value.u8};
+  uint8_t const east{result.parameters[4].value.u8};
+  uint32_t const latitudeDegMinutes{result.parameters[5].value.u32};
+  uint32_t const latitudeDecimalMinute{result.parameters[6].value.u32};
+  uint32_t const longitudeDegMinutes{result.parameters[7].value.u32};
+  uint32_t const longitudeDecimalMinute{result.parameters[8].value.u32};
+  uint8_t const gpsStatus{result.parameters[14].value.u8};
+  if (gpsStatus == 0) {
+    // No fix
+    return;
+  }
+
+  double latitude{latitudeDegMinutes / 100 + (latitudeDegMinutes % 100 + latitudeDecimalMinute * 0.0001) / 60.0};
+  double longitude{longitudeDegMinutes / 100 + (longitudeDegMinutes % 100 + longitudeDecimalMinute * 0.0001) / 60.0};
+  if (north != 1) {
+    latitude = -latitude;
+  }
+  if (east != 1) {
+    longitude = -longitude;
+  }
+
+  opendlv::proxy::GeodeticWgs84Reading position;
+  position.latitude(latitude);
+  position.longitude(longitude);
+  m_od4.send(position, cluon::time::now(), m_config.senderStamp);
+}
+
+void Automower::onKeepAlive(hcp_tResult const &)
+{
+  // Only sent to prevent the mower from going to sleep.
+}
+
+void Automower::publishSwitchState(bool state, uint32_t offset, cluon::data::TimeStamp const &ts)
+{
+  opendlv::proxy::SwitchStateReading reading;
+  reading.state(state ? 1 : 0);
+  m_od4.send(reading, ts, m_config.senderStamp + offset);
+}
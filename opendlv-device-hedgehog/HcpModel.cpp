@@ -0,0 +1,112 @@
+#include "hcpmodel.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+void *hcpMalloc(hcp_Size_t size, void *)
+{
+  return malloc(size);
+}
+
+void hcpFree(void *dest, void *)
+{
+  free(dest);
+}
+
+void *hcpMemcpy(void *dest, void const *source, hcp_Size_t size, void *)
+{
+  return memcpy(dest, source, size);
+}
+
+void *hcpMemset(void *dest, hcp_Int value, hcp_Size_t len, void *)
+{
+  return memset(dest, value, len);
+}
+
+std::string loadJsonModel(std::string const &fileName)
+{
+  std::ifstream file(fileName);
+  std::stringstream contents;
+  if (file.is_open()) {
+    contents << file.rdbuf();
+  }
+  return contents.str();
+}
+
+}
+
+HcpModel::HcpModel(std::string const &jsonModelFile) noexcept
+  : m_host{}
+  , m_state{nullptr}
+  , m_modelId{-1}
+  , m_codecName{"amg3"}
+  , m_isLoaded{false}
+{
+  // A host with malloc makes all vectors of the state dynamic, so models and
+  // parameters are not limited by the HCP_MAXSIZE_* constants.
+  m_host.free_ = hcpFree;
+  m_host.malloc_ = hcpMalloc;
+  m_host.memcpy_ = hcpMemcpy;
+  m_host.memset_ = hcpMemset;
+
+  m_state = static_cast<hcp_tState *>(m_host.malloc_(hcp_SizeOfState(), m_host.context));
+  if (hcp_NewState(m_state, &m_host) != HCP_NOERROR) {
+    std::cerr << "Could not initialize HCP state." << std::endl;
+    return;
+  }
+
+  std::string const model{loadJsonModel(jsonModelFile)};
+  if (model.empty()) {
+    std::cerr << "Could not load JSON model from " << jsonModelFile << "." << std::endl;
+    return;
+  }
+
+  if (hcp_LoadCodec(m_state, hcp_GetLibrary(), m_codecName, sizeof(m_codecName)) != HCP_NOERROR) {
+    std::cerr << "Could not load AMG3 codec." << std::endl;
+    return;
+  }
+
+  if (hcp_LoadModel(m_state, model.c_str(), static_cast<hcp_Size_t>(model.size()), &m_modelId) != HCP_NOERROR) {
+    std::cerr << "Could not load JSON model." << std::endl;
+    return;
+  }
+  m_isLoaded = true;
+}
+
+HcpModel::~HcpModel()
+{
+  if (m_state != nullptr) {
+    hcp_CloseState(m_state);
+    m_host.free_(m_state, m_host.context);
+    m_state = nullptr;
+  }
+}
+
+bool HcpModel::isLoaded() const noexcept
+{
+  return m_isLoaded;
+}
+
+hcp_tState *HcpModel::state() const noexcept
+{
+  return m_state;
+}
+
+bool HcpModel::openSession(hcp_tCodec &session) noexcept
+{
+  if (!m_isLoaded || (hcp_OpenSession(m_state, m_codecName, static_cast<hcp_Size_t>(m_modelId), &session) != HCP_NOERROR)) {
+    std::cerr << "Could not create new codec instance." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void HcpModel::closeSession(hcp_tCodec &session) noexcept
+{
+  hcp_CloseSession(&session);
+}
@@ -0,0 +1,148 @@
+#include "reactorpool.hpp"
+#include "automower.hpp"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+ReactorPool::ReactorPool(uint32_t numberOfThreads) noexcept
+  : m_reactors{}
+  , m_isRunning{false}
+  , m_nextReactor{0}
+{
+  for (uint32_t i{0}; i < std::max<uint32_t>(numberOfThreads, 1); i++) {
+    m_reactors.emplace_back(new Reactor);
+  }
+}
+
+ReactorPool::~ReactorPool()
+{
+  stop();
+}
+
+void ReactorPool::add(Automower &link) noexcept
+{
+  // Round robin, the links of a process are expected to be equally busy.
+  m_reactors[m_nextReactor]->links.push_back(&link);
+  m_nextReactor = (m_nextReactor + 1) % m_reactors.size();
+}
+
+bool ReactorPool::start() noexcept
+{
+  for (auto &reactor : m_reactors) {
+    if (reactor->links.empty()) {
+      continue;
+    }
+
+    reactor->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    reactor->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((reactor->epollFd < 0) || (reactor->wakeFd < 0)) {
+      std::cerr << "Could not create reactor: " << strerror(errno) << std::endl;
+      stop();
+      return false;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    bool isAdded{epoll_ctl(reactor->epollFd, EPOLL_CTL_ADD, reactor->wakeFd, &event) == 0};
+    for (auto link : reactor->links) {
+      event.data.ptr = link;
+      isAdded = isAdded && (epoll_ctl(reactor->epollFd, EPOLL_CTL_ADD, link->serialFd(), &event) == 0);
+      link->attach(reactor->wakeFd);
+    }
+    if (!isAdded) {
+      std::cerr << "Could not watch the serial ports: " << strerror(errno) << std::endl;
+      stop();
+      return false;
+    }
+  }
+
+  m_isRunning.store(true);
+  for (auto &reactor : m_reactors) {
+    if (!reactor->links.empty()) {
+      reactor->thread = std::thread(&ReactorPool::run, this, std::ref(*reactor));
+    }
+  }
+  return true;
+}
+
+void ReactorPool::stop() noexcept
+{
+  m_isRunning.store(false);
+  for (auto &reactor : m_reactors) {
+    if (reactor->thread.joinable()) {
+      uint64_t const one{1};
+      if (write(reactor->wakeFd, &one, sizeof(one)) < 0) {
+        // Counter saturated, the reactor is awake anyway.
+      }
+      reactor->thread.join();
+    }
+    for (auto link : reactor->links) {
+      link->attach(-1);
+    }
+    if (reactor->wakeFd >= 0) {
+      close(reactor->wakeFd);
+      reactor->wakeFd = -1;
+    }
+    if (reactor->epollFd >= 0) {
+      close(reactor->epollFd);
+      reactor->epollFd = -1;
+    }
+  }
+}
+
+void ReactorPool::run(Reactor &reactor) noexcept
+{
+  std::vector<Automower *> running{reactor.links};
+  std::vector<struct epoll_event> events(running.size() + 1);
+
+  while (m_isRunning.load() && !running.empty()) {
+    auto const now{std::chrono::steady_clock::now()};
+    auto wakeup{now + std::chrono::seconds(1)};
+    for (auto link : running) {
+      wakeup = std::min(wakeup, link->service(now));
+    }
+
+    // A link that lost contact with its mower is powered off and left alone,
+    // the others keep going.
+    for (auto it = running.begin(); it != running.end();) {
+      if ((*it)->isRunning()) {
+        ++it;
+        continue;
+      }
+      epoll_ctl(reactor.epollFd, EPOLL_CTL_DEL, (*it)->serialFd(), nullptr);
+      (*it)->shutDown();
+      it = running.erase(it);
+    }
+
+    auto const timeout{(wakeup > now)
+      ? std::chrono::duration_cast<std::chrono::milliseconds>(wakeup - now).count() + 1 : 0};
+    int32_t const count{epoll_wait(reactor.epollFd, events.data(), static_cast<int>(events.size()),
+        static_cast<int>(timeout))};
+    for (int32_t i{0}; i < count; i++) {
+      auto link = static_cast<Automower *>(events[static_cast<size_t>(i)].data.ptr);
+      if (link == nullptr) {
+        uint64_t counter;
+        if (read(reactor.wakeFd, &counter, sizeof(counter)) < 0) {
+          // Nothing to drain, eventfd is non-blocking.
+        }
+      } else if (link->isRunning()) {
+        if (events[static_cast<size_t>(i)].events & (EPOLLERR | EPOLLHUP)) {
+          link->onSerialError();
+        } else {
+          link->onReadable();
+        }
+      }
+    }
+  }
+
+  for (auto link : running) {
+    link->shutDown();
+  }
+}
@@ -0,0 +1,185 @@
+#ifndef AUTOMOWER_HPP
+#define AUTOMOWER_HPP
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+
+#include "am_driver_safe/automower_serial.h"
+#include "hcpmodel.hpp"
+#include "mailbox.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Sender stamps are offsets from the configured --id:
+//   GroundSpeedReading, ElectricCurrentReading   +0 left wheel, +1 right wheel
+//   VoltageReading, ElectricCurrentReading       +10 battery A, +11 battery B
+//   AngleReading                                 +20 pitch, +21 roll
+//   SwitchStateReading                           +30 user stop, +31 lifted,
+//                                                +32 collision, +33 charging,
+//                                                +34 in charging station
+//   GeodeticWgs84Reading, Equilibrioception      +0
+//
+// One instance drives one mower over its serial link. The link does not own
+// a thread: a ReactorPool thread calls service() and onReadable(), which
+// start, complete or time out one transaction at a time without blocking,
+// so one thread serves many links.
+class Automower {
+ public:
+  struct Config {
+    std::string serialPort{};
+    Husqvarna::SerialConfig serial{};
+    uint32_t senderStamp{};
+    float regulatorFreq{};
+    std::chrono::milliseconds requestTimeout{};
+    std::chrono::milliseconds responseTimeout{};
+    uint32_t maxConsecutiveTimeouts{};
+    bool verbose{};
+  };
+
+ private:
+  struct MotionRequest {
+    float vx{};
+    float yawRate{};
+    std::chrono::steady_clock::time_point received{};
+  };
+
+  struct WheelPowerCommand {
+    int16_t left{};
+    int16_t right{};
+    bool powerOff{};
+  };
+
+  using ResultHandler = void (Automower::*)(hcp_tResult const &);
+
+  struct PolledCommand {
+    std::string command{};
+    std::chrono::microseconds period{};
+    std::chrono::steady_clock::time_point nextDue{};
+    ResultHandler handler{};
+  };
+
+  // The command in flight, at most one per link. The response is decoded
+  // into storage owned by whoever started the transaction.
+  struct Transaction {
+    std::string command{};
+    ResultHandler handler{};
+    std::chrono::steady_clock::time_point deadline{};
+    hcp_tResultStorage *response{};
+    int32_t receivedBytes{};
+    bool isActive{};
+    bool isComplete{};
+    bool isSuccessful{};
+  };
+
+  class PidRegulator {
+   public:
+    PidRegulator() noexcept;
+    void init(double p, double i, double d) noexcept;
+    void restart() noexcept;
+    double update(double currentSignal, double wantedSignal) noexcept;
+
+   private:
+    double m_p;
+    double m_i;
+    double m_d;
+    double m_pErr;
+    double m_iErr;
+    double m_dErr;
+  };
+
+ private:
+  Automower(Automower const &) = delete;
+  Automower(Automower &&) = delete;
+  Automower &operator=(Automower const &) = delete;
+  Automower &operator=(Automower &&) = delete;
+
+ public:
+  Automower(cluon::OD4Session &, HcpModel &, Config const &) noexcept;
+  ~Automower();
+
+ public:
+  bool isRunning() const noexcept;
+  std::string const &serialPort() const noexcept;
+  void setGroundMotionRequest(opendlv::proxy::GroundMotionRequest const &) noexcept;
+  void regulate() noexcept;
+
+  // Called by the reactor thread the link is attached to.
+  int32_t serialFd() const noexcept;
+  void attach(int32_t) noexcept;
+  std::chrono::steady_clock::time_point service(std::chrono::steady_clock::time_point) noexcept;
+  void onReadable() noexcept;
+  void onSerialError() noexcept;
+  void shutDown() noexcept;
+
+ private:
+  bool setUp() noexcept;
+  void tearDown() noexcept;
+  bool initAutomowerBoard() noexcept;
+  void wakeReactor() noexcept;
+  bool sendWheelPower(WheelPowerCommand const &) noexcept;
+  bool beginTransaction(std::string const &, ResultHandler, hcp_tResultStorage &) noexcept;
+  void receive() noexcept;
+  void finishTransaction(bool) noexcept;
+  bool awaitTransaction() noexcept;
+  bool transact(std::string const &, hcp_tResultStorage &) noexcept;
+  bool writeSerial(hcp_Uint8 const *, int32_t) noexcept;
+  void discardLateResponses() noexcept;
+  void handleResponseTimeout(std::string const &) noexcept;
+
+  void onWheelPowerAcknowledged(hcp_tResult const &);
+
+  void onWheelMotorData(hcp_tResult const &);
+  void onSensorData(hcp_tResult const &);
+  void onSafetyStatus(hcp_tResult const &);
+  void onChargingPower(hcp_tResult const &);
+  void onBatteryData(hcp_tResult const &);
+  void onGpsData(hcp_tResult const &);
+  void onKeepAlive(hcp_tResult const &);
+
+  void publishSwitchState(bool, uint32_t, cluon::data::TimeStamp const &);
+
+ private:
+  cluon::OD4Session &m_od4;
+  HcpModel &m_model;
+  Config const m_config;
+
+  hcp_tCodec m_session;
+  bool m_hasSession;
+  int32_t m_serialFd;
+  std::atomic<int32_t> m_wakeFd;
+
+  double m_wheelBaseWidth;
+  double m_wheelDiameter;
+
+  Mailbox<MotionRequest> m_motionRequests;
+  Mailbox<WheelPowerCommand> m_powerCommands;
+
+  // Written by the reactor, read by the regulator.
+  std::atomic<bool> m_isRunning;
+  std::atomic<bool> m_userStop;
+  std::atomic<float> m_currentLeftSpeed;
+  std::atomic<float> m_currentRightSpeed;
+
+  // Owned by the regulator.
+  PidRegulator m_leftWheelPid;
+  PidRegulator m_rightWheelPid;
+  bool m_wheelsOff;
+
+  // Owned by the reactor.
+  std::vector<PolledCommand> m_polledCommands;
+  Transaction m_transaction;
+  hcp_tResultStorage m_response;
+  WheelPowerCommand m_pendingPower;
+  WheelPowerCommand m_lastPower;
+  uint32_t m_consecutiveTimeouts;
+  bool m_awaitingLateResponse;
+  uint64_t m_responseTimeoutCount;
+  uint64_t m_lateResponseCount;
+  uint64_t m_discardedBytes;
+};
+
+#endif
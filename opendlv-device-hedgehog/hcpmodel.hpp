@@ -0,0 +1,45 @@
+#ifndef HCPMODEL_HPP
+#define HCPMODEL_HPP
+
+extern "C" {
+#include "hcp/hcp_types.h"
+#include "hcp/hcp_runtime.h"
+#include "hcp/hcp_string.h"
+#include "hcp/hcp_library.h"
+
+#include "hcp/amg3.h"
+}
+
+#include <string>
+
+// HCP state with the AMG3 codec library and the JSON model loaded once and
+// shared by all serial links of the process. After construction the state is
+// only read: every link opens its own codec session, which holds the link's
+// command set and receive buffer, so links encode and decode on different
+// threads without locking.
+class HcpModel {
+ private:
+  HcpModel(HcpModel const &) = delete;
+  HcpModel(HcpModel &&) = delete;
+  HcpModel &operator=(HcpModel const &) = delete;
+  HcpModel &operator=(HcpModel &&) = delete;
+
+ public:
+  explicit HcpModel(std::string const &) noexcept;
+  ~HcpModel();
+
+ public:
+  bool isLoaded() const noexcept;
+  hcp_tState *state() const noexcept;
+  bool openSession(hcp_tCodec &) noexcept;
+  void closeSession(hcp_tCodec &) noexcept;
+
+ private:
+  hcp_tHost m_host;
+  hcp_tState *m_state;
+  hcp_Int m_modelId;
+  char m_codecName[5];
+  bool m_isLoaded;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef MAILBOX_HPP
+#define MAILBOX_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Single-producer/single-consumer mailbox that always hands out the latest
+// posted value. Implemented as a triple buffer: the producer and the consumer
+// each own one slot and swap it with the shared middle slot using a single
+// atomic exchange, so neither side ever blocks or sees a torn value.
+template <typename T>
+class Mailbox {
+ private:
+  Mailbox(Mailbox const &) = delete;
+  Mailbox(Mailbox &&) = delete;
+  Mailbox &operator=(Mailbox const &) = delete;
+  Mailbox &operator=(Mailbox &&) = delete;
+
+ public:
+  Mailbox() noexcept
+    : m_slots{}
+    , m_middle{1}
+    , m_back{0}
+    , m_front{2}
+  {
+  }
+  ~Mailbox() = default;
+
+ public:
+  // Producer side.
+  void post(T const &value) noexcept
+  {
+    m_slots[m_back] = value;
+    uint8_t const previous = m_middle.exchange(m_back | NEW_DATA, std::memory_order_acq_rel);
+    m_back = previous & INDEX_MASK;
+  }
+
+  // Consumer side. Copies the latest value into value, returns true if it
+  // was posted after the previous fetch.
+  bool fetch(T &value) noexcept
+  {
+    bool const isNew = (m_middle.load(std::memory_order_relaxed) & NEW_DATA) != 0;
+    if (isNew) {
+      uint8_t const previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+      m_front = previous & INDEX_MASK;
+    }
+    value = m_slots[m_front];
+    return isNew;
+  }
+
+ private:
+  static constexpr uint8_t INDEX_MASK{0x03};
+  static constexpr uint8_t NEW_DATA{0x04};
+
+  std::array<T, 3> m_slots;
+  std::atomic<uint8_t> m_middle;
+  uint8_t m_back;
+  uint8_t m_front;
+};
+
+#endif
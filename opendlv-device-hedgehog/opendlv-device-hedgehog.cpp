@@ -1,49 +1,131 @@
-#include <ncurses.h>
-#include <poll.h>
-#include <thread>
-#include <sys/stat.h> // checking if file/dir exist
-#include <fstream>
-#include <string>
-
+#include "cluon-complete.hpp"
 #include "opendlv-standard-message-set.hpp"
-#include "automower_hrp.json"
-#include "behavior.hpp"
 
-  
-}
+#include "automower.hpp"
+#include "hcpmodel.hpp"
+#include "reactorpool.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Distance between the sender stamp bases of the mowers served by one process.
+uint32_t const SENDER_STAMP_STRIDE{100};
 
-int32_t main(int32_t argc, char **argv) {
+int32_t main(int32_t argc, char **argv)
+{
   int32_t retCode{0};
   auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
-  if (0 == commandlineArguments.count("cid") || 0 == commandlineArguments.count("freq")) {
-    std::cerr << argv[0] << " tests the Hedgehog platform by sending actuation commands and reacting to sensor input." << std::endl;
-    std::cerr << "Usage:   " << argv[0] << " --freq=<Integration frequency> --cid=<OpenDaVINCI session> [--verbose]" << std::endl;
-    std::cerr << "Example: " << argv[0] << " --freq=10 --cid=111" << std::endl;
+  if ( (0 == commandlineArguments.count("cid")) ||
+     (0 == commandlineArguments.count("freq")) ||
+     (0 == commandlineArguments.count("serial-port")) ||
+     (0 == commandlineArguments.count("json")) ) {
+    std::cerr << argv[0] << " interfaces with Husqvarna Automowers over their HRP serial links, regulates the wheels from GroundMotionRequest messages and publishes the mower sensors to an OD4Session." << std::endl;
+    std::cerr << "Usage:   " << argv[0] << " --cid=<OpenDaVINCI session> --freq=<Regulator frequency> --serial-port=<Serial port>[,<Serial port>...] --json=<HCP model> [--id=<Sender stamp base, default 0>] [--request-id=<Sender stamp of GroundMotionRequest to follow, default 0>] [--reactors=<Threads serving the serial ports, default 1>] [--baud-rate=<default 115200>] [--hardware-flow-control] [--usb-latency-timer=<ms, default 1>] [--request-timeout=<ms, default 500>] [--response-timeout=<ms, default 100>] [--max-consecutive-timeouts=<default 3>] [--verbose]" << std::endl;
+    std::cerr << "         The mower on the n:th serial port (counting from 0) uses the sender stamp base --id + " << SENDER_STAMP_STRIDE << "*n and follows the GroundMotionRequest with sender stamp --request-id + n." << std::endl;
+    std::cerr << "Example: " << argv[0] << " --cid=111 --freq=50 --serial-port=/dev/ttyACM0 --json=automower_hrp.json" << std::endl;
     retCode = 1;
   } else {
     bool const VERBOSE{commandlineArguments.count("verbose") != 0};
-    uint16_t const CID = std::stoi(commandlineArguments["cid"]);
-    uint32_t const FRAME_ID = std::stoi(commandlineArguments["frame-id"]);
-   
+    uint16_t const CID = static_cast<uint16_t>(std::stoi(commandlineArguments["cid"]));
+    float const FREQ = std::stof(commandlineArguments["freq"]);
+    uint32_t const REQUEST_ID{(commandlineArguments.count("request-id") != 0)
+      ? static_cast<uint32_t>(std::stoi(commandlineArguments["request-id"])) : 0};
+    uint32_t const REACTORS{(commandlineArguments.count("reactors") != 0)
+      ? static_cast<uint32_t>(std::stoi(commandlineArguments["reactors"])) : 1};
+    std::vector<std::string> serialPorts;
+    {
+      std::stringstream list{commandlineArguments["serial-port"]};
+      std::string serialPort;
+      while (std::getline(list, serialPort, ',')) {
+        if (!serialPort.empty()) {
+          serialPorts.push_back(serialPort);
+        }
+      }
+    }
 
-Automower automower
+    Automower::Config config;
+    config.serial = Husqvarna::defaultSerialConfig();
+    if (commandlineArguments.count("baud-rate") != 0) {
+      config.serial.baudRate = std::stoi(commandlineArguments["baud-rate"]);
+    }
+    config.serial.hardwareFlowControl = (commandlineArguments.count("hardware-flow-control") != 0);
+    if (commandlineArguments.count("usb-latency-timer") != 0) {
+      config.serial.usbLatencyTimer = std::stoi(commandlineArguments["usb-latency-timer"]);
+    }
+    config.senderStamp = (commandlineArguments.count("id") != 0)
+      ? static_cast<uint32_t>(std::stoi(commandlineArguments["id"])) : 0;
+    config.regulatorFreq = FREQ;
+    config.requestTimeout = std::chrono::milliseconds((commandlineArguments.count("request-timeout") != 0)
+      ? std::stoi(commandlineArguments["request-timeout"]) : 500);
+    config.responseTimeout = std::chrono::milliseconds((commandlineArguments.count("response-timeout") != 0)
+      ? std::stoi(commandlineArguments["response-timeout"]) : 100);
+    config.maxConsecutiveTimeouts = (commandlineArguments.count("max-consecutive-timeouts") != 0)
+      ? static_cast<uint32_t>(std::stoi(commandlineArguments["max-consecutive-timeouts"])) : 3;
+    config.verbose = VERBOSE;
 
-auto onGroundMotionRequest{[&automower](cluon::data::envelope &&envelope)
-{
-  if (envelope.senderStamp() == 0){
-     auto const groudMotion = cluon::extractMessage<opendlv::proxy::GroundMotionRequest>(std::move(envelope));
-     automower.RequestLinearSpeed(groudMotion);
-     automower.RequestAngularSpeed(groundMotion);
-     automower.velocity();
-     automower.getWheelData();
-     
-     
-  
-     
-  } else if (envelope.senderStamp() == 9999) {
-     auto const gst = cluon::extractMessage<opendlv::proxy::GroundMotionRequest>(std::move(envelope));
-     float const groundMotion = gst.groundMotion();
-     
-     }
-  }};
-			   
+    cluon::OD4Session od4{CID};
+
+    // The model is parsed once and only read afterwards, every mower opens
+    // its own codec session on it.
+    HcpModel model{commandlineArguments["json"]};
+    if (!model.isLoaded()) {
+      return 1;
+    }
+
+    std::vector<std::unique_ptr<Automower>> automowers;
+    for (auto const &serialPort : serialPorts) {
+      Automower::Config linkConfig{config};
+      linkConfig.serialPort = serialPort;
+      linkConfig.senderStamp = config.senderStamp + SENDER_STAMP_STRIDE * static_cast<uint32_t>(automowers.size());
+      automowers.emplace_back(new Automower(od4, model, linkConfig));
+      if (!automowers.back()->isRunning()) {
+        std::cerr << "Could not connect to the mower on " << serialPort << "." << std::endl;
+        return 1;
+      }
+    }
+
+    ReactorPool reactors{REACTORS};
+    for (auto &automower : automowers) {
+      reactors.add(*automower);
+    }
+    if (!reactors.start()) {
+      return 1;
+    }
+
+    // Runs on the OD4 receiver thread, only hands the request over.
+    auto onGroundMotionRequest{[&automowers, &REQUEST_ID](cluon::data::Envelope &&envelope)
+      {
+        uint32_t const senderStamp{envelope.senderStamp()};
+        if ((senderStamp >= REQUEST_ID) && (senderStamp - REQUEST_ID < automowers.size())) {
+          auto const request = cluon::extractMessage<opendlv::proxy::GroundMotionRequest>(std::move(envelope));
+          automowers[senderStamp - REQUEST_ID]->setGroundMotionRequest(request);
+        }
+      }};
+    od4.dataTrigger(opendlv::proxy::GroundMotionRequest::ID(), onGroundMotionRequest);
+
+    auto atFrequency{[&automowers]() -> bool
+      {
+        bool isAnyRunning{false};
+        for (auto &automower : automowers) {
+          automower->regulate();
+          isAnyRunning = isAnyRunning || automower->isRunning();
+        }
+        return isAnyRunning;
+      }};
+    od4.timeTrigger(FREQ, atFrequency);
+
+    // Stop the reactors before the links and the model go away.
+    reactors.stop();
+    for (auto const &automower : automowers) {
+      if (!automower->isRunning()) {
+        retCode = 1;
+      }
+    }
+  }
+  return retCode;
+}
@@ -0,0 +1,50 @@
+#ifndef REACTORPOOL_HPP
+#define REACTORPOOL_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class Automower;
+
+// Threads driving the serial links of the process. Each link is assigned to
+// one thread, which waits with epoll on the serial ports of its links and on
+// an eventfd signalled by the regulators, and lets every link start, complete
+// or time out its transaction. Links are added before start(), stop() powers
+// off their wheels before the threads exit.
+class ReactorPool {
+ private:
+  struct Reactor {
+    int32_t epollFd{-1};
+    int32_t wakeFd{-1};
+    std::vector<Automower *> links{};
+    std::thread thread{};
+  };
+
+ private:
+  ReactorPool(ReactorPool const &) = delete;
+  ReactorPool(ReactorPool &&) = delete;
+  ReactorPool &operator=(ReactorPool const &) = delete;
+  ReactorPool &operator=(ReactorPool &&) = delete;
+
+ public:
+  explicit ReactorPool(uint32_t) noexcept;
+  ~ReactorPool();
+
+ public:
+  void add(Automower &) noexcept;
+  bool start() noexcept;
+  void stop() noexcept;
+
+ private:
+  void run(Reactor &) noexcept;
+
+ private:
+  std::vector<std::unique_ptr<Reactor>> m_reactors;
+  std::atomic<bool> m_isRunning;
+  size_t m_nextReactor;
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include "mailbox.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+int32_t failures{0};
+
+#define CHECK(condition)                                                        \
+  do {                                                                          \
+    if (!(condition)) {                                                         \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition         \
+                << ") failed" << std::endl;                                     \
+      failures++;                                                               \
+    }                                                                           \
+  } while (false)
+
+// Written field by field, a torn copy breaks the invariant.
+struct Sample {
+  uint64_t sequence;
+  uint64_t inverse;
+  uint64_t padding[6];
+};
+
+Sample makeSample(uint64_t sequence) noexcept
+{
+  Sample sample{};
+  sample.sequence = sequence;
+  sample.inverse = ~sequence;
+  for (auto &p : sample.padding) {
+    p = sequence;
+  }
+  return sample;
+}
+
+bool isIntact(Sample const &sample) noexcept
+{
+  bool intact = (sample.inverse == ~sample.sequence);
+  for (auto const &p : sample.padding) {
+    intact = intact && (p == sample.sequence);
+  }
+  return intact;
+}
+
+void testEmpty()
+{
+  Mailbox<int32_t> mailbox;
+  int32_t value{-1};
+  CHECK(!mailbox.fetch(value));
+  CHECK(0 == value);
+}
+
+void testLatestWins()
+{
+  Mailbox<int32_t> mailbox;
+  int32_t value{0};
+
+  mailbox.post(1);
+  CHECK(mailbox.fetch(value));
+  CHECK(1 == value);
+
+  // Nothing new, the last value is handed out again.
+  CHECK(!mailbox.fetch(value));
+  CHECK(1 == value);
+
+  // Values posted in between are overwritten.
+  mailbox.post(2);
+  mailbox.post(3);
+  mailbox.post(4);
+  CHECK(mailbox.fetch(value));
+  CHECK(4 == value);
+  CHECK(!mailbox.fetch(value));
+  CHECK(4 == value);
+
+  // The slots keep rotating.
+  for (int32_t i{5}; i < 20; i++) {
+    mailbox.post(i);
+    if (0 == (i % 3)) {
+      CHECK(mailbox.fetch(value));
+      CHECK(i == value);
+    }
+  }
+  CHECK(mailbox.fetch(value));
+  CHECK(19 == value);
+}
+
+void testConcurrent()
+{
+  uint64_t const COUNT{1000000};
+  Mailbox<Sample> mailbox;
+
+  std::thread producer([&mailbox, COUNT]() {
+      for (uint64_t i{1}; i <= COUNT; i++) {
+        mailbox.post(makeSample(i));
+      }
+    });
+
+  uint64_t last{0};
+  uint64_t torn{0};
+  uint64_t backwards{0};
+  Sample sample{};
+  while (last < COUNT) {
+    if (mailbox.fetch(sample)) {
+      if (!isIntact(sample)) {
+        torn++;
+      }
+      if (sample.sequence <= last) {
+        backwards++;
+      }
+      last = sample.sequence;
+    }
+  }
+  producer.join();
+
+  CHECK(0 == torn);
+  CHECK(0 == backwards);
+  CHECK(COUNT == last);
+  CHECK(!mailbox.fetch(sample));
+  CHECK(COUNT == sample.sequence);
+}
+
+}
+
+int32_t main()
+{
+  testEmpty();
+  testLatestWins();
+  testConcurrent();
+  if (0 != failures) {
+    std::cerr << failures << " check(s) failed." << std::endl;
+  }
+  return (0 == failures) ? 0 : 1;
+}
@@ -0,0 +1,316 @@
+#include "automower.hpp"
+#include "hcpmodel.hpp"
+#include "reactorpool.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Drives many links from one reactor thread against mock mowers on
+// pseudo terminals, and checks that every link keeps its full poll rate.
+// Prints the CPU time the driver took for it.
+
+namespace {
+
+int32_t failures{0};
+
+#define CHECK(condition)                                                        \
+  do {                                                                          \
+    if (!(condition)) {                                                         \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition         \
+                << ") failed" << std::endl;                                     \
+      failures++;                                                               \
+    }                                                                           \
+  } while (false)
+
+uint32_t const LINKS{32};
+float const REGULATOR_FREQ{50.0f};
+// Commands per second polled by a link that is not driven: the wheel data at
+// the regulator rate, the safety status at 10 Hz, the sensor data at 5 Hz and
+// four more at 1 Hz, see Automower::Automower.
+double const POLLED_RATE{50.0 + 10.0 + 5.0 + 4.0};
+std::chrono::seconds const WARM_UP{1};
+std::chrono::seconds const MEASURED{3};
+
+uint8_t const STX{0x02};
+uint8_t const ETX{0x03};
+uint8_t const EXTENDED_HEADER{0x81};
+
+int64_t cpuTime(clockid_t clock) noexcept
+{
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// CRC-8/MAXIM over the frame between STX and the checksum.
+uint8_t crc8(std::vector<uint8_t> const &bytes) noexcept
+{
+  uint8_t crc{0};
+  for (auto b : bytes) {
+    crc = static_cast<uint8_t>(crc ^ b);
+    for (int32_t i{0}; i < 8; i++) {
+      crc = static_cast<uint8_t>((crc & 1) ? ((crc >> 1) ^ 0x8c) : (crc >> 1));
+    }
+  }
+  return crc;
+}
+
+// Answers every AMG3 request with the same response: device type 10 and mower
+// type 7 for the identification, zeroes for everything else.
+class MockMowers {
+ private:
+  struct Link {
+    int32_t master{-1};
+    int32_t slave{-1};
+    std::string path{};
+    std::vector<uint8_t> received{};
+    std::atomic<uint64_t> requests{0};
+  };
+
+ private:
+  MockMowers(MockMowers const &) = delete;
+  MockMowers(MockMowers &&) = delete;
+  MockMowers &operator=(MockMowers const &) = delete;
+  MockMowers &operator=(MockMowers &&) = delete;
+
+ public:
+  explicit MockMowers(uint32_t count) noexcept
+    : m_links{}
+    , m_isRunning{true}
+    , m_cpuTime{0}
+    , m_thread{}
+  {
+    for (uint32_t i{0}; i < count; i++) {
+      std::unique_ptr<Link> link{new Link};
+      link->master = posix_openpt(O_RDWR | O_NOCTTY);
+      if ((link->master < 0) || (grantpt(link->master) != 0) || (unlockpt(link->master) != 0)) {
+        continue;
+      }
+      struct termios term;
+      tcgetattr(link->master, &term);
+      cfmakeraw(&term);
+      tcsetattr(link->master, TCSANOW, &term);
+      link->path = ptsname(link->master);
+      // Held open so that the master does not see a hangup between links.
+      link->slave = open(link->path.c_str(), O_RDWR | O_NOCTTY);
+      m_links.push_back(std::move(link));
+    }
+    m_thread = std::thread(&MockMowers::run, this);
+  }
+
+  ~MockMowers()
+  {
+    m_isRunning.store(false);
+    m_thread.join();
+    for (auto &link : m_links) {
+      close(link->slave);
+      close(link->master);
+    }
+  }
+
+ public:
+  size_t size() const noexcept
+  {
+    return m_links.size();
+  }
+
+  std::string const &path(size_t i) const noexcept
+  {
+    return m_links[i]->path;
+  }
+
+  uint64_t requests(size_t i) const noexcept
+  {
+    return m_links[i]->requests.load();
+  }
+
+  int64_t cpuTime() const noexcept
+  {
+    return m_cpuTime.load();
+  }
+
+ private:
+  void run() noexcept
+  {
+    std::vector<struct pollfd> fds(m_links.size());
+    for (size_t i{0}; i < m_links.size(); i++) {
+      fds[i].fd = m_links[i]->master;
+      fds[i].events = POLLIN;
+    }
+
+    while (m_isRunning.load()) {
+      if (poll(fds.data(), fds.size(), 100) > 0) {
+        for (size_t i{0}; i < fds.size(); i++) {
+          if (fds[i].revents & POLLIN) {
+            serve(*m_links[i]);
+          }
+        }
+      }
+      m_cpuTime.store(::cpuTime(CLOCK_THREAD_CPUTIME_ID));
+    }
+  }
+
+  void serve(Link &link) noexcept
+  {
+    uint8_t buffer[4096];
+    ssize_t const length{read(link.master, buffer, sizeof(buffer))};
+    if (length <= 0) {
+      return;
+    }
+    link.received.insert(link.received.end(), buffer, buffer + length);
+
+    std::vector<uint8_t> &b = link.received;
+    while (true) {
+      size_t start{0};
+      while ((start < b.size()) && (b[start] != STX)) {
+        start++;
+      }
+      b.erase(b.begin(), b.begin() + static_cast<std::ptrdiff_t>(start));
+
+      size_t p{1};
+      if (b.size() < p + 1) {
+        return;
+      }
+      bool const isExtended{b[p] == EXTENDED_HEADER};
+      if (isExtended) {
+        p += 4;
+      }
+      if (b.size() < p + 1) {
+        return;
+      }
+      size_t const typeLength{(b[p] > 0x7f) ? 2u : 1u};
+      std::vector<uint8_t> const type(b.begin() + static_cast<std::ptrdiff_t>(p),
+        b.begin() + static_cast<std::ptrdiff_t>(std::min(p + typeLength, b.size())));
+      p += typeLength;
+      if (b.size() < p + 1) {
+        return;
+      }
+      size_t const bodyLength{b[p]};
+      p++;
+      if (b.size() < p + bodyLength + 2) {
+        return;
+      }
+      b.erase(b.begin(), b.begin() + static_cast<std::ptrdiff_t>(p + bodyLength + 2));
+      link.requests++;
+
+      std::vector<uint8_t> payload(63, 0);
+      payload[1] = 10;
+      payload[2] = 7;
+      std::vector<uint8_t> frame;
+      if (isExtended) {
+        size_t const total{payload.size() + 6};
+        frame.push_back(EXTENDED_HEADER);
+        frame.push_back(static_cast<uint8_t>(total & 0xff));
+        frame.push_back(static_cast<uint8_t>(total >> 8));
+        frame.push_back(0);
+      }
+      frame.insert(frame.end(), type.begin(), type.end());
+      frame.push_back(static_cast<uint8_t>(payload.size()));
+      frame.insert(frame.end(), payload.begin(), payload.end());
+      uint8_t const crc{crc8(frame)};
+      frame.insert(frame.begin(), STX);
+      frame.push_back(crc);
+      frame.push_back(ETX);
+      if (write(link.master, frame.data(), frame.size()) != static_cast<ssize_t>(frame.size())) {
+        std::cerr << "Mock mower could not write its response." << std::endl;
+      }
+    }
+  }
+
+ private:
+  std::vector<std::unique_ptr<Link>> m_links;
+  std::atomic<bool> m_isRunning;
+  std::atomic<int64_t> m_cpuTime;
+  std::thread m_thread;
+};
+
+void testOneReactorKeepsUp(std::string const &json)
+{
+  MockMowers mowers{LINKS};
+  CHECK(LINKS == mowers.size());
+
+  HcpModel model{json};
+  CHECK(model.isLoaded());
+  if (!model.isLoaded()) {
+    return;
+  }
+
+  cluon::OD4Session od4{253};
+
+  Automower::Config config;
+  config.serial = Husqvarna::defaultSerialConfig();
+  config.serial.usbLatencyTimer = 0;
+  config.regulatorFreq = REGULATOR_FREQ;
+  config.requestTimeout = std::chrono::milliseconds(500);
+  config.responseTimeout = std::chrono::milliseconds(100);
+  config.maxConsecutiveTimeouts = 3;
+
+  std::vector<std::unique_ptr<Automower>> automowers;
+  for (size_t i{0}; i < mowers.size(); i++) {
+    Automower::Config linkConfig{config};
+    linkConfig.serialPort = mowers.path(i);
+    linkConfig.senderStamp = 100 * static_cast<uint32_t>(i);
+    automowers.emplace_back(new Automower(od4, model, linkConfig));
+    CHECK(automowers.back()->isRunning());
+  }
+
+  ReactorPool reactors{1};
+  for (auto &automower : automowers) {
+    reactors.add(*automower);
+  }
+  CHECK(reactors.start());
+
+  std::this_thread::sleep_for(WARM_UP);
+  std::vector<uint64_t> before;
+  for (size_t i{0}; i < mowers.size(); i++) {
+    before.push_back(mowers.requests(i));
+  }
+  int64_t const processBefore{cpuTime(CLOCK_PROCESS_CPUTIME_ID)};
+  int64_t const mockBefore{mowers.cpuTime()};
+  auto const start{std::chrono::steady_clock::now()};
+
+  std::this_thread::sleep_for(MEASURED);
+
+  double const elapsed{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+  int64_t const driverCpu{(cpuTime(CLOCK_PROCESS_CPUTIME_ID) - processBefore) - (mowers.cpuTime() - mockBefore)};
+  double minRate{POLLED_RATE};
+  for (size_t i{0}; i < mowers.size(); i++) {
+    double const rate{static_cast<double>(mowers.requests(i) - before[i]) / elapsed};
+    minRate = std::min(minRate, rate);
+    CHECK(rate > 0.95 * POLLED_RATE);
+    CHECK(automowers[i]->isRunning());
+  }
+  std::cout << mowers.size() << " links on one reactor thread, slowest " << minRate << " of "
+    << POLLED_RATE << " commands/s, driver " << 100.0 * static_cast<double>(driverCpu) * 1e-9 / elapsed
+    << "% of one core." << std::endl;
+
+  reactors.stop();
+}
+
+}
+
+int32_t main(int32_t argc, char **argv)
+{
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <HCP model>" << std::endl;
+    return 1;
+  }
+  testOneReactorKeepsUp(argv[1]);
+  if (0 != failures) {
+    std::cerr << failures << " check(s) failed." << std::endl;
+  }
+  return (0 == failures) ? 0 : 1;
+}
@@ -3,19 +3,64 @@
 
 #include <linux/joystick.h>
 #include <fcntl.h>
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <chrono>
 #include <cmath>
+#include <csignal>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
-#include <mutex>
 #include <string>
-#include <thread>
+
+namespace {
+
+// Cleared from the signal handler, std::atomic<bool> is lock-free and
+// therefore safe to touch there.
+std::atomic<bool> isRunning{true};
+
+void handleExitSignal(int)
+{
+  isRunning.store(false);
+}
+
+// Time from reading a changed stick position to having sent it.
+class LatencyStatistics {
+ public:
+  void add(std::chrono::microseconds latency)
+  {
+    int64_t const value{latency.count()};
+    m_count++;
+    m_sum += value;
+    m_min = (m_count == 1) ? value : std::min(m_min, value);
+    m_max = std::max(m_max, value);
+  }
+
+  void print() const
+  {
+    if (m_count == 0) {
+      return;
+    }
+    std::clog << "[opendlv-device-gamepad]: Stick-to-send latency over " << m_count
+      << " changes: min " << m_min << " us, mean " << (m_sum / m_count)
+      << " us, max " << m_max << " us" << std::endl;
+  }
+
+ private:
+  int64_t m_count{0};
+  int64_t m_sum{0};
+  int64_t m_min{0};
+  int64_t m_max{0};
+};
+
+}
 
 
 int32_t main(int32_t argc, char **argv)
@@ -28,6 +73,8 @@ int32_t main(int32_t argc, char **argv)
      (0 == commandlineArguments.count("axis-left-updown")) ||
      (0 == commandlineArguments.count("axis-right-updown")) ) {
    std::cerr << argv[0] << " interfaces with the given PS3 controller to emit ActuationRequest messages to an OD4Session." << std::endl;
+   std::cerr << "Usage:   " << argv[0] << " --cid=<OpenDaVINCI session> --device=<Joystick device> --freq=<Keep-alive frequency> --axis-left-updown=<Axis> --axis-right-updown=<Axis> [--min-interval=<ms between sent changes, default 10>] [--verbose]" << std::endl;
+   std::cerr << "Example: " << argv[0] << " --cid=111 --device=/dev/input/js0 --freq=10 --axis-left-updown=1 --axis-right-updown=4 --min-interval=10" << std::endl;
    retCode = 1;
  
   }
@@ -41,6 +88,9 @@ int32_t main(int32_t argc, char **argv)
     const std::string DEVICE{commandlineArguments["device"]};
     
     const float FREQ = std::stof(commandlineArguments["freq"]); //convert string type to float type
+    const std::chrono::microseconds HEARTBEAT{static_cast<int64_t>(1000000.0f / FREQ)};
+    const std::chrono::milliseconds MIN_INTERVAL{(commandlineArguments.count("min-interval") != 0)
+      ? std::stoi(commandlineArguments["min-interval"]) : 10};
 
    
     int gamepadDevice;
@@ -69,117 +119,142 @@ int32_t main(int32_t argc, char **argv)
       fcntl(gamepadDevice, F_SETFL, O_NONBLOCK);
       //fcntl() manipulate file descriptor , 1st argument is the file descriptor, 2nd determine the commmand 
       //It Sets the file status flags to the value specified by arg (3rd variable)
-      
-      std::mutex valuesMutex; //std::mutex is used to synchronize and protect shared data from being used simultaneously by multiple threads
+
+      // Everything runs on this thread: epoll wakes us up as soon as the
+      // gamepad has data, a changed stick position is sent right away
+      // (but not more often than MIN_INTERVAL), and an unchanged one is
+      // repeated every HEARTBEAT so that the receiver knows we are alive.
+      int epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+      struct epoll_event gamepadEvent {};
+      gamepadEvent.events = EPOLLIN;
+      gamepadEvent.data.fd = gamepadDevice;
+      if ( (-1 == epollFd) || (-1 == ::epoll_ctl(epollFd, EPOLL_CTL_ADD, gamepadDevice, &gamepadEvent)) ) {
+        std::cerr << "[opendlv-device-gamepad]: Could not set up epoll, error: " << errno << ": " << strerror(errno) << std::endl;
+        ::close(gamepadDevice);
+        return 1;
+      }
+
+      std::signal(SIGINT, handleExitSignal);
+      std::signal(SIGTERM, handleExitSignal);
+
       float left{0};
       float right{0};
-      bool hasError{false}; 
-      
+      // Changes are detected on the raw axis values, not on the scaled ones.
+      int16_t leftAxis{0};
+      int16_t rightAxis{0};
+      int16_t sentLeftAxis{0};
+      int16_t sentRightAxis{0};
+      bool hasChanged{false};
+      bool hasError{false};
+      std::chrono::steady_clock::time_point changedAt{};
+      std::chrono::steady_clock::time_point lastSent{};
+      LatencyStatistics latency;
+      auto lastReport{std::chrono::steady_clock::now()};
+
       //Here we just initialize the main variable which will make move the lawnmover : right and left motors
 
-      // Thread to read values.
-      std::thread gamepadReadingThread([&AXIS_LEFT_UPDOWN,
-          &AXIS_RIGHT_UPDOWN,
-          &MIN_AXES_VALUE,
-          &MAX_AXES_VALUE,
-          &VERBOSE,
-          &valuesMutex,
-          &left,
-          &right,
-          &hasError,
-          &gamepadDevice]() {
-          struct timeval timeout {};
-          fd_set setOfFiledescriptorsToReadFrom{}; //select() allow a program to monitor multiple file descriptors, waiting until one or more of the file descriptors become "ready" for some class of input/output operation
-          // fd_set() adds a file descriptor from a set
-        
-          while (!hasError) {
-            // Define timeout for select system call. The timeval struct must be
-            // reinitialized for every select call as it might be modified containing
-            // the actual time slept.
-            timeout.tv_sec  = 0;
-            timeout.tv_usec = 20 * 1000; // Check for new data with 50Hz.
-
-            FD_ZERO(&setOfFiledescriptorsToReadFrom); //fd_zero clears a set : to initialize here
-            FD_SET(gamepadDevice, &setOfFiledescriptorsToReadFrom);
-            ::select(gamepadDevice + 1, &setOfFiledescriptorsToReadFrom, nullptr, nullptr, &timeout);
-
-            if (FD_ISSET(gamepadDevice, &setOfFiledescriptorsToReadFrom)) {
-              std::lock_guard<std::mutex> lck(valuesMutex);
-
-            // select function is set on line 104. When the select statement exits, line 107 check which file 
-            //descriptor has been active and if a file descriptor is part of the set. Then it makes some mutex managment.
-              
-              
-              struct js_event js; //joystick device
-              while (::read(gamepadDevice, &js, sizeof(struct js_event)) > 0) { //reading joystick device
-                float percent{0};
-                switch (js.type & ~JS_EVENT_INIT) {
-                  case JS_EVENT_AXIS:
-                    {
-                      if (AXIS_LEFT_UPDOWN == js.number) {
-                        percent = static_cast<float>(js.value - MIN_AXES_VALUE)/static_cast<float>(MAX_AXES_VALUE-MIN_AXES_VALUE);
-                        left = 1.0f - 2.0f * percent;
-                      }
-
-                      if (AXIS_RIGHT_UPDOWN == js.number) {
-                        percent = static_cast<float>(js.value-MIN_AXES_VALUE)/static_cast<float>(MAX_AXES_VALUE-MIN_AXES_VALUE);
-                        right = 1.0f - 2.0f * percent;
-                      }
-                      break;
-                    }
-                  case JS_EVENT_BUTTON:
-                    break;
-                  case JS_EVENT_INIT:
-                    break;
-                  default:
-                    break;
+      cluon::OD4Session od4{static_cast<uint16_t>(std::stoi(commandlineArguments["cid"]))};
+      while (od4.isRunning() && !hasError && isRunning.load()) {
+        auto now{std::chrono::steady_clock::now()};
+
+        // Sleep until the deferred change may be sent, or the heartbeat is due.
+        auto wakeUp{hasChanged ? lastSent + MIN_INTERVAL : lastSent + HEARTBEAT};
+        int32_t timeout{0};
+        if (wakeUp > now) {
+          timeout = static_cast<int32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(wakeUp - now).count()) + 1;
+        }
+
+        struct epoll_event event {};
+        int32_t numberOfEvents = ::epoll_wait(epollFd, &event, 1, timeout);
+        if ( (-1 == numberOfEvents) && (EINTR != errno) ) {
+          std::cerr << "[opendlv-device-gamepad]: epoll error: " << errno << ": " << strerror(errno) << std::endl;
+          hasError = true;
+          break;
+        }
+        now = std::chrono::steady_clock::now();
+
+        if (0 < numberOfEvents) {
+          struct js_event js; //joystick device
+          ssize_t bytesRead{0};
+          while ((bytesRead = ::read(gamepadDevice, &js, sizeof(struct js_event))) > 0) { //reading joystick device
+            float percent{0};
+            switch (js.type & ~JS_EVENT_INIT) {
+              case JS_EVENT_AXIS:
+                {
+                  if (AXIS_LEFT_UPDOWN == js.number) {
+                    leftAxis = js.value;
+                    percent = static_cast<float>(js.value - MIN_AXES_VALUE)/static_cast<float>(MAX_AXES_VALUE-MIN_AXES_VALUE);
+                    left = 1.0f - 2.0f * percent;
+                  }
+
+                  if (AXIS_RIGHT_UPDOWN == js.number) {
+                    rightAxis = js.value;
+                    percent = static_cast<float>(js.value-MIN_AXES_VALUE)/static_cast<float>(MAX_AXES_VALUE-MIN_AXES_VALUE);
+                    right = 1.0f - 2.0f * percent;
+                  }
+                  break;
                 }
-              }
-              if (errno != EAGAIN) {
-                std::cerr << "[opendlv-device-gamepad]: Error: " << errno << ": " << strerror(errno) << std::endl;
-                hasError = true;
-              }
+              case JS_EVENT_BUTTON:
+                break;
+              case JS_EVENT_INIT:
+                break;
+              default:
+                break;
             }
           }
-          });
-    
-      // Explanation of joystick js : js_event corresponds to what happens, if you press a button JS_EVENT_BUTTON or turn 
-      // the joystick JS_EVENT_AXIS.
-      // Then the values of js.number correspond to the axis or button that generated the event. There is a specific number for one axis. 
-      // It's just a way to know in which direction/axis we put the joystick.
-      // Finally js.value is a signed integer between -32767and 32767 which recover the postion of the joystick.
-      
-      // Then the next code just manages and sends data to the lawnmover via standard-messages. We have to convert these messages into hrp-json messages which are the messages understable by hedgehog
-      
-      cluon::OD4Session od4{static_cast<uint16_t>(std::stoi(commandlineArguments["cid"]))};
-      if (od4.isRunning()) {
-        od4.timeTrigger(FREQ, [&VERBOSE, &valuesMutex, &left, &right, &hasError, &od4](){
-            std::lock_guard<std::mutex> lck(valuesMutex);
+          if ( (0 == bytesRead) || (errno != EAGAIN) || (event.events & (EPOLLERR | EPOLLHUP)) ) {
+            std::cerr << "[opendlv-device-gamepad]: Error: " << errno << ": " << strerror(errno) << std::endl;
+            hasError = true;
+            break;
+          }
 
+          if ( !hasChanged && ((leftAxis != sentLeftAxis) || (rightAxis != sentRightAxis)) ) {
+            // Latency is measured from the first event that is not sent yet.
+            hasChanged = true;
+            changedAt = now;
+          }
+        }
 
-            opendlv::proxy::PedalPositionRequest pprl;
-            pprl.position(left);
-            od4.send(pprl, cluon::time::now(), 0);
+        bool const sendChange{hasChanged && (now - lastSent >= MIN_INTERVAL)};
+        bool const sendHeartbeat{now - lastSent >= HEARTBEAT};
+        if (sendChange || sendHeartbeat) {
+          cluon::data::TimeStamp sampleTime{cluon::time::now()};
 
-            opendlv::proxy::PedalPositionRequest pprr;
-            pprr.position(right);
-            od4.send(pprr, cluon::time::now(), 10);
+          opendlv::proxy::PedalPositionRequest pprl;
+          pprl.position(left);
+          od4.send(pprl, sampleTime, 0);
 
-            return !hasError;
-            });
+          opendlv::proxy::PedalPositionRequest pprr;
+          pprr.position(right);
+          od4.send(pprr, sampleTime, 10);
 
-        opendlv::proxy::PedalPositionRequest ppr;
-        ppr.position(0.0);
-        od4.send(ppr, cluon::time::now(), 0);
-        od4.send(ppr, cluon::time::now(), 10);
-      }
+          lastSent = std::chrono::steady_clock::now();
+          if (hasChanged) {
+            latency.add(std::chrono::duration_cast<std::chrono::microseconds>(lastSent - changedAt));
+            hasChanged = false;
+          }
+          sentLeftAxis = leftAxis;
+          sentRightAxis = rightAxis;
 
-      {
-        std::lock_guard<std::mutex> lck(valuesMutex);
-        hasError = true;
-        gamepadReadingThread.join();
+          if (VERBOSE && sendChange) {
+            std::clog << "[opendlv-device-gamepad]: Sent left: " << left << ", right: " << right << std::endl;
+          }
+        }
+
+        if (VERBOSE && (now - lastReport >= std::chrono::seconds(10))) {
+          latency.print();
+          lastReport = now;
+        }
       }
 
+      opendlv::proxy::PedalPositionRequest ppr;
+      ppr.position(0.0);
+      od4.send(ppr, cluon::time::now(), 0);
+      od4.send(ppr, cluon::time::now(), 10);
+
+      latency.print();
+
+      ::close(epollFd);
       ::close(gamepadDevice);
       retCode = 0;
     }
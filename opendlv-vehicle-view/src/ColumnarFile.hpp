@@ -0,0 +1,801 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018  Christian Berger
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef COLUMNARFILE_HPP
+#define COLUMNARFILE_HPP
+
+#include "cluon-complete.hpp"
+#include "RecIndex.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace recfile {
+
+/*
+ * Columnar export of the decoded messages of a recording, stored as
+ * <recording>.columns:
+ *
+ *   ColumnarFileHeader
+ *   chunk data                           8 byte aligned, see below
+ *   ColumnarTable[numberOfTables]        one per (dataType, senderStamp)
+ *   ColumnarColumn[numberOfColumns]      columns of a table are consecutive
+ *   ColumnarChunk[numberOfChunks]        chunks of a column are consecutive
+ *   names                                referenced by offset and length
+ *
+ * Every leaf field of a message, with nested messages flattened into dotted
+ * names, becomes a column; column 0 of each table holds the sample time
+ * stamps. Rows are cut into groups of ROW_GROUP_SIZE and every column of a
+ * group is stored as one chunk in the smallest of the encodings applicable to
+ * its type, so reading a signal touches only its own chunks and those of the
+ * time stamps. Minimum and maximum per chunk and column allow to skip data
+ * without decoding it.
+ */
+constexpr char COLUMNAR_MAGIC[8]{'O', 'D', 'C', 'O', 'L', 'U', 'M', 'N'};
+constexpr uint32_t COLUMNAR_VERSION{1};
+constexpr uint32_t ROW_GROUP_SIZE{65536};
+
+enum ColumnEncoding : uint8_t {
+    PLAIN        = 0,  // Little endian values of the type's width; strings as varint length and bytes.
+    DELTA_VARINT = 1,  // Integers: zigzag encoded difference to the previous value as varint.
+    XOR_VARINT   = 2,  // Floating point: bit pattern XOR the previous one as varint.
+    RUN_LENGTH   = 3,  // Varint run length followed by the PLAIN value.
+};
+
+struct ColumnarFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t numberOfTables;
+    uint64_t numberOfColumns;
+    uint64_t numberOfChunks;
+    uint64_t directoryOffset;  // Start of the table section.
+    uint64_t namesOffset;
+    uint64_t namesSize;
+};
+
+struct ColumnarTable {
+    int32_t dataType;
+    uint32_t senderStamp;
+    uint64_t numberOfRows;
+    uint32_t firstColumn;
+    uint32_t numberOfColumns;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+};
+
+struct ColumnarColumn {
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t firstChunk;
+    uint32_t numberOfChunks;
+    uint16_t type;  // cluon::MetaMessage::MetaField::MetaFieldDataTypes
+    uint16_t reserved;
+    uint32_t table;
+    double minimum;  // NaN for strings and empty columns.
+    double maximum;
+};
+
+struct ColumnarChunk {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t firstRow;
+    uint32_t numberOfRows;
+    uint8_t encoding;
+    uint8_t reserved[3];
+    double minimum;
+    double maximum;
+};
+
+static_assert(sizeof(ColumnarFileHeader) == 64, "ColumnarFileHeader must be packed.");
+static_assert(sizeof(ColumnarTable) == 32, "ColumnarTable must be packed.");
+static_assert(sizeof(ColumnarColumn) == 40, "ColumnarColumn must be packed.");
+static_assert(sizeof(ColumnarChunk) == 48, "ColumnarChunk must be packed.");
+
+inline std::string columnarFileFor(const std::string &recFile) {
+    return recFile + ".columns";
+}
+
+/*
+ * Values are passed around as 64 bit patterns: integers sign or zero
+ * extended, floats and doubles as their IEEE 754 representation.
+ */
+namespace detail {
+
+using MetaField = cluon::MetaMessage::MetaField;
+
+inline bool isString(uint16_t type) noexcept {
+    return (MetaField::STRING_T == type) || (MetaField::BYTES_T == type);
+}
+
+inline bool isReal(uint16_t type) noexcept {
+    return (MetaField::FLOAT_T == type) || (MetaField::DOUBLE_T == type);
+}
+
+inline bool isSigned(uint16_t type) noexcept {
+    return (MetaField::INT8_T == type) || (MetaField::INT16_T == type) || (MetaField::INT32_T == type) || (MetaField::INT64_T == type);
+}
+
+inline uint32_t widthOf(uint16_t type) noexcept {
+    switch (type) {
+        case MetaField::UINT16_T:
+        case MetaField::INT16_T:
+            return 2;
+        case MetaField::UINT32_T:
+        case MetaField::INT32_T:
+        case MetaField::FLOAT_T:
+            return 4;
+        case MetaField::UINT64_T:
+        case MetaField::INT64_T:
+        case MetaField::DOUBLE_T:
+            return 8;
+        default:
+            return 1;
+    }
+}
+
+inline double toDouble(uint16_t type, uint64_t bits) noexcept {
+    if (MetaField::DOUBLE_T == type) {
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+    if (MetaField::FLOAT_T == type) {
+        const uint32_t u{static_cast<uint32_t>(bits)};
+        float f;
+        std::memcpy(&f, &u, sizeof(f));
+        return static_cast<double>(f);
+    }
+    return isSigned(type) ? static_cast<double>(static_cast<int64_t>(bits)) : static_cast<double>(bits);
+}
+
+inline uint64_t toZigZag64(uint64_t v) noexcept {
+    return (v << 1) ^ (0 - (v >> 63));
+}
+
+inline uint64_t fromZigZag64(uint64_t v) noexcept {
+    return (v >> 1) ^ (0 - (v & 1));
+}
+
+inline void writeVarInt(std::vector<char> &out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+inline void writePlain(std::vector<char> &out, uint64_t bits, uint32_t width) {
+    for (uint32_t i{0}; i < width; i++) {
+        out.push_back(static_cast<char>(bits >> (8 * i)));
+    }
+}
+
+inline uint64_t readPlain(const uint8_t *p, uint32_t width, bool signExtend) noexcept {
+    uint64_t bits{0};
+    for (uint32_t i{0}; i < width; i++) {
+        bits |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    if (signExtend && (width < 8) && (0 != (bits >> (8 * width - 1)))) {
+        bits |= ~static_cast<uint64_t>(0) << (8 * width);
+    }
+    return bits;
+}
+
+}
+
+/**
+ * Maps the fields of all messages of a message specification to columns and
+ * decodes Protobuf-encoded payloads into rows, without going through
+ * cluon::GenericMessage.
+ */
+class PayloadDecoder {
+   private:
+    PayloadDecoder(const PayloadDecoder &) = delete;
+    PayloadDecoder(PayloadDecoder &&)      = delete;
+    PayloadDecoder &operator=(const PayloadDecoder &) = delete;
+    PayloadDecoder &operator=(PayloadDecoder &&) = delete;
+
+    struct Field {
+        uint16_t type{detail::MetaField::UNDEFINED_T};
+        uint32_t column{0};
+        int32_t nested{-1};  // Layout of a nested message.
+    };
+
+   public:
+    struct Column {
+        std::string name{};
+        uint16_t type{0};
+    };
+
+    struct Schema {
+        std::string name{};
+        std::vector<Column> columns{};
+        std::vector<std::vector<Field>> layouts{};  // Fields by identifier, top level message first.
+    };
+
+   public:
+    explicit PayloadDecoder(const std::vector<cluon::MetaMessage> &messages)
+        : m_schemas{} {
+        std::map<std::string, const cluon::MetaMessage*> byName;
+        for (const auto &m : messages) {
+            byName[m.messageName()] = &m;
+        }
+        for (const auto &m : messages) {
+            Schema &s = m_schemas[m.messageIdentifier()];
+            s.name = m.messageName();
+            s.columns.push_back(Column{"sampleTimeStamp", detail::MetaField::INT64_T});
+            addLayout(m, "", 0, byName, s);
+        }
+    }
+
+    /**
+     * @return Schema for the given message identifier or nullptr if unknown.
+     */
+    const Schema *schema(int32_t dataType) const noexcept {
+        auto it = m_schemas.find(dataType);
+        return (m_schemas.end() != it) ? &it->second : nullptr;
+    }
+
+    /**
+     * Decodes a payload into one row; fields missing from the payload are 0
+     * or empty. Column 0, the sample time stamp, is left to the caller.
+     *
+     * @param values Bit patterns by column, resized to the schema.
+     * @param strings Values of string columns by column, resized to the schema.
+     * @return false if the payload is malformed.
+     */
+    bool decode(const Schema &s, const char *payload, uint32_t length, std::vector<uint64_t> &values, std::vector<std::string> &strings) const {
+        values.assign(s.columns.size(), 0);
+        strings.resize(s.columns.size());
+        for (auto &str : strings) {
+            str.clear();
+        }
+        const uint8_t *p{reinterpret_cast<const uint8_t*>(payload)};
+        return decode(s, 0, p, p + length, values, strings, 0);
+    }
+
+   private:
+    static void addLayout(const cluon::MetaMessage &m, const std::string &prefix, uint32_t depth,
+                          const std::map<std::string, const cluon::MetaMessage*> &byName, Schema &s) {
+        const size_t LAYOUT{s.layouts.size()};
+        s.layouts.emplace_back();
+        for (const auto &f : m.listOfMetaFields()) {
+            Field field;
+            field.type = f.fieldDataType();
+            if (detail::MetaField::MESSAGE_T == field.type) {
+                auto it = byName.find(f.fieldDataTypeName());
+                if ( (byName.end() == it) || (depth >= MAX_DEPTH) ) {
+                    continue;
+                }
+                field.nested = static_cast<int32_t>(s.layouts.size());
+                addLayout(*it->second, prefix + f.fieldName() + ".", depth + 1, byName, s);
+            }
+            else if (detail::MetaField::UNDEFINED_T != field.type) {
+                field.column = static_cast<uint32_t>(s.columns.size());
+                s.columns.push_back(Column{prefix + f.fieldName(), field.type});
+            }
+            std::vector<Field> &fields = s.layouts[LAYOUT];
+            if (fields.size() <= f.fieldIdentifier()) {
+                fields.resize(f.fieldIdentifier() + 1);
+            }
+            fields[f.fieldIdentifier()] = field;
+        }
+    }
+
+    bool decode(const Schema &s, size_t layout, const uint8_t *p, const uint8_t *end,
+                std::vector<uint64_t> &values, std::vector<std::string> &strings, uint32_t depth) const {
+        const std::vector<Field> &fields = s.layouts[layout];
+        while (p < end) {
+            uint64_t key{0};
+            if (!detail::readVarInt(p, end, key)) {
+                return false;
+            }
+            const uint64_t ID{key >> 3};
+            const Field *f{(ID < fields.size()) ? &fields[ID] : nullptr};
+            const uint16_t TYPE{(nullptr != f) ? f->type : static_cast<uint16_t>(detail::MetaField::UNDEFINED_T)};
+            switch (key & 0x7) {
+                case 0: { // Varint.
+                    uint64_t v{0};
+                    if (!detail::readVarInt(p, end, v)) {
+                        return false;
+                    }
+                    if ( (detail::MetaField::UNDEFINED_T != TYPE) && !detail::isReal(TYPE) && !detail::isString(TYPE) &&
+                         (detail::MetaField::MESSAGE_T != TYPE) ) {
+                        values[f->column] = detail::isSigned(TYPE) ? detail::fromZigZag64(v) :
+                                            (detail::MetaField::BOOL_T == TYPE) ? static_cast<uint64_t>(0 != v) : v;
+                    }
+                    break;
+                }
+                case 1: // Eight bytes.
+                    if (8 > end - p) {
+                        return false;
+                    }
+                    if (detail::MetaField::DOUBLE_T == TYPE) {
+                        values[f->column] = detail::readPlain(p, 8, false);
+                    }
+                    p += 8;
+                    break;
+                case 5: // Four bytes.
+                    if (4 > end - p) {
+                        return false;
+                    }
+                    if (detail::MetaField::FLOAT_T == TYPE) {
+                        values[f->column] = detail::readPlain(p, 4, false);
+                    }
+                    p += 4;
+                    break;
+                case 2: { // Length delimited.
+                    uint64_t size{0};
+                    if (!detail::readVarInt(p, end, size) || (size > static_cast<uint64_t>(end - p))) {
+                        return false;
+                    }
+                    if (detail::isString(TYPE)) {
+                        strings[f->column].assign(reinterpret_cast<const char*>(p), size);
+                    }
+                    else if ( (detail::MetaField::MESSAGE_T == TYPE) && (depth < MAX_DEPTH) &&
+                              !decode(s, static_cast<size_t>(f->nested), p, p + size, values, strings, depth + 1) ) {
+                        return false;
+                    }
+                    p += size;
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return true;
+    }
+
+   private:
+    // Guards against message specifications that nest recursively.
+    static constexpr uint32_t MAX_DEPTH{8};
+
+    std::map<int32_t, Schema> m_schemas;
+};
+
+/**
+ * Writes a columnar file from rows appended per table. Only the current row
+ * group of each table is kept in memory.
+ */
+class ColumnarWriter {
+   private:
+    ColumnarWriter(const ColumnarWriter &) = delete;
+    ColumnarWriter(ColumnarWriter &&)      = delete;
+    ColumnarWriter &operator=(const ColumnarWriter &) = delete;
+    ColumnarWriter &operator=(ColumnarWriter &&) = delete;
+
+    struct ColumnBuilder {
+        std::string name{};
+        uint16_t type{0};
+        std::vector<uint64_t> values{};
+        std::vector<std::string> strings{};
+        std::vector<ColumnarChunk> chunks{};
+    };
+
+    struct TableBuilder {
+        std::string name{};
+        int32_t dataType{0};
+        uint32_t senderStamp{0};
+        uint64_t numberOfRows{0};
+        uint32_t bufferedRows{0};
+        std::vector<ColumnBuilder> columns{};
+    };
+
+   public:
+    ColumnarWriter() noexcept
+        : m_file{}
+        , m_out{}
+        , m_tables{}
+        , m_offset{0}
+        , m_plainBytes{0}
+        , m_encoded{}
+        , m_candidate{} {}
+
+    /**
+     * Starts writing to a temporary file that is moved to file by close().
+     */
+    bool open(const std::string &file) {
+        m_file = file;
+        m_out.open(m_file + ".tmp", std::ios::out|std::ios::binary|std::ios::trunc);
+        ColumnarFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        m_offset = sizeof(header);
+        return m_out.good();
+    }
+
+    /**
+     * @return Table number to be used with append().
+     */
+    uint32_t addTable(const std::string &name, int32_t dataType, uint32_t senderStamp, const std::vector<PayloadDecoder::Column> &columns) {
+        TableBuilder t;
+        t.name = name;
+        t.dataType = dataType;
+        t.senderStamp = senderStamp;
+        for (const auto &c : columns) {
+            ColumnBuilder column;
+            column.name = c.name;
+            column.type = c.type;
+            t.columns.push_back(std::move(column));
+        }
+        m_tables.push_back(std::move(t));
+        return static_cast<uint32_t>(m_tables.size() - 1);
+    }
+
+    /**
+     * Appends one row as decoded by PayloadDecoder::decode.
+     */
+    void append(uint32_t table, const std::vector<uint64_t> &values, const std::vector<std::string> &strings) {
+        TableBuilder &t = m_tables[table];
+        for (size_t i{0}; i < t.columns.size(); i++) {
+            ColumnBuilder &c = t.columns[i];
+            if (detail::isString(c.type)) {
+                c.strings.push_back(strings[i]);
+            }
+            else {
+                c.values.push_back(values[i]);
+            }
+        }
+        t.numberOfRows++;
+        if (ROW_GROUP_SIZE == ++t.bufferedRows) {
+            flush(t);
+        }
+    }
+
+    /**
+     * Writes the remaining row groups and the directory and moves the file in place.
+     */
+    bool close(std::string &error) {
+        for (auto &t : m_tables) {
+            flush(t);
+        }
+
+        std::vector<ColumnarTable> tables;
+        std::vector<ColumnarColumn> columns;
+        std::vector<ColumnarChunk> chunks;
+        std::string names;
+        auto addName = [&names](const std::string &name, uint32_t &offset, uint32_t &length) {
+            offset = static_cast<uint32_t>(names.size());
+            length = static_cast<uint32_t>(name.size());
+            names += name;
+        };
+        for (const auto &t : m_tables) {
+            ColumnarTable table;
+            std::memset(&table, 0, sizeof(table));
+            table.dataType = t.dataType;
+            table.senderStamp = t.senderStamp;
+            table.numberOfRows = t.numberOfRows;
+            table.firstColumn = static_cast<uint32_t>(columns.size());
+            table.numberOfColumns = static_cast<uint32_t>(t.columns.size());
+            addName(t.name, table.nameOffset, table.nameLength);
+            for (const auto &c : t.columns) {
+                ColumnarColumn column;
+                std::memset(&column, 0, sizeof(column));
+                addName(c.name, column.nameOffset, column.nameLength);
+                column.firstChunk = static_cast<uint32_t>(chunks.size());
+                column.numberOfChunks = static_cast<uint32_t>(c.chunks.size());
+                column.type = c.type;
+                column.table = static_cast<uint32_t>(tables.size());
+                column.minimum = column.maximum = std::numeric_limits<double>::quiet_NaN();
+                for (const auto &chunk : c.chunks) {
+                    if (!std::isnan(chunk.minimum)) {
+                        column.minimum = std::isnan(column.minimum) ? chunk.minimum : std::min(column.minimum, chunk.minimum);
+                        column.maximum = std::isnan(column.maximum) ? chunk.maximum : std::max(column.maximum, chunk.maximum);
+                    }
+                }
+                chunks.insert(chunks.end(), c.chunks.begin(), c.chunks.end());
+                columns.push_back(column);
+            }
+            tables.push_back(table);
+        }
+
+        ColumnarFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+        header.version = COLUMNAR_VERSION;
+        header.numberOfTables = tables.size();
+        header.numberOfColumns = columns.size();
+        header.numberOfChunks = chunks.size();
+        header.directoryOffset = m_offset;
+        header.namesOffset = m_offset + tables.size() * sizeof(ColumnarTable) + columns.size() * sizeof(ColumnarColumn) + chunks.size() * sizeof(ColumnarChunk);
+        header.namesSize = names.size();
+
+        m_out.write(reinterpret_cast<const char*>(tables.data()), static_cast<std::streamsize>(tables.size() * sizeof(ColumnarTable)));
+        m_out.write(reinterpret_cast<const char*>(columns.data()), static_cast<std::streamsize>(columns.size() * sizeof(ColumnarColumn)));
+        m_out.write(reinterpret_cast<const char*>(chunks.data()), static_cast<std::streamsize>(chunks.size() * sizeof(ColumnarChunk)));
+        m_out.write(names.data(), static_cast<std::streamsize>(names.size()));
+        m_out.seekp(0);
+        m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        m_out.close();
+        const std::string TMP{m_file + ".tmp"};
+        if (!m_out.good()) {
+            error = std::strerror(errno);
+            std::remove(TMP.c_str());
+            return false;
+        }
+        if (0 != std::rename(TMP.c_str(), m_file.c_str())) {
+            error = std::strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @return Bytes the chunks written so far would take in PLAIN encoding.
+     */
+    uint64_t plainBytes() const noexcept {
+        return m_plainBytes;
+    }
+
+    /**
+     * @return Bytes of chunk data written so far, including alignment.
+     */
+    uint64_t chunkBytes() const noexcept {
+        return m_offset - sizeof(ColumnarFileHeader);
+    }
+
+   private:
+    void flush(TableBuilder &t) {
+        if (0 == t.bufferedRows) {
+            return;
+        }
+        for (auto &c : t.columns) {
+            ColumnarChunk chunk;
+            std::memset(&chunk, 0, sizeof(chunk));
+            chunk.firstRow = t.numberOfRows - t.bufferedRows;
+            chunk.numberOfRows = t.bufferedRows;
+            chunk.minimum = chunk.maximum = std::numeric_limits<double>::quiet_NaN();
+            if (!detail::isString(c.type)) {
+                for (uint64_t bits : c.values) {
+                    const double v{detail::toDouble(c.type, bits)};
+                    if (!std::isnan(v)) {
+                        chunk.minimum = std::isnan(chunk.minimum) ? v : std::min(chunk.minimum, v);
+                        chunk.maximum = std::isnan(chunk.maximum) ? v : std::max(chunk.maximum, v);
+                    }
+                }
+            }
+
+            // Keep the smallest applicable encoding.
+            encode(c, PLAIN, m_encoded);
+            m_plainBytes += m_encoded.size();
+            chunk.encoding = PLAIN;
+            const uint8_t ALTERNATIVES[]{detail::isString(c.type) ? RUN_LENGTH : (detail::isReal(c.type) ? XOR_VARINT : DELTA_VARINT), RUN_LENGTH};
+            for (uint8_t encoding : ALTERNATIVES) {
+                encode(c, encoding, m_candidate);
+                if (m_candidate.size() < m_encoded.size()) {
+                    m_encoded.swap(m_candidate);
+                    chunk.encoding = encoding;
+                }
+            }
+
+            chunk.offset = m_offset;
+            chunk.size = m_encoded.size();
+            const uint64_t PADDING{(8 - (m_encoded.size() % 8)) % 8};
+            m_encoded.resize(m_encoded.size() + PADDING, 0);
+            m_out.write(m_encoded.data(), static_cast<std::streamsize>(m_encoded.size()));
+            m_offset += m_encoded.size();
+            c.chunks.push_back(chunk);
+            c.values.clear();
+            c.strings.clear();
+        }
+        t.bufferedRows = 0;
+    }
+
+    static void encode(const ColumnBuilder &c, uint8_t encoding, std::vector<char> &out) {
+        out.clear();
+        const uint32_t WIDTH{detail::widthOf(c.type)};
+        if (detail::isString(c.type)) {
+            for (size_t i{0}; i < c.strings.size();) {
+                size_t run{1};
+                while ( (RUN_LENGTH == encoding) && (i + run < c.strings.size()) && (c.strings[i + run] == c.strings[i]) ) {
+                    run++;
+                }
+                if (RUN_LENGTH == encoding) {
+                    detail::writeVarInt(out, run);
+                }
+                detail::writeVarInt(out, c.strings[i].size());
+                out.insert(out.end(), c.strings[i].begin(), c.strings[i].end());
+                i += run;
+            }
+            return;
+        }
+        uint64_t previous{0};
+        for (size_t i{0}; i < c.values.size();) {
+            const uint64_t BITS{c.values[i]};
+            size_t run{1};
+            switch (encoding) {
+                case DELTA_VARINT:
+                    detail::writeVarInt(out, detail::toZigZag64(BITS - previous));
+                    break;
+                case XOR_VARINT:
+                    detail::writeVarInt(out, BITS ^ previous);
+                    break;
+                case RUN_LENGTH:
+                    while ( (i + run < c.values.size()) && (c.values[i + run] == BITS) ) {
+                        run++;
+                    }
+                    detail::writeVarInt(out, run);
+                    detail::writePlain(out, BITS, WIDTH);
+                    break;
+                default:
+                    detail::writePlain(out, BITS, WIDTH);
+            }
+            previous = BITS;
+            i += run;
+        }
+    }
+
+   private:
+    std::string m_file;
+    std::ofstream m_out;
+    std::vector<TableBuilder> m_tables;
+    uint64_t m_offset;
+    uint64_t m_plainBytes;
+    std::vector<char> m_encoded;
+    std::vector<char> m_candidate;
+};
+
+/**
+ * Memory-mapped columnar file. Chunks are decoded on demand, so only the
+ * pages of the columns that are read are loaded.
+ */
+class ColumnarFile {
+   private:
+    ColumnarFile(const ColumnarFile &) = delete;
+    ColumnarFile(ColumnarFile &&)      = delete;
+    ColumnarFile &operator=(const ColumnarFile &) = delete;
+    ColumnarFile &operator=(ColumnarFile &&) = delete;
+
+   public:
+    ColumnarFile() noexcept : m_file{}, m_header{nullptr}, m_tables{nullptr}, m_columns{nullptr}, m_chunks{nullptr}, m_names{nullptr} {}
+
+    /**
+     * @return true if the file is a complete columnar file.
+     */
+    bool open(const std::string &file) noexcept {
+        m_header = nullptr;
+        if (!m_file.open(file) || (m_file.size() < sizeof(ColumnarFileHeader))) {
+            return false;
+        }
+        const ColumnarFileHeader *header{reinterpret_cast<const ColumnarFileHeader*>(m_file.data())};
+        const uint64_t DIRECTORY_SIZE{header->numberOfTables * sizeof(ColumnarTable) + header->numberOfColumns * sizeof(ColumnarColumn) +
+                                      header->numberOfChunks * sizeof(ColumnarChunk)};
+        if ( (0 != std::memcmp(header->magic, COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC))) ||
+             (COLUMNAR_VERSION != header->version) ||
+             (0 != header->directoryOffset % 8) ||
+             (header->directoryOffset + DIRECTORY_SIZE != header->namesOffset) ||
+             (header->namesOffset + header->namesSize != m_file.size()) ) {
+            return false;
+        }
+        const char *directory{m_file.data() + header->directoryOffset};
+        m_tables = reinterpret_cast<const ColumnarTable*>(directory);
+        m_columns = reinterpret_cast<const ColumnarColumn*>(m_tables + header->numberOfTables);
+        m_chunks = reinterpret_cast<const ColumnarChunk*>(m_columns + header->numberOfColumns);
+        m_names = m_file.data() + header->namesOffset;
+        m_header = header;
+        return true;
+    }
+
+    uint64_t numberOfTables() const noexcept {
+        return m_header->numberOfTables;
+    }
+    const ColumnarTable &table(uint64_t i) const noexcept {
+        return m_tables[i];
+    }
+    const ColumnarColumn &column(const ColumnarTable &t, uint32_t i) const noexcept {
+        return m_columns[t.firstColumn + i];
+    }
+    const ColumnarChunk &chunk(const ColumnarColumn &c, uint32_t i) const noexcept {
+        return m_chunks[c.firstChunk + i];
+    }
+    std::string name(const ColumnarTable &t) const {
+        return std::string(m_names + t.nameOffset, t.nameLength);
+    }
+    std::string name(const ColumnarColumn &c) const {
+        return std::string(m_names + c.nameOffset, c.nameLength);
+    }
+
+    /**
+     * @return Column number of the given name in t or -1.
+     */
+    int32_t findColumn(const ColumnarTable &t, const std::string &columnName) const {
+        for (uint32_t i{0}; i < t.numberOfColumns; i++) {
+            if (name(column(t, i)) == columnName) {
+                return static_cast<int32_t>(i);
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Appends the values of one chunk of c, as bit patterns or, for string
+     * columns, to strings.
+     *
+     * @return false if the chunk is malformed.
+     */
+    bool decode(const ColumnarColumn &c, const ColumnarChunk &chunk, std::vector<uint64_t> &values, std::vector<std::string> &strings) const {
+        if (chunk.offset + chunk.size > m_header->directoryOffset) {
+            return false;
+        }
+        const uint8_t *p{reinterpret_cast<const uint8_t*>(m_file.data() + chunk.offset)};
+        const uint8_t *end{p + chunk.size};
+        const uint32_t WIDTH{detail::widthOf(c.type)};
+        const bool SIGNED{detail::isSigned(c.type)};
+        uint64_t previous{0};
+        for (uint32_t n{0}; n < chunk.numberOfRows;) {
+            uint64_t run{1};
+            if ( (RUN_LENGTH == chunk.encoding) && (!detail::readVarInt(p, end, run) || (0 == run) || (run > chunk.numberOfRows - n)) ) {
+                return false;
+            }
+            if (detail::isString(c.type)) {
+                uint64_t size{0};
+                if (!detail::readVarInt(p, end, size) || (size > static_cast<uint64_t>(end - p))) {
+                    return false;
+                }
+                strings.insert(strings.end(), run, std::string(reinterpret_cast<const char*>(p), size));
+                p += size;
+            }
+            else if ( (PLAIN == chunk.encoding) || (RUN_LENGTH == chunk.encoding) ) {
+                if (WIDTH > end - p) {
+                    return false;
+                }
+                values.insert(values.end(), run, detail::readPlain(p, WIDTH, SIGNED));
+                p += WIDTH;
+            }
+            else {
+                uint64_t v{0};
+                if (!detail::readVarInt(p, end, v)) {
+                    return false;
+                }
+                previous = (DELTA_VARINT == chunk.encoding) ? previous + detail::fromZigZag64(v) : previous ^ v;
+                values.push_back(previous);
+            }
+            n += static_cast<uint32_t>(run);
+        }
+        return true;
+    }
+
+   private:
+    MappedFile m_file;
+    const ColumnarFileHeader *m_header;
+    const ColumnarTable *m_tables;
+    const ColumnarColumn *m_columns;
+    const ColumnarChunk *m_chunks;
+    const char *m_names;
+};
+
+}
+
+#endif
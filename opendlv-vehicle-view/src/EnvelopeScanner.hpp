@@ -0,0 +1,279 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018  Christian Berger
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ENVELOPESCANNER_HPP
+#define ENVELOPESCANNER_HPP
+
+#include "cluon-complete.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace recfile {
+
+/**
+ * Routing information of one envelope in a .rec file. The payload points into
+ * the scanner's buffer and is only valid until the next call to next().
+ */
+struct EnvelopeHeader {
+    uint64_t offset{0};          // File offset of the OD4 header.
+    uint32_t length{0};          // Length of the Protobuf-encoded envelope after the 5 byte OD4 header.
+    int32_t dataType{0};
+    uint32_t senderStamp{0};
+    int64_t sampleTimeStamp{0};  // Microseconds.
+    const char *payload{nullptr};
+    uint32_t payloadLength{0};
+};
+
+namespace detail {
+
+inline bool readVarInt(const uint8_t *&p, const uint8_t *end, uint64_t &value) noexcept {
+    value = 0;
+    for (uint8_t shift{0}; (p < end) && (shift < 64); shift = static_cast<uint8_t>(shift + 7)) {
+        const uint8_t b{*p++};
+        value |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (0 == (b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline int32_t fromZigZag32(uint64_t v) noexcept {
+    const uint32_t u{static_cast<uint32_t>(v)};
+    return static_cast<int32_t>((u >> 1) ^ (~(u & 1) + 1));
+}
+
+inline bool decodeTimeStamp(const uint8_t *p, const uint8_t *end, int64_t &microseconds) noexcept {
+    int64_t seconds{0};
+    int64_t fraction{0};
+    while (p < end) {
+        uint64_t key{0};
+        uint64_t value{0};
+        if (!readVarInt(p, end, key) || (0 != (key & 0x7)) || !readVarInt(p, end, value)) {
+            return false;
+        }
+        if (1 == (key >> 3)) {
+            seconds = fromZigZag32(value);
+        }
+        else if (2 == (key >> 3)) {
+            fraction = fromZigZag32(value);
+        }
+    }
+    microseconds = seconds * static_cast<int64_t>(1000 * 1000) + fraction;
+    return true;
+}
+
+}
+
+/**
+ * Decodes the fields of a Protobuf-encoded cluon.data.Envelope that are needed
+ * to route it without materializing a cluon::data::Envelope, which would copy
+ * the payload and construct a std::stringstream per field.
+ *
+ * @param data Protobuf-encoded envelope without OD4 header.
+ * @param length Number of bytes in data.
+ * @param header Destination; offset and length are left untouched.
+ * @return true if the envelope could be decoded.
+ */
+inline bool decodeEnvelopeHeader(const char *data, uint32_t length, EnvelopeHeader &header) noexcept {
+    const uint8_t *p{reinterpret_cast<const uint8_t*>(data)};
+    const uint8_t *end{p + length};
+    header.dataType = 0;
+    header.senderStamp = 0;
+    header.sampleTimeStamp = 0;
+    header.payload = nullptr;
+    header.payloadLength = 0;
+    while (p < end) {
+        uint64_t key{0};
+        if (!detail::readVarInt(p, end, key)) {
+            return false;
+        }
+        const uint64_t field{key >> 3};
+        switch (key & 0x7) {
+            case 0: { // Varint.
+                uint64_t value{0};
+                if (!detail::readVarInt(p, end, value)) {
+                    return false;
+                }
+                if (1 == field) {
+                    header.dataType = detail::fromZigZag32(value);
+                }
+                else if (6 == field) {
+                    header.senderStamp = static_cast<uint32_t>(value);
+                }
+                break;
+            }
+            case 2: { // Length delimited.
+                uint64_t size{0};
+                if (!detail::readVarInt(p, end, size) || (size > static_cast<uint64_t>(end - p))) {
+                    return false;
+                }
+                if (2 == field) {
+                    header.payload = reinterpret_cast<const char*>(p);
+                    header.payloadLength = static_cast<uint32_t>(size);
+                }
+                else if ( (5 == field) && !detail::decodeTimeStamp(p, p + size, header.sampleTimeStamp) ) {
+                    return false;
+                }
+                p += size;
+                break;
+            }
+            case 1: // Eight bytes.
+                p += 8;
+                break;
+            case 5: // Four bytes.
+                p += 4;
+                break;
+            default:
+                return false;
+        }
+    }
+    return p == end;
+}
+
+/**
+ * @param header Envelope returned from EnvelopeScanner::next.
+ * @return The envelope's payload decoded into the desired type.
+ */
+template <typename T>
+inline T extractMessage(const EnvelopeHeader &header) noexcept {
+    cluon::FromProtoVisitor decoder;
+    std::stringstream sstr(std::string(header.payload, header.payloadLength));
+    decoder.decodeFrom(sstr);
+
+    T msg;
+    msg.accept(decoder);
+    return msg;
+}
+
+/**
+ * Reads envelopes sequentially from a .rec file through a large buffer and
+ * decodes only their routing information. Corrupt bytes between envelopes
+ * are skipped until the next OD4 header.
+ */
+class EnvelopeScanner {
+   private:
+    EnvelopeScanner(const EnvelopeScanner &) = delete;
+    EnvelopeScanner(EnvelopeScanner &&)      = delete;
+    EnvelopeScanner &operator=(const EnvelopeScanner &) = delete;
+    EnvelopeScanner &operator=(EnvelopeScanner &&) = delete;
+
+   public:
+    /**
+     * @param in Stream to read from, scanning starts at its current position.
+     */
+    explicit EnvelopeScanner(std::istream &in) noexcept
+        : m_in(in)
+        , m_buffer(BUFFER_SIZE)
+        , m_begin{0}
+        , m_end{0}
+        , m_offset{0} {
+        const std::streamoff position{in.tellg()};
+        m_offset = (position > 0) ? static_cast<uint64_t>(position) : 0;
+    }
+
+    /**
+     * @param header Filled with the next envelope.
+     * @return false when no further complete envelope is available.
+     */
+    bool next(EnvelopeHeader &header) noexcept {
+        constexpr uint32_t OD4_HEADER_SIZE{5};
+        while (true) {
+            if (available() >= OD4_HEADER_SIZE) {
+                const uint8_t *p{reinterpret_cast<const uint8_t*>(&m_buffer[m_begin])};
+                if ( (0x0D != p[0]) || (0xA4 != p[1]) ) {
+                    consume(1);
+                    continue;
+                }
+                const uint32_t LENGTH{static_cast<uint32_t>(p[2]) | (static_cast<uint32_t>(p[3]) << 8) | (static_cast<uint32_t>(p[4]) << 16)};
+                if (available() >= OD4_HEADER_SIZE + LENGTH) {
+                    header.offset = m_offset;
+                    header.length = LENGTH;
+                    const bool DECODED{decodeEnvelopeHeader(&m_buffer[m_begin + OD4_HEADER_SIZE], LENGTH, header)};
+                    consume(OD4_HEADER_SIZE + LENGTH);
+                    if (DECODED) {
+                        return true;
+                    }
+                    continue;
+                }
+                if (OD4_HEADER_SIZE + LENGTH > m_buffer.size()) {
+                    m_buffer.resize(OD4_HEADER_SIZE + LENGTH);
+                }
+            }
+            if (!refill()) {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * @return File offset of the first byte that has not been consumed yet.
+     */
+    uint64_t position() const noexcept {
+        return m_offset;
+    }
+
+   private:
+    size_t available() const noexcept {
+        return m_end - m_begin;
+    }
+
+    void consume(size_t length) noexcept {
+        m_begin += length;
+        m_offset += length;
+    }
+
+    bool refill() noexcept {
+        if (0 < m_begin) {
+            std::memmove(&m_buffer[0], &m_buffer[m_begin], available());
+            m_end -= m_begin;
+            m_begin = 0;
+        }
+        if (!m_in.good() || (m_end == m_buffer.size())) {
+            return false;
+        }
+        m_in.read(&m_buffer[m_end], static_cast<std::streamsize>(m_buffer.size() - m_end));
+        const size_t READ{static_cast<size_t>(m_in.gcount())};
+        m_end += READ;
+        return 0 < READ;
+    }
+
+   private:
+    static constexpr size_t BUFFER_SIZE{1024 * 1024};
+
+    std::istream &m_in;
+    std::vector<char> m_buffer;
+    size_t m_begin;
+    size_t m_end;
+    uint64_t m_offset;
+};
+
+}
+
+#endif
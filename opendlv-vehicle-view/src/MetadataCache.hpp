@@ -0,0 +1,201 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018  Christian Berger
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef METADATACACHE_HPP
+#define METADATACACHE_HPP
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace recfile {
+
+/**
+ * 64 bit FNV-1a.
+ */
+inline uint64_t fnv1a(const char *data, size_t length, uint64_t hash = 14695981039346656037ULL) noexcept {
+    for (size_t i{0}; i < length; i++) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Persistent cache for results computed from a recording, stored as
+ * <directory>/<recording name>-<key>.json. The key covers size, modification
+ * time and sampled content of the recording as well as a salt for everything
+ * else the result depends on (message specification, options). Only the
+ * newest entry per recording name is kept.
+ */
+class MetadataCache {
+   private:
+    MetadataCache(const MetadataCache &) = delete;
+    MetadataCache(MetadataCache &&)      = delete;
+    MetadataCache &operator=(const MetadataCache &) = delete;
+    MetadataCache &operator=(MetadataCache &&) = delete;
+
+   public:
+    struct Fingerprint {
+        uint64_t size{0};
+        int64_t modificationTime{0};  // Nanoseconds.
+        uint64_t key{0};
+    };
+
+    /**
+     * @param directory Cache directory, created if missing.
+     * @param salt Hash of all further inputs to the cached result.
+     */
+    MetadataCache(const std::string &directory, uint64_t salt) noexcept
+        : m_directory{directory}
+        , m_salt{salt} {
+        ::mkdir(m_directory.c_str(), 0755);
+    }
+
+    /**
+     * Reads SAMPLES blocks spread evenly over the recording, including its
+     * first and last block, instead of hashing all of it.
+     *
+     * @return false if the recording cannot be read.
+     */
+    bool fingerprint(const std::string &recFile, Fingerprint &fp) const noexcept {
+        const int fd{::open(recFile.c_str(), O_RDONLY)};
+        if (0 > fd) {
+            return false;
+        }
+        struct stat st;
+        bool retVal{0 == ::fstat(fd, &st)};
+        if (retVal) {
+            fp.size = static_cast<uint64_t>(st.st_size);
+            fp.modificationTime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + static_cast<int64_t>(st.st_mtim.tv_nsec);
+            uint64_t hash{fnv1a(reinterpret_cast<const char*>(&m_salt), sizeof(m_salt))};
+            hash = fnv1a(reinterpret_cast<const char*>(&fp.size), sizeof(fp.size), hash);
+            hash = fnv1a(reinterpret_cast<const char*>(&fp.modificationTime), sizeof(fp.modificationTime), hash);
+            std::vector<char> block(BLOCK_SIZE);
+            const uint64_t LAST_BLOCK{(fp.size > BLOCK_SIZE) ? fp.size - BLOCK_SIZE : 0};
+            for (uint64_t i{0}; (i < SAMPLES) && retVal; i++) {
+                const off_t OFFSET{static_cast<off_t>(LAST_BLOCK * i / (SAMPLES - 1))};
+                const ssize_t READ{::pread(fd, block.data(), block.size(), OFFSET)};
+                retVal = (0 <= READ);
+                hash = fnv1a(block.data(), static_cast<size_t>(std::max<ssize_t>(READ, 0)), hash);
+            }
+            fp.key = hash;
+        }
+        ::close(fd);
+        return retVal;
+    }
+
+    /**
+     * @return true if an entry for the fingerprint exists and was copied to out.
+     */
+    bool load(const std::string &recFile, const Fingerprint &fp, std::ostream &out) const {
+        std::ifstream fin(entry(recFile, fp), std::ios::in|std::ios::binary);
+        if (!fin.good()) {
+            return false;
+        }
+        out << fin.rdbuf();
+        return true;
+    }
+
+    /**
+     * @return Temporary file for a result to be committed with store().
+     */
+    std::string temporaryEntry(const std::string &recFile, const Fingerprint &fp) const {
+        return entry(recFile, fp) + ".tmp";
+    }
+
+    /**
+     * Commits a result written to temporaryEntry(), unless the recording has
+     * changed since fp was taken or is modified too recently to be complete,
+     * and removes older entries for the same recording.
+     *
+     * @return true if the result was committed.
+     */
+    bool store(const std::string &recFile, const Fingerprint &fp) const {
+        const std::string TMP{temporaryEntry(recFile, fp)};
+        Fingerprint now;
+        const bool STABLE{fingerprint(recFile, now) && (now.key == fp.key) &&
+                          (static_cast<int64_t>(std::time(nullptr)) - now.modificationTime / 1000000000LL >= GROWING_THRESHOLD)};
+        if (!STABLE) {
+            std::remove(TMP.c_str());
+            return false;
+        }
+        removeEntries(recFile);
+        return 0 == std::rename(TMP.c_str(), entry(recFile, fp).c_str());
+    }
+
+    /**
+     * Removes all entries for the given recording name.
+     */
+    void removeEntries(const std::string &recFile) const {
+        const std::string PREFIX{name(recFile) + "-"};
+        DIR *dir{::opendir(m_directory.c_str())};
+        if (nullptr != dir) {
+            struct dirent *e{nullptr};
+            while (nullptr != (e = ::readdir(dir))) {
+                const std::string ENTRY{e->d_name};
+                if ( (0 == ENTRY.compare(0, PREFIX.size(), PREFIX)) && (ENTRY.size() == PREFIX.size() + 16 + 5) ) {
+                    std::remove((m_directory + "/" + ENTRY).c_str());
+                }
+            }
+            ::closedir(dir);
+        }
+    }
+
+   private:
+    static std::string name(const std::string &recFile) {
+        return recFile.substr(recFile.find_last_of('/') + 1);
+    }
+
+    std::string entry(const std::string &recFile, const Fingerprint &fp) const {
+        std::stringstream sstr;
+        sstr << m_directory << "/" << name(recFile) << "-" << std::hex << std::setw(16) << std::setfill('0') << fp.key << ".json";
+        return sstr.str();
+    }
+
+   private:
+    static constexpr uint64_t SAMPLES{16};
+    static constexpr uint64_t BLOCK_SIZE{4096};
+    // Seconds without modification before a recording is considered complete.
+    static constexpr int64_t GROWING_THRESHOLD{5};
+
+    const std::string m_directory;
+    const uint64_t m_salt;
+};
+
+}
+
+#endif
@@ -0,0 +1,420 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018  Christian Berger
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RECINDEX_HPP
+#define RECINDEX_HPP
+
+#include "EnvelopeScanner.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace recfile {
+
+/*
+ * Sidecar seek index for a .rec file, stored as <recording>.idx:
+ *
+ *   IndexFileHeader
+ *   IndexEntry[numberOfEntries]          all envelopes, ordered by sample time
+ *   uint32_t[numberOfEntries]            entry numbers grouped by type, each
+ *                                        group ordered by sample time
+ *   IndexTypeSummary[numberOfTypes]      one per (dataType, senderStamp)
+ *
+ * All sections are 8 byte aligned so the file can be used in place through
+ * mmap. The header records size and modification time of the recording; an
+ * index that does not match them is stale and must be rebuilt.
+ */
+constexpr char INDEX_MAGIC[8]{'O', 'D', 'R', 'E', 'C', 'I', 'D', 'X'};
+constexpr uint32_t INDEX_VERSION{1};
+
+struct IndexFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t numberOfTypes;
+    uint64_t recordingSize;
+    int64_t recordingModificationTime;  // Nanoseconds.
+    uint64_t numberOfEntries;
+    uint64_t reserved[3];
+};
+
+struct IndexEntry {
+    int64_t sampleTimeStamp;  // Microseconds.
+    uint64_t offsetAndType;   // File offset in the lower 48 bits, type number in the upper 16 bits.
+
+    uint64_t offset() const noexcept {
+        return offsetAndType & OFFSET_MASK;
+    }
+    uint16_t type() const noexcept {
+        return static_cast<uint16_t>(offsetAndType >> 48);
+    }
+
+    static constexpr uint64_t OFFSET_MASK{(static_cast<uint64_t>(1) << 48) - 1};
+};
+
+struct IndexTypeSummary {
+    int32_t dataType;
+    uint32_t senderStamp;
+    uint64_t numberOfEnvelopes;
+    uint64_t numberOfBytes;          // Including OD4 headers.
+    int64_t firstSampleTimeStamp;
+    int64_t lastSampleTimeStamp;
+    uint64_t firstPosting;           // Start of this type's group in the posting section.
+};
+
+static_assert(sizeof(IndexFileHeader) == 64, "IndexFileHeader must be packed.");
+static_assert(sizeof(IndexEntry) == 16, "IndexEntry must be packed.");
+static_assert(sizeof(IndexTypeSummary) == 48, "IndexTypeSummary must be packed.");
+
+inline std::string indexFileFor(const std::string &recFile) {
+    return recFile + ".idx";
+}
+
+inline bool statRecording(const std::string &recFile, uint64_t &size, int64_t &modificationTime) noexcept {
+    struct stat st;
+    if (0 != ::stat(recFile.c_str(), &st)) {
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    modificationTime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + static_cast<int64_t>(st.st_mtim.tv_nsec);
+    return true;
+}
+
+/**
+ * Read-only or read-write memory mapping of a whole file.
+ */
+class MappedFile {
+   private:
+    MappedFile(const MappedFile &) = delete;
+    MappedFile(MappedFile &&)      = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile &operator=(MappedFile &&) = delete;
+
+   public:
+    MappedFile() noexcept : m_data{nullptr}, m_size{0} {}
+    ~MappedFile() {
+        close();
+    }
+
+    bool open(const std::string &file, bool writable = false) noexcept {
+        close();
+        const int fd{::open(file.c_str(), writable ? O_RDWR : O_RDONLY)};
+        if (0 > fd) {
+            return false;
+        }
+        struct stat st;
+        if ( (0 == ::fstat(fd, &st)) && (0 < st.st_size) ) {
+            void *data = ::mmap(nullptr, static_cast<size_t>(st.st_size), writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+            if (MAP_FAILED != data) {
+                m_data = static_cast<char*>(data);
+                m_size = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+        return nullptr != m_data;
+    }
+
+    void close() noexcept {
+        if (nullptr != m_data) {
+            ::munmap(m_data, m_size);
+            m_data = nullptr;
+            m_size = 0;
+        }
+    }
+
+    char *data() const noexcept {
+        return m_data;
+    }
+    size_t size() const noexcept {
+        return m_size;
+    }
+
+   private:
+    char *m_data;
+    size_t m_size;
+};
+
+/**
+ * Memory-mapped sidecar index.
+ */
+class RecIndex {
+   private:
+    RecIndex(const RecIndex &) = delete;
+    RecIndex(RecIndex &&)      = delete;
+    RecIndex &operator=(const RecIndex &) = delete;
+    RecIndex &operator=(RecIndex &&) = delete;
+
+   public:
+    RecIndex() noexcept : m_file{}, m_header{nullptr}, m_entries{nullptr}, m_postings{nullptr}, m_types{nullptr} {}
+
+    /**
+     * @param recFile Recording whose sidecar index is to be opened.
+     * @return true if the index exists and matches the recording.
+     */
+    bool open(const std::string &recFile) noexcept {
+        m_header = nullptr;
+        uint64_t size{0};
+        int64_t modificationTime{0};
+        if (!statRecording(recFile, size, modificationTime) || !m_file.open(indexFileFor(recFile))) {
+            return false;
+        }
+        if (m_file.size() < sizeof(IndexFileHeader)) {
+            return false;
+        }
+        const IndexFileHeader *header{reinterpret_cast<const IndexFileHeader*>(m_file.data())};
+        if ( (0 != std::memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC))) ||
+             (INDEX_VERSION != header->version) ||
+             (size != header->recordingSize) ||
+             (modificationTime != header->recordingModificationTime) ||
+             (m_file.size() != fileSize(header->numberOfEntries, header->numberOfTypes)) ) {
+            return false;
+        }
+        m_header = header;
+        m_entries = reinterpret_cast<const IndexEntry*>(m_file.data() + sizeof(IndexFileHeader));
+        m_postings = reinterpret_cast<const uint32_t*>(m_entries + header->numberOfEntries);
+        m_types = reinterpret_cast<const IndexTypeSummary*>(m_file.data() + typesOffset(header->numberOfEntries));
+        return true;
+    }
+
+    bool isOpen() const noexcept {
+        return nullptr != m_header;
+    }
+    uint64_t numberOfEntries() const noexcept {
+        return m_header->numberOfEntries;
+    }
+    const IndexEntry &entry(uint64_t i) const noexcept {
+        return m_entries[i];
+    }
+    uint32_t numberOfTypes() const noexcept {
+        return m_header->numberOfTypes;
+    }
+    const IndexTypeSummary &type(uint32_t i) const noexcept {
+        return m_types[i];
+    }
+    /**
+     * @return Entry numbers of all envelopes of the given type, ordered by sample time.
+     */
+    const uint32_t *postings(uint32_t type) const noexcept {
+        return m_postings + m_types[type].firstPosting;
+    }
+
+    /**
+     * @param sampleTimeStamp Microseconds.
+     * @return Number of the first entry sampled at or after sampleTimeStamp.
+     */
+    uint64_t lowerBound(int64_t sampleTimeStamp) const noexcept {
+        const IndexEntry *end{m_entries + m_header->numberOfEntries};
+        return static_cast<uint64_t>(std::lower_bound(m_entries, end, sampleTimeStamp,
+            [](const IndexEntry &e, int64_t ts) { return e.sampleTimeStamp < ts; }) - m_entries);
+    }
+
+    static uint64_t typesOffset(uint64_t numberOfEntries) noexcept {
+        const uint64_t postingsEnd{sizeof(IndexFileHeader) + numberOfEntries * (sizeof(IndexEntry) + sizeof(uint32_t))};
+        return (postingsEnd + 7) & ~static_cast<uint64_t>(7);
+    }
+    static uint64_t fileSize(uint64_t numberOfEntries, uint32_t numberOfTypes) noexcept {
+        return typesOffset(numberOfEntries) + numberOfTypes * sizeof(IndexTypeSummary);
+    }
+
+   private:
+    MappedFile m_file;
+    const IndexFileHeader *m_header;
+    const IndexEntry *m_entries;
+    const uint32_t *m_postings;
+    const IndexTypeSummary *m_types;
+};
+
+/**
+ * Decodes the envelope stored at the given offset of a mapped recording.
+ *
+ * @param recording Memory-mapped .rec file.
+ * @param offset File offset of the OD4 header, as stored in IndexEntry.
+ * @param header Destination; payload points into the mapping.
+ * @return true if a valid envelope was found at offset.
+ */
+inline bool envelopeAt(const MappedFile &recording, uint64_t offset, EnvelopeHeader &header) noexcept {
+    constexpr uint64_t OD4_HEADER_SIZE{5};
+    if (offset + OD4_HEADER_SIZE > recording.size()) {
+        return false;
+    }
+    const uint8_t *p{reinterpret_cast<const uint8_t*>(recording.data() + offset)};
+    if ( (0x0D != p[0]) || (0xA4 != p[1]) ) {
+        return false;
+    }
+    const uint32_t LENGTH{static_cast<uint32_t>(p[2]) | (static_cast<uint32_t>(p[3]) << 8) | (static_cast<uint32_t>(p[4]) << 16)};
+    if (offset + OD4_HEADER_SIZE + LENGTH > recording.size()) {
+        return false;
+    }
+    header.offset = offset;
+    header.length = LENGTH;
+    return decodeEnvelopeHeader(recording.data() + offset + OD4_HEADER_SIZE, LENGTH, header);
+}
+
+/**
+ * Builds the sidecar index for a recording. Entries are streamed to a
+ * temporary file and ordered in place through mmap, so memory does not grow
+ * with the size of the recording. The index replaces an existing one
+ * atomically.
+ *
+ * @param recFile Recording to index.
+ * @param error Reason in case of failure.
+ * @return true on success.
+ */
+inline bool buildIndex(const std::string &recFile, std::string &error) {
+    uint64_t recordingSize{0};
+    int64_t modificationTime{0};
+    if (!statRecording(recFile, recordingSize, modificationTime)) {
+        error = "cannot stat '" + recFile + "': " + std::strerror(errno);
+        return false;
+    }
+    std::ifstream fin(recFile, std::ios::in|std::ios::binary);
+    if (!fin.good()) {
+        error = "cannot open '" + recFile + "'";
+        return false;
+    }
+
+    const std::string indexFile{indexFileFor(recFile)};
+    const std::string tmpFile{indexFile + ".tmp"};
+    std::vector<IndexTypeSummary> types;
+    std::map<std::pair<int32_t, uint32_t>, uint16_t> typeNumbers;
+    uint64_t numberOfEntries{0};
+    bool isOrdered{true};
+    {
+        std::ofstream fout(tmpFile, std::ios::out|std::ios::binary|std::ios::trunc);
+        if (!fout.good()) {
+            error = "cannot write '" + tmpFile + "'";
+            return false;
+        }
+        IndexFileHeader header{};
+        fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        int64_t previousSampleTimeStamp{0};
+        EnvelopeScanner scanner(fin);
+        EnvelopeHeader env;
+        while (scanner.next(env)) {
+            auto key = std::make_pair(env.dataType, env.senderStamp);
+            auto it = typeNumbers.find(key);
+            if (typeNumbers.end() == it) {
+                if (types.size() > UINT16_MAX) {
+                    error = "too many message types";
+                    return false;
+                }
+                it = typeNumbers.emplace(key, static_cast<uint16_t>(types.size())).first;
+                IndexTypeSummary summary{};
+                summary.dataType = env.dataType;
+                summary.senderStamp = env.senderStamp;
+                summary.firstSampleTimeStamp = env.sampleTimeStamp;
+                summary.lastSampleTimeStamp = env.sampleTimeStamp;
+                types.push_back(summary);
+            }
+            IndexTypeSummary &summary = types[it->second];
+            summary.numberOfEnvelopes++;
+            summary.numberOfBytes += 5 + env.length;
+            summary.firstSampleTimeStamp = std::min(summary.firstSampleTimeStamp, env.sampleTimeStamp);
+            summary.lastSampleTimeStamp = std::max(summary.lastSampleTimeStamp, env.sampleTimeStamp);
+
+            IndexEntry entry{env.sampleTimeStamp, (env.offset & IndexEntry::OFFSET_MASK) | (static_cast<uint64_t>(it->second) << 48)};
+            fout.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+
+            isOrdered = isOrdered && ((0 == numberOfEntries) || (previousSampleTimeStamp <= env.sampleTimeStamp));
+            previousSampleTimeStamp = env.sampleTimeStamp;
+            numberOfEntries++;
+        }
+        if (numberOfEntries > UINT32_MAX) {
+            error = "too many envelopes";
+            return false;
+        }
+        if (!fout.good()) {
+            error = "cannot write '" + tmpFile + "'";
+            return false;
+        }
+    }
+
+    const uint64_t size{RecIndex::fileSize(numberOfEntries, static_cast<uint32_t>(types.size()))};
+    if (0 != ::truncate(tmpFile.c_str(), static_cast<off_t>(size))) {
+        error = "cannot resize '" + tmpFile + "': " + std::strerror(errno);
+        return false;
+    }
+    {
+        MappedFile out;
+        if (!out.open(tmpFile, true)) {
+            error = "cannot map '" + tmpFile + "': " + std::strerror(errno);
+            return false;
+        }
+        IndexEntry *entries{reinterpret_cast<IndexEntry*>(out.data() + sizeof(IndexFileHeader))};
+        uint32_t *postings{reinterpret_cast<uint32_t*>(entries + numberOfEntries)};
+        if (!isOrdered) {
+            std::stable_sort(entries, entries + numberOfEntries,
+                [](const IndexEntry &a, const IndexEntry &b) { return a.sampleTimeStamp < b.sampleTimeStamp; });
+        }
+
+        uint64_t firstPosting{0};
+        for (auto &summary : types) {
+            summary.firstPosting = firstPosting;
+            firstPosting += summary.numberOfEnvelopes;
+        }
+        {
+            std::vector<uint64_t> next(types.size());
+            for (size_t i{0}; i < types.size(); i++) {
+                next[i] = types[i].firstPosting;
+            }
+            for (uint64_t i{0}; i < numberOfEntries; i++) {
+                postings[next[entries[i].type()]++] = static_cast<uint32_t>(i);
+            }
+        }
+        std::memcpy(out.data() + RecIndex::typesOffset(numberOfEntries), types.data(), types.size() * sizeof(IndexTypeSummary));
+
+        IndexFileHeader header{};
+        std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        header.version = INDEX_VERSION;
+        header.numberOfTypes = static_cast<uint32_t>(types.size());
+        header.recordingSize = recordingSize;
+        header.recordingModificationTime = modificationTime;
+        header.numberOfEntries = numberOfEntries;
+        std::memcpy(out.data(), &header, sizeof(header));
+        ::msync(out.data(), out.size(), MS_SYNC);
+    }
+
+    if (0 != std::rename(tmpFile.c_str(), indexFile.c_str())) {
+        error = "cannot rename '" + tmpFile + "': " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+}
+
+#endif
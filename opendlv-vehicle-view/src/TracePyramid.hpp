@@ -0,0 +1,232 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018  Christian Berger
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TRACEPYRAMID_HPP
+#define TRACEPYRAMID_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace wgs84 {
+
+/**
+ * Multi-resolution polyline of a GPS trace: every level is a Douglas-Peucker
+ * simplification of the trace with its own tolerance, finest first.
+ *
+ * Positions are added one by one in a planar frame (see wgs84::Projection)
+ * and simplified in windows of bounded size, so the pyramid is built in one
+ * pass with bounded memory. Each level simplifies the points kept by the
+ * previous one, so coarser levels are subsets of finer ones. Window
+ * endpoints are kept on all levels.
+ *
+ * Levels are encoded as sequences of (latitude, longitude) in units of 1e-7
+ * degrees, each stored as the zigzag varint of its difference to the
+ * previous point (to 0 for the first point).
+ */
+class TracePyramid {
+   private:
+    TracePyramid(const TracePyramid &) = delete;
+    TracePyramid(TracePyramid &&)      = delete;
+    TracePyramid &operator=(const TracePyramid &) = delete;
+    TracePyramid &operator=(TracePyramid &&) = delete;
+
+   public:
+    /**
+     * @param tolerances Maximum distance in meters between the trace and each level, ascending.
+     * @param windowSize Number of positions simplified at once.
+     */
+    explicit TracePyramid(const std::vector<double> &tolerances, size_t windowSize = 4096)
+        : m_levels(tolerances.size())
+        , m_windowSize{windowSize}
+        , m_window{}
+        , m_kept{}
+        , m_stack{}
+        , m_isFirstWindow{true} {
+        for (size_t i{0}; i < tolerances.size(); i++) {
+            m_levels[i].tolerance = tolerances[i];
+        }
+    }
+
+    /**
+     * @param x, y Position in the current planar frame in meters.
+     * @param latitude, longitude The same position in degrees.
+     */
+    void add(double x, double y, double latitude, double longitude) {
+        m_window.push_back(Point{x, y, latitude, longitude});
+        if (m_window.size() >= m_windowSize) {
+            simplifyWindow();
+            // The last position starts the next window, it is already emitted.
+            const Point LAST{m_window.back()};
+            m_window.clear();
+            m_window.push_back(LAST);
+        }
+    }
+
+    /**
+     * Simplifies the pending positions, for instance before the planar frame
+     * changes or when the trace ends. The next position starts a new window.
+     */
+    void flush() {
+        simplifyWindow();
+        m_window.clear();
+        m_isFirstWindow = true;
+    }
+
+    size_t numberOfLevels() const noexcept {
+        return m_levels.size();
+    }
+    double tolerance(size_t level) const noexcept {
+        return m_levels[level].tolerance;
+    }
+    uint64_t numberOfPoints(size_t level) const noexcept {
+        return m_levels[level].numberOfPoints;
+    }
+    /**
+     * @return Encoded points of the given level.
+     */
+    const std::string &data(size_t level) const noexcept {
+        return m_levels[level].data;
+    }
+
+   private:
+    struct Point {
+        double x;
+        double y;
+        double latitude;
+        double longitude;
+    };
+
+    struct Level {
+        double tolerance{0};
+        uint64_t numberOfPoints{0};
+        int64_t previousLatitude{0};
+        int64_t previousLongitude{0};
+        std::string data{};
+    };
+
+    void simplifyWindow() {
+        if (m_window.empty()) {
+            return;
+        }
+        m_kept.resize(m_window.size());
+        for (size_t i{0}; i < m_kept.size(); i++) {
+            m_kept[i] = i;
+        }
+        for (auto &level : m_levels) {
+            simplify(level.tolerance);
+            // The first point of a window continuing the previous one is already emitted.
+            for (size_t i{m_isFirstWindow ? 0u : 1u}; i < m_kept.size(); i++) {
+                emit(level, m_window[m_kept[i]]);
+            }
+        }
+        m_isFirstWindow = false;
+    }
+
+    // Reduces m_kept, indices into m_window, to the points that Douglas-Peucker keeps for the tolerance.
+    void simplify(double tolerance) {
+        if (m_kept.size() < 3) {
+            return;
+        }
+        std::vector<bool> keep(m_kept.size(), false);
+        keep.front() = keep.back() = true;
+        m_stack.clear();
+        m_stack.emplace_back(0, m_kept.size() - 1);
+        while (!m_stack.empty()) {
+            const auto RANGE{m_stack.back()};
+            m_stack.pop_back();
+            double maxDistance{0};
+            size_t farthest{RANGE.first};
+            for (size_t i{RANGE.first + 1}; i < RANGE.second; i++) {
+                const double d{distanceToSegment(m_window[m_kept[i]], m_window[m_kept[RANGE.first]], m_window[m_kept[RANGE.second]])};
+                if (d > maxDistance) {
+                    maxDistance = d;
+                    farthest = i;
+                }
+            }
+            if (maxDistance > tolerance) {
+                keep[farthest] = true;
+                m_stack.emplace_back(RANGE.first, farthest);
+                m_stack.emplace_back(farthest, RANGE.second);
+            }
+        }
+        size_t n{0};
+        for (size_t i{0}; i < m_kept.size(); i++) {
+            if (keep[i]) {
+                m_kept[n++] = m_kept[i];
+            }
+        }
+        m_kept.resize(n);
+    }
+
+    // Distance to the segment rather than to the line, so that a trace
+    // turning back onto itself is not collapsed.
+    static double distanceToSegment(const Point &p, const Point &a, const Point &b) noexcept {
+        const double dx{b.x - a.x};
+        const double dy{b.y - a.y};
+        const double squaredLength{dx * dx + dy * dy};
+        double t{0};
+        if (squaredLength > 0) {
+            t = ((p.x - a.x) * dx + (p.y - a.y) * dy) / squaredLength;
+            t = (t < 0) ? 0 : ((t > 1) ? 1 : t);
+        }
+        return std::hypot(p.x - (a.x + t * dx), p.y - (a.y + t * dy));
+    }
+
+    static void emit(Level &level, const Point &p) {
+        const int64_t LATITUDE{static_cast<int64_t>(std::llround(p.latitude * 1.0e7))};
+        const int64_t LONGITUDE{static_cast<int64_t>(std::llround(p.longitude * 1.0e7))};
+        appendVarInt(level.data, toZigZag(LATITUDE - level.previousLatitude));
+        appendVarInt(level.data, toZigZag(LONGITUDE - level.previousLongitude));
+        level.previousLatitude = LATITUDE;
+        level.previousLongitude = LONGITUDE;
+        level.numberOfPoints++;
+    }
+
+    static uint64_t toZigZag(int64_t v) noexcept {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    static void appendVarInt(std::string &out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<char>(v));
+    }
+
+   private:
+    std::vector<Level> m_levels;
+    const size_t m_windowSize;
+    std::vector<Point> m_window;
+    std::vector<size_t> m_kept;
+    std::vector<std::pair<size_t, size_t>> m_stack;
+    bool m_isFirstWindow;
+};
+
+}
+
+#endif
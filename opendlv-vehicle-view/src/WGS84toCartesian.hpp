@@ -27,6 +27,7 @@
 
 #include <cmath>
 #include <array>
+#include <cstddef>
 #include <limits>
 
 namespace wgs84 {
@@ -144,5 +145,195 @@ inline std::array<double, 2> fromCartesian(const std::array<double, 2> &WGS84Ref
 
     return approximateWGS84Position;
 }
+
+/**
+ * Polyconic projection around a fixed WGS84 reference, computing the same
+ * mapping as toCartesian and fromCartesian above. Terms that depend only on
+ * the reference are computed once at construction or when re-anchoring, and
+ * every trigonometric function of a position is evaluated once instead of up
+ * to four times.
+ *
+ * The batch functions take structure-of-arrays spans and have no branches in
+ * their loop bodies, so they vectorize where the compiler provides vectorized
+ * sin/cos (for instance GCC with glibc's libmvec and -ffast-math).
+ *
+ * Accuracy (see wgs84-benchmark): toCartesian matches the free function to
+ * within 1e-8 m; fromCartesian inverts toCartesian with a round trip error
+ * below 1e-7 m within 20 km and 1e-4 m within 50 km of the reference, where
+ * the free function is off by up to hundreds of meters. Distances measured
+ * in the projected plane are distorted by less than 1e-5 relative within
+ * 20 km of the reference; re-anchor when positions move further away.
+ */
+class Projection {
+   public:
+    /**
+     * @param WGS84Reference WGS84 position to be used as reference.
+     */
+    explicit Projection(const std::array<double, 2> &WGS84Reference) noexcept
+        : m_reference{WGS84Reference}
+        , m_referenceLatitude{0}
+        , m_referenceLongitude{0}
+        , m_ML0{0}
+        , m_M0{0}
+        , m_N0CosPhi0{0} {
+        reanchor(WGS84Reference);
+    }
+
+    /**
+     * Moves the reference of this projection.
+     *
+     * @param WGS84Reference New WGS84 position to be used as reference.
+     */
+    void reanchor(const std::array<double, 2> &WGS84Reference) noexcept {
+        m_reference          = WGS84Reference;
+        m_referenceLatitude  = WGS84Reference[0] * DEG_TO_RAD;
+        m_referenceLongitude = WGS84Reference[1] * DEG_TO_RAD;
+        const double sinPhi0{std::sin(m_referenceLatitude)};
+        const double cosPhi0{std::cos(m_referenceLatitude)};
+        m_ML0       = mlfn(m_referenceLatitude, sinPhi0, cosPhi0);
+        m_M0        = meridionalRadius(sinPhi0);
+        m_N0CosPhi0 = normalRadius(sinPhi0) * cosPhi0;
+    }
+
+    const std::array<double, 2> &reference() const noexcept {
+        return m_reference;
+    }
+
+    /**
+     * @param WGS84Position WGS84 position to be transformed.
+     * @return std::array<double, 2> Cartesian position relative to the reference.
+     */
+    std::array<double, 2> toCartesian(const std::array<double, 2> &WGS84Position) const noexcept {
+        std::array<double, 2> retVal{{0.0, 0.0}};
+        toCartesian(&WGS84Position[0], &WGS84Position[1], 1, &retVal[0], &retVal[1]);
+        return retVal;
+    }
+
+    /**
+     * @param latitudes, longitudes n WGS84 positions in degrees.
+     * @param x, y Destination for n Cartesian positions relative to the reference.
+     */
+    void toCartesian(const double *latitudes, const double *longitudes, std::size_t n, double *x, double *y) const noexcept {
+        // Local copies, the compiler cannot prove that x and y do not alias the members.
+        const double REFERENCE_LONGITUDE{m_referenceLongitude};
+        const double ML0{m_ML0};
+        for (std::size_t i{0}; i < n; i++) {
+            double lat{latitudes[i] * DEG_TO_RAD};
+            const double absoluteLon{longitudes[i] * DEG_TO_RAD};
+            const double D{std::abs(lat) - HALF_PI};
+            const bool VALID{!(D > EPSILON12) && !(std::abs(absoluteLon) > 10.0)};
+            lat = (std::abs(D) < EPSILON12) ? std::copysign(HALF_PI, lat) : lat;
+
+            const double lon{absoluteLon - REFERENCE_LONGITUDE};
+            // cos(lat) >= 0 and 1 - cos(E) = 2 sin^2(E/2): no sin/cos pair of the
+            // same argument, which GCC would fuse into a sincos call that has no
+            // vector variant. The half angle form also avoids cancellation for
+            // the small E of nearby positions.
+            const double sinPhi{std::sin(lat)};
+            const double cosPhi{std::sqrt(1.0 - sinPhi * sinPhi)};
+            const bool ON_EQUATOR{std::abs(lat) < EPSILON10};
+            const bool HAS_MS{std::abs(sinPhi) > EPSILON10};
+            const double ms{HAS_MS ? (cosPhi / std::sqrt(1.0 - SQUARED_ECCENTRICITY * sinPhi * sinPhi)) / sinPhi : 0.0};
+            const double E{lon * sinPhi};
+            const double sinHalfE{std::sin(0.5 * E)};
+            const double px{ON_EQUATOR ? lon : ms * std::sin(E)};
+            const double py{ON_EQUATOR ? -ML0 : (mlfn(lat, sinPhi, cosPhi) - ML0) + ms * 2.0 * sinHalfE * sinHalfE};
+            x[i] = VALID ? EQUATOR_RADIUS * px : 0.0;
+            y[i] = VALID ? EQUATOR_RADIUS * py : 0.0;
+        }
+    }
+
+    /**
+     * @param CartesianPosition Cartesian position relative to the reference.
+     * @return std::array<double, 2> WGS84 position in degrees.
+     */
+    std::array<double, 2> fromCartesian(const std::array<double, 2> &CartesianPosition) const noexcept {
+        std::array<double, 2> retVal{{0.0, 0.0}};
+        fromCartesian(&CartesianPosition[0], &CartesianPosition[1], 1, &retVal[0], &retVal[1]);
+        return retVal;
+    }
+
+    /**
+     * Inverts toCartesian by fixed point iteration, scaling the residual by
+     * the local meridional and normal radii of curvature.
+     *
+     * @param x, y n Cartesian positions relative to the reference.
+     * @param latitudes, longitudes Destination for n WGS84 positions in degrees.
+     */
+    void fromCartesian(const double *x, const double *y, std::size_t n, double *latitudes, double *longitudes) const noexcept {
+        constexpr int32_t ITERATIONS{4};
+        for (std::size_t i{0}; i < n; i++) {
+            double lat{m_referenceLatitude + y[i] / m_M0};
+            double lon{m_referenceLongitude + x[i] / m_N0CosPhi0};
+            for (int32_t k{0}; k < ITERATIONS; k++) {
+                double fx{0.0};
+                double fy{0.0};
+                const double latDeg{lat / DEG_TO_RAD};
+                const double lonDeg{lon / DEG_TO_RAD};
+                toCartesian(&latDeg, &lonDeg, 1, &fx, &fy);
+                const double sinPhi{std::sin(lat)};
+                lat += (y[i] - fy) / meridionalRadius(sinPhi);
+                lon += (x[i] - fx) / (normalRadius(sinPhi) * std::cos(lat));
+            }
+            latitudes[i]  = lat / DEG_TO_RAD;
+            longitudes[i] = lon / DEG_TO_RAD;
+        }
+    }
+
+   private:
+    static constexpr double PI{3.141592653589793};
+    static constexpr double DEG_TO_RAD{PI / 180.0};
+    static constexpr double HALF_PI{PI / 2.0};
+    static constexpr double EPSILON10{1.0e-10};
+    static constexpr double EPSILON12{1.0e-12};
+
+    static constexpr double EQUATOR_RADIUS{6378137.0};
+    static constexpr double FLATTENING{1.0 / 298.257223563};
+    static constexpr double SQUARED_ECCENTRICITY{2.0 * FLATTENING - FLATTENING * FLATTENING};
+
+    static double mlfn(double lat, double sinPhi, double cosPhi) noexcept {
+        constexpr double C00{1.0};
+        constexpr double C02{0.25};
+        constexpr double C04{0.046875};
+        constexpr double C06{0.01953125};
+        constexpr double C08{0.01068115234375};
+        constexpr double C22{0.75};
+        constexpr double C44{0.46875};
+        constexpr double C46{0.01302083333333333333};
+        constexpr double C48{0.00712076822916666666};
+        constexpr double C66{0.36458333333333333333};
+        constexpr double C68{0.00569661458333333333};
+        constexpr double C88{0.3076171875};
+
+        constexpr double R0{C00 - SQUARED_ECCENTRICITY * (C02 + SQUARED_ECCENTRICITY * (C04 + SQUARED_ECCENTRICITY * (C06 + SQUARED_ECCENTRICITY * C08)))};
+        constexpr double R1{SQUARED_ECCENTRICITY * (C22 - SQUARED_ECCENTRICITY * (C04 + SQUARED_ECCENTRICITY * (C06 + SQUARED_ECCENTRICITY * C08)))};
+        constexpr double R2T{SQUARED_ECCENTRICITY * SQUARED_ECCENTRICITY};
+        constexpr double R2{R2T * (C44 - SQUARED_ECCENTRICITY * (C46 + SQUARED_ECCENTRICITY * C48))};
+        constexpr double R3T{R2T * SQUARED_ECCENTRICITY};
+        constexpr double R3{R3T * (C66 - SQUARED_ECCENTRICITY * C68)};
+        constexpr double R4{R3T * SQUARED_ECCENTRICITY * C88};
+
+        const double cosPhiSinPhi{cosPhi * sinPhi};
+        const double squaredSinPhi{sinPhi * sinPhi};
+        return (R0 * lat - cosPhiSinPhi * (R1 + squaredSinPhi * (R2 + squaredSinPhi * (R3 + squaredSinPhi * R4))));
+    }
+
+    // Radii of curvature in meters.
+    static double meridionalRadius(double sinPhi) noexcept {
+        const double w{1.0 - SQUARED_ECCENTRICITY * sinPhi * sinPhi};
+        return EQUATOR_RADIUS * (1.0 - SQUARED_ECCENTRICITY) / (w * std::sqrt(w));
+    }
+    static double normalRadius(double sinPhi) noexcept {
+        return EQUATOR_RADIUS / std::sqrt(1.0 - SQUARED_ECCENTRICITY * sinPhi * sinPhi);
+    }
+
+   private:
+    std::array<double, 2> m_reference;
+    double m_referenceLatitude;
+    double m_referenceLongitude;
+    double m_ML0;
+    double m_M0;
+    double m_N0CosPhi0;
+};
 }
 #endif
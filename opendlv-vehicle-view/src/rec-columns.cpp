@@ -0,0 +1,280 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018  Christian Berger
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Include the single-file, header-only cluon library.
+#include "cluon-complete.hpp"
+#include "ColumnarFile.hpp"
+#include "EnvelopeScanner.hpp"
+
+#include <glob.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> findColumnarFiles(const std::string &pattern) {
+    struct stat st;
+    const bool IS_DIRECTORY{(0 == ::stat(pattern.c_str(), &st)) && S_ISDIR(st.st_mode)};
+    const std::string GLOB{IS_DIRECTORY ? pattern + "/*.columns" : pattern};
+
+    std::vector<std::string> files;
+    glob_t matches;
+    if (0 == ::glob(GLOB.c_str(), 0, nullptr, &matches)) {
+        for (size_t i{0}; i < matches.gl_pathc; i++) {
+            files.emplace_back(matches.gl_pathv[i]);
+        }
+    }
+    ::globfree(&matches);
+    return files;
+}
+
+void printValue(std::ostream &out, uint16_t type, uint64_t bits) {
+    using MetaField = cluon::MetaMessage::MetaField;
+    if (MetaField::DOUBLE_T == type) {
+        out << std::setprecision(std::numeric_limits<double>::max_digits10) << recfile::detail::toDouble(type, bits);
+    }
+    else if (MetaField::FLOAT_T == type) {
+        out << std::setprecision(std::numeric_limits<float>::max_digits10) << recfile::detail::toDouble(type, bits);
+    }
+    else if (recfile::detail::isSigned(type)) {
+        out << static_cast<int64_t>(bits);
+    }
+    else {
+        out << bits;
+    }
+}
+
+void printStatistic(std::ostream &out, double v) {
+    if (std::isnan(v)) {
+        out << "null";
+    }
+    else {
+        out << std::setprecision(std::numeric_limits<double>::max_digits10) << v;
+    }
+}
+
+bool exportRecording(const std::string &recFile, const std::string &columnarFile, const recfile::PayloadDecoder &decoder,
+                     uint64_t &numberOfEnvelopes, uint64_t &numberOfBytes, std::string &error) {
+    std::ifstream fin(recFile, std::ios::in|std::ios::binary);
+    if (!fin.good()) {
+        error = "not found";
+        return false;
+    }
+    recfile::ColumnarWriter writer;
+    if (!writer.open(columnarFile)) {
+        error = "could not write '" + columnarFile + "'";
+        return false;
+    }
+
+    std::map<std::pair<int32_t, uint32_t>, uint32_t> tables;
+    std::vector<uint64_t> values;
+    std::vector<std::string> strings;
+    recfile::EnvelopeScanner scanner(fin);
+    recfile::EnvelopeHeader header;
+    while (scanner.next(header)) {
+        numberOfEnvelopes++;
+        numberOfBytes += 5 + header.length;
+        const recfile::PayloadDecoder::Schema *schema{decoder.schema(header.dataType)};
+        if ( (nullptr == schema) || !decoder.decode(*schema, header.payload, header.payloadLength, values, strings) ) {
+            continue;
+        }
+        values[0] = static_cast<uint64_t>(header.sampleTimeStamp);
+        const std::pair<int32_t, uint32_t> KEY{header.dataType, header.senderStamp};
+        auto it = tables.find(KEY);
+        if (tables.end() == it) {
+            it = tables.emplace(KEY, writer.addTable(schema->name, header.dataType, header.senderStamp, schema->columns)).first;
+        }
+        writer.append(it->second, values, strings);
+    }
+    if (!writer.close(error)) {
+        return false;
+    }
+    std::clog << "Wrote " << tables.size() << " tables with " << writer.chunkBytes() << " bytes of column data (" << writer.plainBytes()
+              << " bytes uncompressed)." << std::endl;
+    return true;
+}
+
+void printDirectory(std::ostream &out, const std::string &file, const recfile::ColumnarFile &columns) {
+    out << "{ \"file\":\"" << file << "\", \"tables\": [" << '\n';
+    for (uint64_t i{0}; i < columns.numberOfTables(); i++) {
+        const recfile::ColumnarTable &t = columns.table(i);
+        out << ((i > 0) ? "," : "") << "{ \"messageID\":" << t.dataType << ", \"messageName\":\"" << columns.name(t)
+            << "\", \"senderStamp\":" << t.senderStamp << ", \"numberOfRows\":" << t.numberOfRows << ", \"columns\": [" << '\n';
+        for (uint32_t j{0}; j < t.numberOfColumns; j++) {
+            const recfile::ColumnarColumn &c = columns.column(t, j);
+            uint64_t size{0};
+            for (uint32_t k{0}; k < c.numberOfChunks; k++) {
+                size += columns.chunk(c, k).size;
+            }
+            out << "  " << ((j > 0) ? "," : " ") << "{ \"name\":\"" << columns.name(c) << "\", \"type\":" << c.type << ", \"size\":" << size << ", \"min\":";
+            printStatistic(out, c.minimum);
+            out << ", \"max\":";
+            printStatistic(out, c.maximum);
+            out << " }" << '\n';
+        }
+        out << "] }" << '\n';
+    }
+    out << "] }" << std::endl;
+}
+
+}
+
+int32_t main(int32_t argc, char **argv) {
+    int32_t retCode{0};
+    auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+    const bool EXPORT{(0 != commandlineArguments.count("rec")) && (0 != commandlineArguments.count("odvd"))};
+    if (!EXPORT && (0 == commandlineArguments.count("columns"))) {
+        std::cerr << argv[0] << " exports the decoded messages of a given .rec file into a columnar file (<recording>.columns) using a provided .odvd message specification and reads single columns from such files." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " --rec=<Recording from an OD4Session> --odvd=<ODVD Message Specification> [--out=<Columnar file>]" << std::endl;
+        std::cerr << "         " << argv[0] << " --columns=<Columnar file, directory or glob pattern> [--message=<ID or name> [--sender-stamp=<n>] --column=<name> [--from=<µs>] [--to=<µs>]]" << std::endl;
+        std::cerr << "         --column: print sample time, sender stamp and value of the given field, nested fields as in 'a.b', of all matching messages;" << std::endl;
+        std::cerr << "                   only the chunks of this column and of the sample time stamps are read" << std::endl;
+        std::cerr << "         Without --column, tables and columns with their sizes and value ranges are printed." << std::endl;
+        std::cerr << "Example: " << argv[0] << " --rec=myRecording.rec --odvd=myMessage" << std::endl;
+        std::cerr << "         " << argv[0] << " --columns='recordings/*.columns' --message=opendlv.proxy.GroundSpeedReading --column=groundSpeed" << std::endl;
+        retCode = 1;
+    } else if (EXPORT) {
+        std::vector<cluon::MetaMessage> messages;
+        {
+            std::ifstream fin(commandlineArguments["odvd"], std::ios::in|std::ios::binary);
+            if (!fin.good()) {
+                std::cerr << argv[0] << ": Message specification '" << commandlineArguments["odvd"] << "' not found." << std::endl;
+                return 1;
+            }
+            std::string input(static_cast<std::stringstream const&>(std::stringstream() << fin.rdbuf()).str()); // NOLINT
+            cluon::MessageParser mp;
+            messages = mp.parse(input).first;
+            std::clog << "Found " << messages.size() << " messages." << std::endl;
+        }
+        const recfile::PayloadDecoder decoder(messages);
+
+        const std::string REC{commandlineArguments["rec"]};
+        const std::string OUT{(0 != commandlineArguments.count("out")) ? commandlineArguments["out"] : recfile::columnarFileFor(REC)};
+        const auto startOfExport{std::chrono::steady_clock::now()};
+        uint64_t numberOfEnvelopes{0};
+        uint64_t numberOfBytes{0};
+        std::string error;
+        if (!exportRecording(REC, OUT, decoder, numberOfEnvelopes, numberOfBytes, error)) {
+            std::cerr << argv[0] << ": Could not export '" << REC << "': " << error << std::endl;
+            return 1;
+        }
+        const double seconds{std::chrono::duration<double>(std::chrono::steady_clock::now() - startOfExport).count()};
+        std::clog << argv[0] << ": Exported " << numberOfEnvelopes << " envelopes (" << numberOfBytes << " bytes) to '" << OUT << "' in " << seconds << " s." << std::endl;
+    } else {
+        const std::vector<std::string> FILES{findColumnarFiles(commandlineArguments["columns"])};
+        const std::string MESSAGE{commandlineArguments["message"]};
+        const std::string COLUMN{commandlineArguments["column"]};
+        const bool HAS_SENDER_STAMP{0 != commandlineArguments.count("sender-stamp")};
+        const uint32_t SENDER_STAMP{HAS_SENDER_STAMP ? static_cast<uint32_t>(std::stoul(commandlineArguments["sender-stamp"])) : 0};
+        const int64_t FROM{(0 != commandlineArguments.count("from")) ? std::stoll(commandlineArguments["from"]) : std::numeric_limits<int64_t>::min()};
+        const int64_t TO{(0 != commandlineArguments.count("to")) ? std::stoll(commandlineArguments["to"]) : std::numeric_limits<int64_t>::max()};
+
+        uint64_t bytesRead{0};
+        uint64_t bytesTotal{0};
+        if (!COLUMN.empty()) {
+            std::cout << "sampleTimeStamp;senderStamp;" << COLUMN << '\n';
+        }
+        std::vector<uint64_t> timeStamps;
+        std::vector<uint64_t> values;
+        std::vector<std::string> strings;
+        for (const auto &file : FILES) {
+            recfile::ColumnarFile columns;
+            if (!columns.open(file)) {
+                std::cerr << argv[0] << ": '" << file << "' is not a complete columnar file." << std::endl;
+                retCode = 1;
+                continue;
+            }
+            if (COLUMN.empty()) {
+                printDirectory(std::cout, file, columns);
+                continue;
+            }
+            for (uint64_t i{0}; i < columns.numberOfTables(); i++) {
+                const recfile::ColumnarTable &t = columns.table(i);
+                for (uint32_t j{0}; j < t.numberOfColumns; j++) {
+                    const recfile::ColumnarColumn &c = columns.column(t, j);
+                    for (uint32_t k{0}; k < c.numberOfChunks; k++) {
+                        bytesTotal += columns.chunk(c, k).size;
+                    }
+                }
+                if ( (!MESSAGE.empty() && (MESSAGE != std::to_string(t.dataType)) && (MESSAGE != columns.name(t))) ||
+                     (HAS_SENDER_STAMP && (SENDER_STAMP != t.senderStamp)) ) {
+                    continue;
+                }
+                const int32_t COLUMN_NUMBER{columns.findColumn(t, COLUMN)};
+                if (0 > COLUMN_NUMBER) {
+                    continue;
+                }
+                const recfile::ColumnarColumn &time = columns.column(t, 0);
+                const recfile::ColumnarColumn &c = columns.column(t, static_cast<uint32_t>(COLUMN_NUMBER));
+                for (uint32_t k{0}; k < c.numberOfChunks; k++) {
+                    // Row groups are aligned over all columns of a table.
+                    const recfile::ColumnarChunk &timeChunk = columns.chunk(time, k);
+                    const recfile::ColumnarChunk &chunk = columns.chunk(c, k);
+                    if ( (timeChunk.maximum < static_cast<double>(FROM)) || (timeChunk.minimum >= static_cast<double>(TO)) ) {
+                        continue;
+                    }
+                    timeStamps.clear();
+                    values.clear();
+                    strings.clear();
+                    if (!columns.decode(time, timeChunk, timeStamps, strings) || !columns.decode(c, chunk, values, strings)) {
+                        std::cerr << argv[0] << ": '" << file << "' is corrupt." << std::endl;
+                        retCode = 1;
+                        break;
+                    }
+                    bytesRead += timeChunk.size + ((0 == COLUMN_NUMBER) ? 0 : chunk.size);
+                    for (size_t n{0}; n < timeStamps.size(); n++) {
+                        const int64_t TIMESTAMP{static_cast<int64_t>(timeStamps[n])};
+                        if ( (TIMESTAMP < FROM) || (TIMESTAMP >= TO) ) {
+                            continue;
+                        }
+                        std::cout << TIMESTAMP << ';' << t.senderStamp << ';';
+                        if (recfile::detail::isString(c.type)) {
+                            std::cout << strings[n];
+                        }
+                        else {
+                            printValue(std::cout, c.type, values[n]);
+                        }
+                        std::cout << '\n';
+                    }
+                }
+            }
+        }
+        std::cout << std::flush;
+        if (!COLUMN.empty()) {
+            std::clog << argv[0] << ": Read " << bytesRead << " of " << bytesTotal << " bytes of column data from " << FILES.size() << " files." << std::endl;
+        }
+    }
+    return retCode;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2018 - Christian Berger <christian.berger@gu.se>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+// Include the single-file, header-only cluon library.
+#include "cluon-complete.hpp"
+#include "RecIndex.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+int32_t main(int32_t argc, char **argv) {
+    int32_t retCode{0};
+    auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+    if (0 == commandlineArguments.count("rec")) {
+        std::cerr << argv[0] << " maintains a sidecar seek index (<recording>.idx) for a given .rec file and uses it to seek and extract by sample time." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " --rec=<Recording from an OD4Session> [--force] [--seek=<µs>] [--from=<µs> --to=<µs> --out=<Extracted .rec file>]" << std::endl;
+        std::cerr << "         --force: rebuild the index even if it is up-to-date" << std::endl;
+        std::cerr << "         --seek:  print entry number and file offset of the first envelope sampled at or after the given time" << std::endl;
+        std::cerr << "         --from, --to, --out: copy all envelopes sampled in [from, to) in order of sample time to a new recording" << std::endl;
+        std::cerr << "         Times are microseconds since epoch; without --seek and --out, a summary of the recording is printed." << std::endl;
+        std::cerr << "Example: " << argv[0] << " --rec=myRecording.rec --from=1538400000000000 --to=1538400060000000 --out=firstMinute.rec" << std::endl;
+        retCode = 1;
+    } else {
+        const std::string REC{commandlineArguments["rec"]};
+        const bool FORCE{0 != commandlineArguments.count("force")};
+
+        recfile::RecIndex index;
+        if (FORCE || !index.open(REC)) {
+            const auto startOfIndexing{std::chrono::steady_clock::now()};
+            std::string error;
+            if (!recfile::buildIndex(REC, error)) {
+                std::cerr << argv[0] << ": Could not index '" << REC << "': " << error << std::endl;
+                return 1;
+            }
+            if (!index.open(REC)) {
+                std::cerr << argv[0] << ": Recording '" << REC << "' changed while it was indexed." << std::endl;
+                return 1;
+            }
+            const double seconds{std::chrono::duration<double>(std::chrono::steady_clock::now() - startOfIndexing).count()};
+            std::clog << argv[0] << ": Indexed " << index.numberOfEntries() << " envelopes of " << index.numberOfTypes() << " types in " << seconds << " s." << std::endl;
+        }
+
+        if (0 != commandlineArguments.count("seek")) {
+            const int64_t SEEK{std::stoll(commandlineArguments["seek"])};
+            const uint64_t i{index.lowerBound(SEEK)};
+            if (i < index.numberOfEntries()) {
+                std::cout << "{ \"entry\":" << i << ", \"offset\":" << index.entry(i).offset() << ", \"sampleTimeStamp\":" << index.entry(i).sampleTimeStamp << " }" << std::endl;
+            }
+            else {
+                std::cout << "{ \"entry\":" << i << " }" << std::endl;
+            }
+        }
+        else if ( (0 != commandlineArguments.count("from")) && (0 != commandlineArguments.count("to")) && (0 != commandlineArguments.count("out")) ) {
+            const int64_t FROM{std::stoll(commandlineArguments["from"])};
+            const int64_t TO{std::stoll(commandlineArguments["to"])};
+            recfile::MappedFile recording;
+            std::ofstream fout(commandlineArguments["out"], std::ios::out|std::ios::binary|std::ios::trunc);
+            if ( (0 < index.numberOfEntries()) && !recording.open(REC) ) {
+                std::cerr << argv[0] << ": Could not map '" << REC << "'." << std::endl;
+                retCode = 1;
+            }
+            else if (!fout.good()) {
+                std::cerr << argv[0] << ": Could not write '" << commandlineArguments["out"] << "'." << std::endl;
+                retCode = 1;
+            }
+            else {
+                // Envelopes are copied verbatim; only their OD4 headers are read.
+                uint64_t numberOfEnvelopes{0};
+                for (uint64_t i{index.lowerBound(FROM)}; (i < index.numberOfEntries()) && (index.entry(i).sampleTimeStamp < TO); i++) {
+                    const uint64_t OFFSET{index.entry(i).offset()};
+                    const uint8_t *p{reinterpret_cast<const uint8_t*>(recording.data() + OFFSET)};
+                    const uint32_t LENGTH{static_cast<uint32_t>(p[2]) | (static_cast<uint32_t>(p[3]) << 8) | (static_cast<uint32_t>(p[4]) << 16)};
+                    fout.write(recording.data() + OFFSET, static_cast<std::streamsize>(5 + LENGTH));
+                    numberOfEnvelopes++;
+                }
+                std::clog << argv[0] << ": Extracted " << numberOfEnvelopes << " envelopes to '" << commandlineArguments["out"] << "'." << std::endl;
+            }
+        }
+        else {
+            std::cout << "{ \"numberOfEnvelopes\":" << index.numberOfEntries() << ", \"types\": [" << '\n';
+            for (uint32_t i{0}; i < index.numberOfTypes(); i++) {
+                const recfile::IndexTypeSummary &type = index.type(i);
+                std::cout << ((i > 0) ? "," : "") << "{ \"messageID\":" << type.dataType << ", \"senderStamp\":" << type.senderStamp
+                          << ", \"numberOfEnvelopes\":" << type.numberOfEnvelopes << ", \"numberOfBytes\":" << type.numberOfBytes
+                          << ", \"firstSampleTimeStamp\":" << type.firstSampleTimeStamp << ", \"lastSampleTimeStamp\":" << type.lastSampleTimeStamp << " }" << '\n';
+            }
+            std::cout << "] }" << std::endl;
+        }
+    }
+    return retCode;
+}
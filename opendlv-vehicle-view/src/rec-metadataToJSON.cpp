@@ -22,30 +22,779 @@
 
 // Include the single-file, header-only cluon library.
 #include "cluon-complete.hpp"
+#include "EnvelopeScanner.hpp"
+#include "MetadataCache.hpp"
+#include "RecIndex.hpp"
+#include "TracePyramid.hpp"
 #include "WGS84toCartesian.hpp"
 #include "opendlv-standard-message-set.hpp"
 
+#include <glob.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
 #include <ctime>
 #include <cmath>
 #include <iomanip>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Default maximum distance in time between a comment and the GPS readings
+// its position is derived from.
+constexpr int64_t DEFAULT_COMMENT_GPS_TOLERANCE{250 * 1000};
+
+// Version of the produced JSON, bump whenever it changes so that cached
+// results are recomputed.
+constexpr uint32_t OUTPUT_VERSION{2};
+
+// GPS readings are projected to Cartesian coordinates in batches of this size.
+constexpr size_t GPS_BATCH_SIZE{1024};
+
+// The projection is re-anchored once the trace is this far (m) from its reference.
+constexpr double REANCHOR_DISTANCE{10000.0};
+
+// Levels of the GPS trace, maximum deviation in meters from the full trace.
+const std::vector<double> GPS_TRACE_TOLERANCES{0.5, 2.0, 8.0, 32.0, 128.0};
+
+using MessageScope = std::map<int32_t, cluon::MetaMessage>;
+
+std::string messageName(const MessageScope &scope, int32_t messageID) {
+    auto it = scope.find(messageID);
+    return (scope.end() != it) ? it->second.messageName() : "unknown message";
+}
+
+std::string toDateTime(int64_t microseconds) {
+    char dateTimeBuffer[26];
+    time_t sampleTime = static_cast<time_t>(microseconds / (1000 * 1000));
+    ::ctime_r(&sampleTime, dateTimeBuffer);
+    std::string strSampleTime(dateTimeBuffer);
+    strSampleTime = strSampleTime.substr(0, strSampleTime.size()-1);
+    return stringtoolbox::trim(strSampleTime);
+}
+
+std::string toJSON(std::array<double, 2> const &position) {
+    std::stringstream tmp;
+    tmp << "{" << "\"latitude\":" << std::setprecision(10) << position[0] << ",\"longitude\":" << std::setprecision(10) << position[1] << "}";
+    return tmp.str();
+}
+
+// One JSON array that is filled while streaming through the recording. The
+// entries are spilled to an anonymous temporary file in chunks so that memory
+// stays bounded; the array is copied to the output once the recording is done.
+class JSONArray {
+   private:
+    JSONArray(const JSONArray &) = delete;
+    JSONArray(JSONArray &&)      = delete;
+    JSONArray &operator=(const JSONArray &) = delete;
+    JSONArray &operator=(JSONArray &&) = delete;
+
+   public:
+    JSONArray() : m_file{std::tmpfile()}, m_buffer{}, m_size{0} {}
+    ~JSONArray() {
+        if (nullptr != m_file) {
+            std::fclose(m_file);
+        }
+    }
+
+    void add(std::string const &entry) {
+        m_buffer.append((m_size > 0) ? "," : "").append(entry).append("\n");
+        m_size++;
+        if (m_buffer.size() > CHUNK_SIZE) {
+            flush();
+        }
+    }
+
+    uint64_t size() const noexcept {
+        return m_size;
+    }
+
+    void copyTo(std::ostream &out) {
+        flush();
+        if (nullptr != m_file) {
+            std::rewind(m_file);
+            char buffer[CHUNK_SIZE];
+            size_t length{0};
+            while (0 < (length = std::fread(buffer, 1, sizeof(buffer), m_file))) {
+                out.write(buffer, static_cast<std::streamsize>(length));
+            }
+        }
+    }
+
+   private:
+    void flush() {
+        if ( (nullptr != m_file) && !m_buffer.empty() ) {
+            std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+        }
+        m_buffer.clear();
+    }
+
+   private:
+    static constexpr size_t CHUNK_SIZE{64 * 1024};
+    std::FILE *m_file;
+    std::string m_buffer;
+    uint64_t m_size;
+};
+
+// Meta information about one recording. Envelopes are either counted one by
+// one while streaming through the file or in bulk from a sidecar index; only
+// GPS readings and comments need their payloads decoded, which must be
+// passed in order of sample time.
+//
+// Comments are placed on the GPS trace by a merge join over both time-ordered
+// streams: a comment waits for the next GPS reading and is then interpolated
+// linearly between the two readings bracketing it. Readings further away
+// than the tolerance are not used; a comment without any usable reading is
+// left out of gpsCommentsTrace instead of being put at a stale position.
+//
+// When following a growing recording, the summary also keeps what changed
+// since the last delta was written: the affected message counters, new
+// comments and their positions, and the new GPS readings thinned to the
+// finest tolerance of the trace.
+class RecordingSummary {
+   private:
+    RecordingSummary(const RecordingSummary &) = delete;
+    RecordingSummary(RecordingSummary &&)      = delete;
+    RecordingSummary &operator=(const RecordingSummary &) = delete;
+    RecordingSummary &operator=(RecordingSummary &&) = delete;
+
+   public:
+    /**
+     * @param commentGPSTolerance Microseconds.
+     */
+    explicit RecordingSummary(int64_t commentGPSTolerance) noexcept
+        : m_commentGPSTolerance{commentGPSTolerance} {}
+
+    static bool hasPayloadOfInterest(int32_t dataType, uint32_t senderStamp) noexcept {
+        return ( (dataType == opendlv::proxy::GeodeticWgs84Reading::ID()) && (senderStamp == 0) ) ||
+               ( (dataType == opendlv::system::LogMessage::ID()) && (senderStamp == 999) );
+    }
+
+    void count(int32_t dataType, uint32_t senderStamp, uint32_t n, int64_t firstSampleTimeStamp, int64_t lastSampleTimeStamp) {
+        if (0 == m_numberOfEnvelopes) {
+            m_timeStampFromFirstEnvelope = firstSampleTimeStamp;
+            m_timeStampFromLastEnvelope = lastSampleTimeStamp;
+        }
+        m_timeStampFromFirstEnvelope = std::min(m_timeStampFromFirstEnvelope, firstSampleTimeStamp);
+        m_timeStampFromLastEnvelope = std::max(m_timeStampFromLastEnvelope, lastSampleTimeStamp);
+        m_numberOfEnvelopes += n;
+        m_numberOfMessagesPerType[std::make_pair(dataType, senderStamp)] += n;
+        if (m_trackChanges) {
+            m_changedTypes.insert(std::make_pair(dataType, senderStamp));
+        }
+    }
+
+    void decode(const recfile::EnvelopeHeader &env) {
+        const int64_t sampleTimeStamp{env.sampleTimeStamp};
+        // Simplify opendlv.proxy.GeodeticWgs84Reading into the levels of the GPS trace.
+        if ( (env.dataType == opendlv::proxy::GeodeticWgs84Reading::ID()) &&
+             (env.senderStamp == 0) ) {
+            opendlv::proxy::GeodeticWgs84Reading pos = recfile::extractMessage<opendlv::proxy::GeodeticWgs84Reading>(env);
+            std::array<double, 2> nextPos{{pos.latitude(), pos.longitude()}};
+            if (0 == m_numberOfGPSReadings) {
+                m_firstPosition = nextPos;
+                m_projection.reanchor(nextPos);
+            }
+            m_pendingLatitudes.push_back(nextPos[0]);
+            m_pendingLongitudes.push_back(nextPos[1]);
+            if (m_pendingLatitudes.size() >= GPS_BATCH_SIZE) {
+                projectGPSReadings();
+            }
+            m_lastPosition = nextPos;
+            m_numberOfGPSReadings++;
+
+            resolvePendingComments(sampleTimeStamp, nextPos, true);
+            m_previousGPSTimeStamp = sampleTimeStamp;
+            m_hasPreviousGPSReading = true;
+        }
+        // Export opendlv.system.LogMessage, with and without associated GPS coordinates.
+        else if ( (env.dataType == opendlv::system::LogMessage::ID()) &&
+                  (env.senderStamp == 999) ) {
+            const std::string strLogMessageSampleTime{toDateTime(sampleTimeStamp)};
+            opendlv::system::LogMessage logMessage = recfile::extractMessage<opendlv::system::LogMessage>(env);
+
+            const std::string COMMENT{"{ \"key\": \"" + strLogMessageSampleTime + "\", \"value\":\"" + logMessage.description() + "\", \"opendlv_system_LogMessage\":true}"};
+            m_comments.add(COMMENT);
+            if (m_trackChanges) {
+                m_newComments.push_back(COMMENT);
+            }
+            m_pendingComments.push_back(PendingComment{sampleTimeStamp, "{ \"timestamp\": \"" + strLogMessageSampleTime + "\", \"comment\":\"" + logMessage.description() + "\", \"position\":"});
+        }
+    }
+
+    uint64_t numberOfEnvelopes() const noexcept {
+        return m_numberOfEnvelopes;
+    }
+    const std::map<std::pair<int32_t, uint32_t>, uint32_t> &numberOfMessagesPerType() const noexcept {
+        return m_numberOfMessagesPerType;
+    }
+    int64_t firstSampleTimeStamp() const noexcept {
+        return m_timeStampFromFirstEnvelope;
+    }
+    int64_t lastSampleTimeStamp() const noexcept {
+        return m_timeStampFromLastEnvelope;
+    }
+    uint64_t numberOfComments() const noexcept {
+        return m_comments.size();
+    }
+    uint64_t numberOfGPSReadings() const noexcept {
+        return m_numberOfGPSReadings;
+    }
+
+    /**
+     * Starts keeping the changes to be written by writeDelta().
+     */
+    void trackChanges() noexcept {
+        m_trackChanges = true;
+    }
+
+    /**
+     * @return true if envelopes were added since the last delta.
+     */
+    bool hasChanges() const noexcept {
+        return !m_changedTypes.empty();
+    }
+
+    /**
+     * @param isComplete false while the recording may still grow: comments
+     *        after the last GPS reading then stay pending for later deltas.
+     */
+    void write(std::ostream &out, const MessageScope &scope, bool isComplete = true) {
+        if (isComplete) {
+            resolvePendingComments(0, m_lastPosition, false);
+        }
+        projectGPSReadings();
+        m_gpsTracePyramid.flush();
+
+        out << "{ \"messages\": [ " << '\n';
+        // List message counters per type/sender-stamp.
+        {
+          uint32_t counter{0};
+          for (auto e : m_numberOfMessagesPerType) {
+              const int32_t messageID{e.first.first};
+              const uint32_t senderStamp{e.first.second};
+              out << ((counter > 0) ? "," : "") << "{ \"key\": \"" << messageName(scope, messageID) << "\", \"value\":\"" << e.second << "\", \"selectable\":true, \"messageID\":" << messageID << ", \"senderStamp\":" << senderStamp << "}" << '\n';
+              counter++;
+          }
+        }
+        out << " ] ," << '\n'
+            << " \"comments\": [ " << '\n';
+        m_comments.copyTo(out);
+        out << " ] ," << '\n'
+            << " \"gpsCommentsTrace\": [ " << '\n';
+        if (0 < m_numberOfGPSReadings) {
+            m_gpsCommentsTrace.copyTo(out);
+        }
+        out << " ] ," << '\n'
+            << " \"gpsTracePyramid\": [ " << '\n';
+        if (2 <= m_numberOfGPSReadings) {
+            for (size_t i{0}; i < m_gpsTracePyramid.numberOfLevels(); i++) {
+                out << ((i > 0) ? "," : "") << "{ \"tolerance\":" << m_gpsTracePyramid.tolerance(i) << ", \"numberOfPoints\":" << m_gpsTracePyramid.numberOfPoints(i)
+                    << ", \"data\":\"" << cluon::ToJSONVisitor::encodeBase64(m_gpsTracePyramid.data(i)) << "\"}" << '\n';
+            }
+        }
+        out << " ] ," << '\n'
+            << " \"fileInformation\": [ " << '\n'
+            << "{ \"key\": \"number of messages:\", \"value\":\"" << m_numberOfEnvelopes << "\"}" << '\n'
+            << ",{ \"key\": \"start of recording:\", \"value\":\"" << toDateTime(m_timeStampFromFirstEnvelope) << "\"}" << '\n'
+            << ",{ \"key\": \"end of recording:\", \"value\":\"" << toDateTime(m_timeStampFromLastEnvelope) << "\"}" << '\n';
+        out << " ]," << '\n';
+        out << "\"geojson\":\"ewogICJ0eXBlIjogIkZlYXR1cmUiLAogICJnZW9tZXRyeSI6IHsKICAgICJ0eXBlIjogIlBvaW50IiwKICAgICJjb29yZGluYXRlcyI6IFsxMi4wLCA1Ny43XQogIH0sCiAgInByb3BlcnRpZXMiOiB7CiAgICAibmFtZSI6ICJEaW5hZ2F0IElzbGFuZHMiCiAgfQp9\""<< '\n';
+        if (2 <= m_numberOfGPSReadings) {
+            out << ",\"firstWGS84\": \"" << cluon::ToJSONVisitor::encodeBase64(toJSON(m_firstPosition)) << "\"" << '\n';
+            out << ",\"lastWGS84\": \"" << cluon::ToJSONVisitor::encodeBase64(toJSON(m_lastPosition)) << "\"" << '\n';
+        }
+        out << "}" << std::endl;
+        clearChanges();
+    }
+
+    /**
+     * Writes the changes since the previous write() or writeDelta() as one
+     * line of JSON.
+     *
+     * @param offset Bytes of the recording consumed so far.
+     * @param isComplete true if nothing will be appended anymore.
+     */
+    void writeDelta(std::ostream &out, const MessageScope &scope, uint64_t offset, bool isComplete) {
+        if (isComplete) {
+            resolvePendingComments(0, m_lastPosition, false);
+        }
+        projectGPSReadings();
+
+        auto writeArray = [&out](const std::vector<std::string> &entries) {
+            for (size_t i{0}; i < entries.size(); i++) {
+                out << ((i > 0) ? "," : "") << entries[i];
+            }
+        };
+        out << "{ \"offset\":" << offset << ", \"complete\":" << (isComplete ? "true" : "false") << ", \"messages\": [ ";
+        {
+          uint32_t counter{0};
+          for (auto const &e : m_changedTypes) {
+              out << ((counter > 0) ? "," : "") << "{ \"key\": \"" << messageName(scope, e.first) << "\", \"value\":\"" << m_numberOfMessagesPerType[e]
+                  << "\", \"selectable\":true, \"messageID\":" << e.first << ", \"senderStamp\":" << e.second << "}";
+              counter++;
+          }
+        }
+        out << " ], \"comments\": [ ";
+        writeArray(m_newComments);
+        out << " ], \"gpsCommentsTrace\": [ ";
+        writeArray(m_newCommentPositions);
+        out << " ], \"gpsTraceTail\": [ ";
+        for (size_t i{0}; i < m_gpsTraceTail.size(); i++) {
+            out << ((i > 0) ? "," : "") << toJSON(m_gpsTraceTail[i]);
+        }
+        out << " ], \"fileInformation\": [ "
+            << "{ \"key\": \"number of messages:\", \"value\":\"" << m_numberOfEnvelopes << "\"}"
+            << ",{ \"key\": \"end of recording:\", \"value\":\"" << toDateTime(m_timeStampFromLastEnvelope) << "\"}"
+            << " ]";
+        if (0 < m_numberOfGPSReadings) {
+            out << ", \"lastWGS84\": \"" << cluon::ToJSONVisitor::encodeBase64(toJSON(m_lastPosition)) << "\"";
+        }
+        out << " }" << std::endl;
+        clearChanges();
+    }
+
+   private:
+    void clearChanges() noexcept {
+        m_changedTypes.clear();
+        m_newComments.clear();
+        m_newCommentPositions.clear();
+        m_gpsTraceTail.clear();
+    }
+
+    /**
+     * Projects the pending GPS readings as one batch and adds them to the
+     * trace pyramid. All readings share one projection that follows the
+     * trace, so only its reference terms change when the vehicle moves far.
+     */
+    void projectGPSReadings() {
+        const size_t N{m_pendingLatitudes.size()};
+        if (0 == N) {
+            return;
+        }
+        m_x.resize(N);
+        m_y.resize(N);
+        m_projection.toCartesian(m_pendingLatitudes.data(), m_pendingLongitudes.data(), N, m_x.data(), m_y.data());
+        for (size_t i{0}; i < N; i++) {
+            m_gpsTracePyramid.add(m_x[i], m_y[i], m_pendingLatitudes[i], m_pendingLongitudes[i]);
+        }
+        if (m_trackChanges) {
+            for (size_t i{0}; i < N; i++) {
+                if (!m_hasTailPosition || (std::hypot(m_x[i] - m_tailX, m_y[i] - m_tailY) >= GPS_TRACE_TOLERANCES.front())) {
+                    m_gpsTraceTail.push_back({{m_pendingLatitudes[i], m_pendingLongitudes[i]}});
+                    m_tailX = m_x[i];
+                    m_tailY = m_y[i];
+                    m_hasTailPosition = true;
+                }
+            }
+        }
+
+        if (std::hypot(m_x[N - 1], m_y[N - 1]) > REANCHOR_DISTANCE) {
+            m_gpsTracePyramid.flush();
+            m_projection.reanchor({{m_pendingLatitudes[N - 1], m_pendingLongitudes[N - 1]}});
+            m_hasTailPosition = false;
+        }
+        m_pendingLatitudes.clear();
+        m_pendingLongitudes.clear();
+    }
+
+    struct PendingComment {
+        int64_t sampleTimeStamp;
+        std::string json;  // Everything up to the position.
+    };
+
+    /**
+     * Places all comments received since the previous GPS reading.
+     *
+     * @param sampleTimeStamp Time of the GPS reading following the comments.
+     * @param position Position of the GPS reading following the comments.
+     * @param hasNext false at the end of the recording.
+     */
+    void resolvePendingComments(int64_t sampleTimeStamp, std::array<double, 2> const &position, bool hasNext) {
+        for (auto const &c : m_pendingComments) {
+            const bool HAS_PREVIOUS{m_hasPreviousGPSReading && (c.sampleTimeStamp - m_previousGPSTimeStamp <= m_commentGPSTolerance)};
+            const bool HAS_NEXT{hasNext && (sampleTimeStamp - c.sampleTimeStamp <= m_commentGPSTolerance)};
+            std::array<double, 2> commentPosition{{0, 0}};
+            if (HAS_PREVIOUS && HAS_NEXT && (sampleTimeStamp > m_previousGPSTimeStamp)) {
+                const double w{static_cast<double>(c.sampleTimeStamp - m_previousGPSTimeStamp) / static_cast<double>(sampleTimeStamp - m_previousGPSTimeStamp)};
+                commentPosition[0] = m_previousPosition[0] + w * (position[0] - m_previousPosition[0]);
+                commentPosition[1] = m_previousPosition[1] + w * (position[1] - m_previousPosition[1]);
+            }
+            else if (HAS_PREVIOUS) {
+                commentPosition = m_previousPosition;
+            }
+            else if (HAS_NEXT) {
+                commentPosition = position;
+            }
+            else {
+                continue;
+            }
+            m_gpsCommentsTrace.add(c.json + toJSON(commentPosition) + " }");
+            if (m_trackChanges) {
+                m_newCommentPositions.push_back(c.json + toJSON(commentPosition) + " }");
+            }
+        }
+        m_pendingComments.clear();
+        m_previousPosition = position;
+    }
+
+   private:
+    int64_t m_commentGPSTolerance;
+
+    uint64_t m_numberOfEnvelopes{0};
+    std::map<std::pair<int32_t, uint32_t>, uint32_t> m_numberOfMessagesPerType{};
+    int64_t m_timeStampFromFirstEnvelope{0};
+    int64_t m_timeStampFromLastEnvelope{0};
+
+    JSONArray m_comments{};
+    JSONArray m_gpsCommentsTrace{};
+    wgs84::TracePyramid m_gpsTracePyramid{GPS_TRACE_TOLERANCES};
+
+    uint64_t m_numberOfGPSReadings{0};
+    std::array<double, 2> m_firstPosition{{0, 0}};
+    std::array<double, 2> m_lastPosition{{0, 0}};
+
+    wgs84::Projection m_projection{{{0, 0}}};
+    std::vector<double> m_pendingLatitudes{};
+    std::vector<double> m_pendingLongitudes{};
+    std::vector<double> m_x{};
+    std::vector<double> m_y{};
+
+    bool m_hasPreviousGPSReading{false};
+    int64_t m_previousGPSTimeStamp{0};
+    std::array<double, 2> m_previousPosition{{0, 0}};
+    std::vector<PendingComment> m_pendingComments{};
+
+    bool m_trackChanges{false};
+    std::set<std::pair<int32_t, uint32_t>> m_changedTypes{};
+    std::vector<std::string> m_newComments{};
+    std::vector<std::string> m_newCommentPositions{};
+    std::vector<std::array<double, 2>> m_gpsTraceTail{};
+    bool m_hasTailPosition{false};
+    double m_tailX{0};
+    double m_tailY{0};
+};
+
+// Fills the summary from the sidecar index: counts come from the per-type
+// summaries, and only the envelopes of interest are visited, merged in order
+// of sample time, straight from the memory-mapped recording.
+bool summarizeFromIndex(const std::string &recFile, RecordingSummary &summary) {
+    recfile::RecIndex index;
+    recfile::MappedFile recording;
+    if (!index.open(recFile) || ( (0 < index.numberOfEntries()) && !recording.open(recFile) )) {
+        return false;
+    }
+
+    std::vector<std::pair<const uint32_t*, const uint32_t*>> postings;
+    for (uint32_t i{0}; i < index.numberOfTypes(); i++) {
+        const recfile::IndexTypeSummary &type = index.type(i);
+        summary.count(type.dataType, type.senderStamp, static_cast<uint32_t>(type.numberOfEnvelopes), type.firstSampleTimeStamp, type.lastSampleTimeStamp);
+        if (RecordingSummary::hasPayloadOfInterest(type.dataType, type.senderStamp)) {
+            postings.emplace_back(index.postings(i), index.postings(i) + type.numberOfEnvelopes);
+        }
+    }
+
+    // Entry numbers are positions in time order, so merging the posting lists
+    // by entry number yields the envelopes of interest in time order.
+    while (true) {
+        std::pair<const uint32_t*, const uint32_t*> *next{nullptr};
+        for (auto &p : postings) {
+            if ( (p.first != p.second) && ( (nullptr == next) || (*p.first < *next->first) ) ) {
+                next = &p;
+            }
+        }
+        if (nullptr == next) {
+            break;
+        }
+        recfile::EnvelopeHeader env;
+        if (recfile::envelopeAt(recording, index.entry(*next->first).offset(), env)) {
+            summary.decode(env);
+        }
+        next->first++;
+    }
+    return true;
+}
+
+/**
+ * @param recFile Recording to summarize, from its index if useIndex and the index is up-to-date.
+ * @param indexed Set if the index was used.
+ * @param numberOfBytes Size of the recording.
+ * @return false if the recording could not be opened.
+ */
+bool summarize(const std::string &recFile, bool useIndex, RecordingSummary &summary, bool &indexed, uint64_t &numberOfBytes) {
+    std::fstream fin(recFile, std::ios::in|std::ios::binary);
+    if (!fin.good()) {
+        return false;
+    }
+    fin.seekg(0, std::ios::end);
+    numberOfBytes = static_cast<uint64_t>(fin.tellg());
+    fin.seekg(0, std::ios::beg);
+
+    // Everything below is either bounded by the number of distinct message
+    // types or spilled to disk, so memory does not grow with the length of
+    // the recording.
+    indexed = useIndex && summarizeFromIndex(recFile, summary);
+    if (!indexed) {
+        // Envelopes are read sequentially instead of through cluon::Player,
+        // which indexes the whole file, and only the payloads of interest are
+        // decoded.
+        recfile::EnvelopeScanner scanner(fin);
+        recfile::EnvelopeHeader env;
+        while (scanner.next(env)) {
+            summary.count(env.dataType, env.senderStamp, 1, env.sampleTimeStamp, env.sampleTimeStamp);
+            if (RecordingSummary::hasPayloadOfInterest(env.dataType, env.senderStamp)) {
+                summary.decode(env);
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Writes the meta information of a recording as JSON to out. With a cache,
+ * a result for the identical recording and inputs is served from it, and a
+ * new result is added to it unless the recording is still growing.
+ *
+ * @param cache Optional.
+ * @param how Where the result came from, for benchmark reports.
+ * @return false if the recording could not be opened.
+ */
+bool summarizeToJSON(const std::string &recFile, bool useIndex, int64_t commentGPSTolerance, const MessageScope &scope,
+                     const recfile::MetadataCache *cache, std::ostream &out,
+                     uint64_t &numberOfEnvelopes, uint64_t &numberOfBytes, std::string &how) {
+    recfile::MetadataCache::Fingerprint fp;
+    const bool CACHEABLE{(nullptr != cache) && cache->fingerprint(recFile, fp)};
+    if (CACHEABLE && cache->load(recFile, fp, out)) {
+        numberOfBytes = fp.size;
+        how = "from cache ";
+        return true;
+    }
+
+    RecordingSummary summary(commentGPSTolerance);
+    bool indexed{false};
+    if (!summarize(recFile, useIndex, summary, indexed, numberOfBytes)) {
+        return false;
+    }
+    numberOfEnvelopes = summary.numberOfEnvelopes();
+    how = indexed ? "from index " : "";
+
+    if (CACHEABLE) {
+        const std::string TMP{cache->temporaryEntry(recFile, fp)};
+        std::ofstream fout(TMP, std::ios::out|std::ios::binary|std::ios::trunc);
+        if (fout.good()) {
+            summary.write(fout, scope);
+            fout.close();
+            std::ifstream fin(TMP, std::ios::in|std::ios::binary);
+            out << fin.rdbuf();
+            cache->store(recFile, fp);
+            return true;
+        }
+    }
+    summary.write(out, scope);
+    return true;
+}
+
+volatile std::sig_atomic_t g_stopFollowing{0};
+
+void stopFollowing(int) {
+    g_stopFollowing = 1;
+}
+
+/**
+ * Writes the meta information of a recording that may still grow as JSON to
+ * out and then, whenever envelopes are appended, one line of JSON with the
+ * changes. The file is watched with inotify; only appended bytes are read
+ * and the state of the summary is kept, so an update costs time proportional
+ * to the new data. Incomplete envelopes at the end wait for the rest.
+ *
+ * Following ends with a last delta marked complete once the writer closes
+ * the file, and without it when the file is deleted or renamed or on
+ * SIGINT/SIGTERM.
+ *
+ * @param interval Minimum time between two deltas.
+ * @return false if the recording could not be opened or watched.
+ */
+bool followRecording(const std::string &recFile, int64_t commentGPSTolerance, const MessageScope &scope,
+                     std::chrono::milliseconds interval, std::ostream &out) {
+    std::ifstream fin(recFile, std::ios::in|std::ios::binary);
+    const int fd{::inotify_init1(IN_NONBLOCK|IN_CLOEXEC)};
+    if (!fin.good() || (0 > fd) ||
+        (0 > ::inotify_add_watch(fd, recFile.c_str(), IN_MODIFY|IN_CLOSE_WRITE|IN_DELETE_SELF|IN_MOVE_SELF))) {
+        if (0 <= fd) {
+            ::close(fd);
+        }
+        return false;
+    }
+    std::signal(SIGINT, stopFollowing);
+    std::signal(SIGTERM, stopFollowing);
+
+    RecordingSummary summary(commentGPSTolerance);
+    recfile::EnvelopeScanner scanner(fin);
+    auto readAppendedEnvelopes = [&fin, &scanner, &summary]() {
+        fin.clear();
+        recfile::EnvelopeHeader env;
+        while (scanner.next(env)) {
+            summary.count(env.dataType, env.senderStamp, 1, env.sampleTimeStamp, env.sampleTimeStamp);
+            if (RecordingSummary::hasPayloadOfInterest(env.dataType, env.senderStamp)) {
+                summary.decode(env);
+            }
+        }
+    };
+
+    // Events that arrive while the recording is read are caught by the next
+    // poll, so nothing appended after the initial scan is missed.
+    readAppendedEnvelopes();
+    summary.write(out, scope, false);
+    summary.trackChanges();
+
+    bool isComplete{false};
+    bool isGone{false};
+    auto lastDelta{std::chrono::steady_clock::now()};
+    while ( (0 == g_stopFollowing) && !isComplete && !isGone ) {
+        struct pollfd pfd{fd, POLLIN, 0};
+        const auto WAIT{std::max(std::chrono::milliseconds(0),
+            std::chrono::duration_cast<std::chrono::milliseconds>(interval - (std::chrono::steady_clock::now() - lastDelta)))};
+        if (0 < ::poll(&pfd, 1, summary.hasChanges() ? static_cast<int>(WAIT.count()) : -1)) {
+            alignas(struct inotify_event) char events[4096];
+            ssize_t length{0};
+            while (0 < (length = ::read(fd, events, sizeof(events)))) {
+                for (char *p{events}; p < events + length; ) {
+                    const struct inotify_event *e{reinterpret_cast<const struct inotify_event*>(p)};
+                    isComplete = isComplete || (0 != (e->mask & IN_CLOSE_WRITE));
+                    isGone = isGone || (0 != (e->mask & (IN_DELETE_SELF|IN_MOVE_SELF|IN_IGNORED)));
+                    p += sizeof(struct inotify_event) + e->len;
+                }
+            }
+            readAppendedEnvelopes();
+        }
+        if ( !isGone && (summary.hasChanges() || isComplete) &&
+             (isComplete || (std::chrono::steady_clock::now() - lastDelta >= interval)) ) {
+            summary.writeDelta(out, scope, scanner.position(), isComplete);
+            lastDelta = std::chrono::steady_clock::now();
+        }
+    }
+    ::close(fd);
+    return true;
+}
+
+/**
+ * @param pattern Directory (all .rec files in it) or glob pattern.
+ * @return Matching recordings in lexicographical order.
+ */
+std::vector<std::string> findRecordings(const std::string &pattern) {
+    struct stat st;
+    const bool IS_DIRECTORY{(0 == ::stat(pattern.c_str(), &st)) && S_ISDIR(st.st_mode)};
+    const std::string GLOB{IS_DIRECTORY ? pattern + "/*.rec" : pattern};
+
+    std::vector<std::string> recordings;
+    glob_t matches;
+    if (0 == ::glob(GLOB.c_str(), 0, nullptr, &matches)) {
+        for (size_t i{0}; i < matches.gl_pathc; i++) {
+            recordings.emplace_back(matches.gl_pathv[i]);
+        }
+    }
+    ::globfree(&matches);
+    return recordings;
+}
+
+// What the fleet summary keeps of one recording.
+struct RecordingInformation {
+    bool processed{false};
+    uint64_t numberOfBytes{0};
+    uint64_t numberOfEnvelopes{0};
+    int64_t firstSampleTimeStamp{0};
+    int64_t lastSampleTimeStamp{0};
+    uint64_t numberOfComments{0};
+    uint64_t numberOfGPSReadings{0};
+    std::map<std::pair<int32_t, uint32_t>, uint32_t> numberOfMessagesPerType{};
+};
+
+void writeFleetSummary(std::ostream &out, const std::vector<std::string> &recordings, const std::vector<RecordingInformation> &information, const MessageScope &scope) {
+    std::map<std::pair<int32_t, uint32_t>, uint64_t> numberOfMessagesPerType;
+    uint64_t numberOfEnvelopes{0};
+    uint64_t numberOfBytes{0};
+    uint32_t numberOfRecordings{0};
+
+    out << "{ \"recordings\": [ " << '\n';
+    for (size_t i{0}; i < recordings.size(); i++) {
+        const RecordingInformation &r = information[i];
+        if (!r.processed) {
+            continue;
+        }
+        out << ((numberOfRecordings > 0) ? "," : "") << "{ \"name\": \"" << recordings[i] << "\", \"size\":" << r.numberOfBytes
+            << ", \"numberOfMessages\":" << r.numberOfEnvelopes
+            << ", \"start\": \"" << toDateTime(r.firstSampleTimeStamp) << "\", \"end\": \"" << toDateTime(r.lastSampleTimeStamp) << "\""
+            << ", \"durationInSeconds\":" << static_cast<double>(r.lastSampleTimeStamp - r.firstSampleTimeStamp) / (1000.0 * 1000.0)
+            << ", \"numberOfComments\":" << r.numberOfComments << ", \"numberOfGPSReadings\":" << r.numberOfGPSReadings << " }" << '\n';
+        for (auto const &e : r.numberOfMessagesPerType) {
+            numberOfMessagesPerType[e.first] += e.second;
+        }
+        numberOfEnvelopes += r.numberOfEnvelopes;
+        numberOfBytes += r.numberOfBytes;
+        numberOfRecordings++;
+    }
+    out << " ] ," << '\n'
+        << " \"messages\": [ " << '\n';
+    {
+        uint32_t counter{0};
+        for (auto const &e : numberOfMessagesPerType) {
+            out << ((counter > 0) ? "," : "") << "{ \"key\": \"" << messageName(scope, e.first.first) << "\", \"value\":\"" << e.second << "\", \"messageID\":" << e.first.first << ", \"senderStamp\":" << e.first.second << "}" << '\n';
+            counter++;
+        }
+    }
+    out << " ] ," << '\n'
+        << " \"numberOfRecordings\":" << numberOfRecordings << ", \"numberOfMessages\":" << numberOfEnvelopes << ", \"size\":" << numberOfBytes << '\n'
+        << "}" << std::endl;
+}
+
+}
 
 int32_t main(int32_t argc, char **argv) {
     int32_t retCode{0};
     auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
-    if ( (0 == commandlineArguments.count("rec")) || (0 == commandlineArguments.count("odvd")) ) {
+    if ( ( (0 == commandlineArguments.count("rec")) && (0 == commandlineArguments.count("recs")) ) || (0 == commandlineArguments.count("odvd")) ) {
         std::cerr << argv[0] << " extracts meta information from a given .rec file using a provided .odvd message specification as a JSON object to stdout." << std::endl;
-        std::cerr << "Usage:   " << argv[0] << " --rec=<Recording from an OD4Session> --odvd=<ODVD Message Specification>" << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " --rec=<Recording from an OD4Session> --odvd=<ODVD Message Specification> [--gps-tolerance=<ms>] [--no-index] [--cache=<Directory>] [--benchmark]" << std::endl;
+        std::cerr << "         " << argv[0] << " --rec=<Recording from an OD4Session> --odvd=<ODVD Message Specification> --follow [--interval=<ms>] [--gps-tolerance=<ms>]" << std::endl;
+        std::cerr << "         " << argv[0] << " --recs=<Directory or glob pattern> --odvd=<ODVD Message Specification> [--jobs=<n>] [--out=<Directory>|--summary] [--gps-tolerance=<ms>] [--no-index] [--cache=<Directory>] [--benchmark]" << std::endl;
+        std::cerr << "         --gps-tolerance: maximum time between a comment and the GPS readings used to position it, default 250" << std::endl;
+        std::cerr << "         --no-index:  scan the recording even if an up-to-date index (see rec-index) exists" << std::endl;
+        std::cerr << "         --cache:     serve results for unchanged recordings from and add new results to the given directory" << std::endl;
+        std::cerr << "         --benchmark: report throughput and peak memory on stderr" << std::endl;
+        std::cerr << "         --follow:    keep watching a growing recording and write one line of JSON with the changes per --interval (default 1000)" << std::endl;
+        std::cerr << "                      until the recording is closed by its writer" << std::endl;
+        std::cerr << "         --recs:      process all matching recordings concurrently on --jobs threads (default: number of cores);" << std::endl;
+        std::cerr << "                      writes <recording>.json next to each recording or into --out, or a fleet summary to stdout with --summary" << std::endl;
         std::cerr << "Example: " << argv[0] << " --rec=myRecording.rec --odvd=myMessage" << std::endl;
+        std::cerr << "         " << argv[0] << " --recs='recordings/*.rec' --odvd=myMessage --summary" << std::endl;
         retCode = 1;
     } else {
+        const bool BENCHMARK{0 != commandlineArguments.count("benchmark")};
+        const bool USE_INDEX{0 == commandlineArguments.count("no-index")};
+        const int64_t COMMENT_GPS_TOLERANCE{(0 != commandlineArguments.count("gps-tolerance"))
+            ? std::stoll(commandlineArguments["gps-tolerance"]) * 1000 : DEFAULT_COMMENT_GPS_TOLERANCE};
+
         cluon::MessageParser mp;
         std::pair<std::vector<cluon::MetaMessage>, cluon::MessageParser::MessageParserErrorCodes> messageParserResult;
+        uint64_t odvdHash{0};
         {
             std::ifstream fin(commandlineArguments["odvd"], std::ios::in|std::ios::binary);
             if (fin.good()) {
                 std::string input(static_cast<std::stringstream const&>(std::stringstream() << fin.rdbuf()).str()); // NOLINT
                 fin.close();
                 messageParserResult = mp.parse(input);
+                odvdHash = recfile::fnv1a(input.data(), input.size());
                 std::clog << "Found " << messageParserResult.first.size() << " messages." << std::endl;
             }
             else {
@@ -53,214 +802,120 @@ int32_t main(int32_t argc, char **argv) {
                 return retCode;
             }
         }
+        // Parsed once and only read afterwards, shared by all workers in batch mode.
+        MessageScope scope;
+        for (const auto &e : messageParserResult.first) { scope[e.messageIdentifier()] = e; }
 
-        std::fstream fin(commandlineArguments["rec"], std::ios::in|std::ios::binary);
-        if (fin.good()) {
-            fin.close();
-
-            std::map<int32_t, cluon::MetaMessage> scope;
-            for (const auto &e : messageParserResult.first) { scope[e.messageIdentifier()] = e; }
-
-            constexpr bool AUTOREWIND{false};
-            constexpr bool THREADING{false};
-            cluon::Player player(commandlineArguments["rec"], AUTOREWIND, THREADING);
-
-            uint32_t numberOfEnvelopes{0};
-
-            std::map<std::string, uint32_t> numberOfMessagesPerType{};
-            std::vector<cluon::data::Envelope> envelopesWithOpendlvSystemLogMessage{};
-            std::vector<cluon::data::Envelope> envelopesWithOpendlvProxyGeodeticWgs84Reading{};
-
-            bool timeStampFromFirstEnvelopeSet{false};
-            cluon::data::TimeStamp timeStampFromFirstEnvelope;
-            cluon::data::TimeStamp timeStampFromLastEnvelope;
-            while (player.hasMoreData()) {
-                auto next = player.getNextEnvelopeToBeReplayed();
-                if (next.first) {
-                    cluon::data::Envelope env{std::move(next.second)};
-                    if (!timeStampFromFirstEnvelopeSet) {
-                        timeStampFromFirstEnvelope = env.sampleTimeStamp();
-                        timeStampFromFirstEnvelopeSet = true;
-                    }
-                    timeStampFromLastEnvelope = env.sampleTimeStamp();
-                    numberOfEnvelopes++;
-
-                    // Count types.
-                    {
-                        std::stringstream sstrKey;
-                        sstrKey << env.dataType() << "/" << env.senderStamp();
-                        const std::string KEY = sstrKey.str();
-                        numberOfMessagesPerType[KEY]++;
-                    }
-                    // Store opendlv.system.LogMessage.
-                    if ( (env.dataType() == opendlv::system::LogMessage::ID()) &&
-                         (env.senderStamp() == 999) ) {
-                        envelopesWithOpendlvSystemLogMessage.push_back(env);
-                    }
-                    // Store opendlv.proxy.GeodeticWgs84Reading.
-                    if ( (env.dataType() == opendlv::proxy::GeodeticWgs84Reading::ID()) &&
-                         (env.senderStamp() == 0) ) {
-                        envelopesWithOpendlvProxyGeodeticWgs84Reading.push_back(env);
-                    }
+        // Results depend on the recording, the message specification, the tolerance and the output version.
+        std::unique_ptr<recfile::MetadataCache> cache;
+        if (0 != commandlineArguments.count("cache")) {
+            uint64_t salt{recfile::fnv1a(reinterpret_cast<const char*>(&COMMENT_GPS_TOLERANCE), sizeof(COMMENT_GPS_TOLERANCE), odvdHash)};
+            salt = recfile::fnv1a(reinterpret_cast<const char*>(&OUTPUT_VERSION), sizeof(OUTPUT_VERSION), salt);
+            cache.reset(new recfile::MetadataCache(commandlineArguments["cache"], salt));
+        }
 
-                }
-            }
+        const auto startOfProcessing{std::chrono::steady_clock::now()};
+        auto reportBenchmark = [&argv, &startOfProcessing](uint64_t numberOfEnvelopes, uint64_t numberOfBytes, const std::string &how) {
+            const double seconds{std::chrono::duration<double>(std::chrono::steady_clock::now() - startOfProcessing).count()};
+            const double megabytes{static_cast<double>(numberOfBytes) / (1024.0 * 1024.0)};
+            struct rusage usage;
+            ::getrusage(RUSAGE_SELF, &usage);
+            std::clog << argv[0] << ": Processed " << numberOfEnvelopes << " envelopes (" << std::setprecision(4) << megabytes << " MB) "
+                      << how << "in " << seconds << " s: " << (megabytes / seconds) << " MB/s, peak RSS " << (usage.ru_maxrss / 1024) << " MB." << std::endl;
+        };
 
-            char dateTimeBuffer[26];
-            time_t firstSampleTime = timeStampFromFirstEnvelope.seconds();
-            ::ctime_r(&firstSampleTime, dateTimeBuffer);
-            std::string strFirstSampleTime(dateTimeBuffer);
-            strFirstSampleTime = strFirstSampleTime.substr(0, strFirstSampleTime.size()-1);
-            strFirstSampleTime = stringtoolbox::trim(strFirstSampleTime);
-
-            time_t lastSampleTime = timeStampFromLastEnvelope.seconds();
-            ::ctime_r(&lastSampleTime, dateTimeBuffer);
-            std::string strLastSampleTime(dateTimeBuffer);
-            strLastSampleTime = strLastSampleTime.substr(0, strLastSampleTime.size()-1);
-            strLastSampleTime = stringtoolbox::trim(strLastSampleTime);
-            std::cout << "{ \"messages\": [ " << std::endl;
-            // List message counters per type/sender-stamp.
-            {
-              uint32_t counter{0};
-              for (auto e : numberOfMessagesPerType) {
-                  int32_t messageID{0};
-                  {
-                      std::string tmp{stringtoolbox::split(e.first, '/').at(0)};
-                      std::stringstream sstr(tmp);
-                      sstr >> messageID;
-                  }
-                  int32_t senderStamp{0};
-                  {
-                      std::string tmp{stringtoolbox::split(e.first, '/').at(1)};
-                      std::stringstream sstr(tmp);
-                      sstr >> senderStamp;
-                  }
-                  std::cout << ((counter > 0) ? "," : "") << "{ \"key\": \"" << (scope.count(messageID) > 0 ? scope[messageID].messageName() : "unknown message") << "\", \"value\":\"" << e.second << "\", \"selectable\":true, \"messageID\":" << messageID << ", \"senderStamp\":" << senderStamp << "}" << std::endl;
-                  counter++;
-              }
+        if ( (0 != commandlineArguments.count("rec")) && (0 != commandlineArguments.count("follow")) ) {
+            const std::string REC{commandlineArguments["rec"]};
+            const std::chrono::milliseconds INTERVAL{(0 != commandlineArguments.count("interval"))
+                ? std::stoi(commandlineArguments["interval"]) : 1000};
+            if (!followRecording(REC, COMMENT_GPS_TOLERANCE, scope, INTERVAL, std::cout)) {
+                std::cerr << argv[0] << ": Recording '" << REC << "' not found." << std::endl;
+                retCode = 1;
             }
-            std::cout << " ] ," << std::endl
-                      << " \"comments\": [ " << std::endl;
-            // Export opendlv.system.LogMessage.
-            {
-                uint32_t counter{0};
-                for (auto e : envelopesWithOpendlvSystemLogMessage) {
-                    if ( (e.dataType() == opendlv::system::LogMessage::ID()) &&
-                         (e.senderStamp() == 999) ) {
-                        time_t logMessageSampleTime = e.sampleTimeStamp().seconds();
-                        ::ctime_r(&logMessageSampleTime, dateTimeBuffer);
-                        std::string strLogMessageSampleTime(dateTimeBuffer);
-                        strLogMessageSampleTime = strLogMessageSampleTime.substr(0, strLogMessageSampleTime.size()-1);
-                        strLogMessageSampleTime = stringtoolbox::trim(strLogMessageSampleTime);
-
-                        opendlv::system::LogMessage logMessage = cluon::extractMessage<opendlv::system::LogMessage>(std::move(e));
-
-                        std::cout << ((counter > 0)? "," : "") << "{ \"key\": \"" << strLogMessageSampleTime << "\", \"value\":\"" << logMessage.description() << "\", \"opendlv_system_LogMessage\":true}" << std::endl;
-                        counter++;
-                    }
+        }
+        else if (0 != commandlineArguments.count("rec")) {
+            const std::string REC{commandlineArguments["rec"]};
+            uint64_t numberOfEnvelopes{0};
+            uint64_t numberOfBytes{0};
+            std::string how;
+            if (summarizeToJSON(REC, USE_INDEX, COMMENT_GPS_TOLERANCE, scope, cache.get(), std::cout, numberOfEnvelopes, numberOfBytes, how)) {
+                if (BENCHMARK) {
+                    reportBenchmark(numberOfEnvelopes, numberOfBytes, how);
                 }
             }
-            std::cout << " ] ," << std::endl
-                      << " \"gpsCommentsTrace\": [ " << std::endl;
-            // Export opendlv.system.LogMessage with associated GPS coordinates.
-            {
-                if (!envelopesWithOpendlvProxyGeodeticWgs84Reading.empty()) {
-                    uint32_t counter{0};
-                    std::vector<cluon::data::Envelope>::iterator closestGPS;
-                    std::array<double, 2> position = {0, 0};
-
-                    for (auto e : envelopesWithOpendlvSystemLogMessage) {
-                        if ( (e.dataType() == opendlv::system::LogMessage::ID()) &&
-                             (e.senderStamp() == 999) ) {
-                            if (!envelopesWithOpendlvProxyGeodeticWgs84Reading.empty()) {
-                                if (0 == counter) {
-                                    closestGPS = envelopesWithOpendlvProxyGeodeticWgs84Reading.begin();
-                                }
-                                while (closestGPS != envelopesWithOpendlvProxyGeodeticWgs84Reading.end()) {
-                                    auto delta = cluon::time::deltaInMicroseconds(e.sampleTimeStamp(), (*closestGPS).sampleTimeStamp());
-                                    if ( (delta > 0) && (delta < static_cast<int64_t>(250*1000)) ) {
-                                        cluon::data::Envelope env = *closestGPS;
-                                        opendlv::proxy::GeodeticWgs84Reading pos = cluon::extractMessage<opendlv::proxy::GeodeticWgs84Reading>(std::move(env));
-                                        position[0] = pos.latitude();
-                                        position[1] = pos.longitude();
-                                        break;
-                                    }
-
-                                    closestGPS++;
-                                }
-                            }
-                            time_t logMessageSampleTime = e.sampleTimeStamp().seconds();
-                            ::ctime_r(&logMessageSampleTime, dateTimeBuffer);
-                            std::string strLogMessageSampleTime(dateTimeBuffer);
-                            strLogMessageSampleTime = strLogMessageSampleTime.substr(0, strLogMessageSampleTime.size()-1);
-                            strLogMessageSampleTime = stringtoolbox::trim(strLogMessageSampleTime);
-
-                            opendlv::system::LogMessage logMessage = cluon::extractMessage<opendlv::system::LogMessage>(std::move(e));
-
-                            std::cout << ((counter > 0)? "," : "") << "{ \"timestamp\": \"" << strLogMessageSampleTime << "\", \"comment\":\"" << logMessage.description() << "\", \"position\":{" << "\"latitude\":" << std::setprecision(10) << position[0] << std::setprecision(6) << ",\"longitude\":" << std::setprecision(10) << position[1] << std::setprecision(6)<< "} }" << std::endl;
-                            counter++;
-                        }
-                    }
-                }
+            else {
+                std::cerr << argv[0] << ": Recording '" << REC << "' not found." << std::endl;
             }
-            std::cout << " ] ," << std::endl
-                      << " \"gpsTrace\": [ " << std::endl;
-            // Export opendlv.proxy.GeodeticWgs84Reading.
-            {
-                if (envelopesWithOpendlvProxyGeodeticWgs84Reading.size() >= 2) {
-                    cluon::data::Envelope envFirst = envelopesWithOpendlvProxyGeodeticWgs84Reading.front();
-                    opendlv::proxy::GeodeticWgs84Reading firstPos = cluon::extractMessage<opendlv::proxy::GeodeticWgs84Reading>(std::move(envFirst));
-
-                    uint32_t counter{0};
-                    std::array<double, 2> reference{firstPos.latitude(), firstPos.longitude()};
-                    for (auto env : envelopesWithOpendlvProxyGeodeticWgs84Reading) {
-                        opendlv::proxy::GeodeticWgs84Reading nextWGS84 = cluon::extractMessage<opendlv::proxy::GeodeticWgs84Reading>(std::move(env));
-                        std::array<double, 2> nextPos{nextWGS84.latitude(), nextWGS84.longitude()};
-                        std::array<double, 2> result{wgs84::toCartesian(reference, nextPos)};
-                        double d = std::sqrt(result[0]*result[0] + result[1]*result[1]);
-                        if (d > 5) {
-                            reference = nextPos;
-                            std::cout << ((counter > 0)? "," : "") << "{" << "\"latitude\":" << std::setprecision(10) << nextPos[0] << std::setprecision(6) << ",\"longitude\":" << std::setprecision(10) << nextPos[1] << std::setprecision(6)<< "}" << std::endl;
-                            counter++;
+        }
+        else {
+            const std::vector<std::string> RECORDINGS{findRecordings(commandlineArguments["recs"])};
+            const bool SUMMARY{0 != commandlineArguments.count("summary")};
+            const std::string OUT{commandlineArguments["out"]};
+            const uint32_t JOBS{std::max<uint32_t>(1, (0 != commandlineArguments.count("jobs"))
+                ? static_cast<uint32_t>(std::stoi(commandlineArguments["jobs"])) : std::thread::hardware_concurrency())};
+
+            // Workers take the next recording until none is left; each
+            // recording is processed exactly as in single mode.
+            std::vector<RecordingInformation> information(RECORDINGS.size());
+            std::atomic<size_t> nextRecording{0};
+            std::atomic<bool> failed{false};
+            auto worker = [&]() {
+                for (size_t i{nextRecording++}; i < RECORDINGS.size(); i = nextRecording++) {
+                    const std::string &rec = RECORDINGS[i];
+                    RecordingInformation &r = information[i];
+                    if (!SUMMARY) {
+                        const std::string JSON{(OUT.empty() ? rec : OUT + "/" + rec.substr(rec.find_last_of('/') + 1)) + ".json"};
+                        std::ofstream fout(JSON, std::ios::out|std::ios::trunc);
+                        std::string how;
+                        if (!summarizeToJSON(rec, USE_INDEX, COMMENT_GPS_TOLERANCE, scope, cache.get(), fout, r.numberOfEnvelopes, r.numberOfBytes, how)) {
+                            std::cerr << argv[0] << ": Recording '" + rec + "' not found.\n";
+                            failed = true;
+                        }
+                        else if (!fout.good()) {
+                            std::cerr << argv[0] << ": Could not write '" + JSON + "'.\n";
+                            failed = true;
                         }
+                        continue;
+                    }
+
+                    RecordingSummary summary(COMMENT_GPS_TOLERANCE);
+                    bool indexed{false};
+                    if (!summarize(rec, USE_INDEX, summary, indexed, r.numberOfBytes)) {
+                        std::cerr << argv[0] << ": Recording '" + rec + "' not found.\n";
+                        failed = true;
+                        continue;
                     }
+                    r.processed = true;
+                    r.numberOfEnvelopes = summary.numberOfEnvelopes();
+                    r.firstSampleTimeStamp = summary.firstSampleTimeStamp();
+                    r.lastSampleTimeStamp = summary.lastSampleTimeStamp();
+                    r.numberOfComments = summary.numberOfComments();
+                    r.numberOfGPSReadings = summary.numberOfGPSReadings();
+                    r.numberOfMessagesPerType = summary.numberOfMessagesPerType();
                 }
+            };
+            std::vector<std::thread> workers;
+            for (uint32_t i{0}; i < std::min<size_t>(JOBS, RECORDINGS.size()); i++) {
+                workers.emplace_back(worker);
             }
-            std::cout << " ] ," << std::endl
-                      << " \"fileInformation\": [ " << std::endl
-                      << "{ \"key\": \"number of messages:\", \"value\":\"" << numberOfEnvelopes << "\"}" << std::endl
-                      << ",{ \"key\": \"start of recording:\", \"value\":\"" << strFirstSampleTime << "\"}" << std::endl
-                      << ",{ \"key\": \"end of recording:\", \"value\":\"" << strLastSampleTime << "\"}" << std::endl;
-            std::cout << " ]," << std::endl;
-            std::cout << "\"geojson\":\"ewogICJ0eXBlIjogIkZlYXR1cmUiLAogICJnZW9tZXRyeSI6IHsKICAgICJ0eXBlIjogIlBvaW50IiwKICAgICJjb29yZGluYXRlcyI6IFsxMi4wLCA1Ny43XQogIH0sCiAgInByb3BlcnRpZXMiOiB7CiAgICAibmFtZSI6ICJEaW5hZ2F0IElzbGFuZHMiCiAgfQp9\""<< std::endl;
-            {
-                if (envelopesWithOpendlvProxyGeodeticWgs84Reading.size() >= 2) {
-                    cluon::data::Envelope envFirst = envelopesWithOpendlvProxyGeodeticWgs84Reading.front();
-                    opendlv::proxy::GeodeticWgs84Reading firstPos = cluon::extractMessage<opendlv::proxy::GeodeticWgs84Reading>(std::move(envFirst));
-
-                    cluon::data::Envelope envLast = envelopesWithOpendlvProxyGeodeticWgs84Reading.back();
-                    opendlv::proxy::GeodeticWgs84Reading lastPos = cluon::extractMessage<opendlv::proxy::GeodeticWgs84Reading>(std::move(envLast));
-
-                    {
-                        std::stringstream tmp;
-                        tmp << "{" << "\"latitude\":" << std::setprecision(10) << firstPos.latitude() << std::setprecision(6) << ",\"longitude\":" << std::setprecision(10) << firstPos.longitude() << std::setprecision(6)<< "}";
-                        const std::string out = cluon::ToJSONVisitor::encodeBase64(tmp.str());
-                        std::cout << ",\"firstWGS84\": \"" << out << "\"" << std::endl;
-                    }
-                    {
-                        std::stringstream tmp;
-                        tmp << "{" << "\"latitude\":" << std::setprecision(10) << lastPos.latitude() << std::setprecision(6) << ",\"longitude\":" << std::setprecision(10) << lastPos.longitude() << std::setprecision(6)<< "}";
-                        const std::string out = cluon::ToJSONVisitor::encodeBase64(tmp.str());
-                        std::cout << ",\"lastWGS84\": \"" << out << "\"" << std::endl;
-                    }
+            for (auto &w : workers) {
+                w.join();
+            }
+
+            if (SUMMARY) {
+                writeFleetSummary(std::cout, RECORDINGS, information, scope);
+            }
+            if (BENCHMARK) {
+                uint64_t numberOfEnvelopes{0};
+                uint64_t numberOfBytes{0};
+                for (auto const &r : information) {
+                    numberOfEnvelopes += r.numberOfEnvelopes;
+                    numberOfBytes += r.numberOfBytes;
                 }
+                reportBenchmark(numberOfEnvelopes, numberOfBytes, "from " + std::to_string(RECORDINGS.size()) + " recordings on " + std::to_string(workers.size()) + " threads ");
             }
-            std::cout << "}" << std::endl;
-        }
-        else {
-            std::cerr << argv[0] << ": Recording '" << commandlineArguments["rec"] << "' not found." << std::endl;
+            retCode = failed ? 1 : 0;
         }
     }
     return retCode;
 }
-
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2018 - Christian Berger <christian.berger@gu.se>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+// Include the single-file, header-only cluon library.
+#include "cluon-complete.hpp"
+#include "WGS84toCartesian.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Compares wgs84::toCartesian/fromCartesian, one point per call, with the
+// batched wgs84::Projection on random positions around a reference.
+int32_t main(int32_t argc, char **argv) {
+    auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+    const std::size_t POINTS{(0 != commandlineArguments.count("points")) ? static_cast<std::size_t>(std::stoul(commandlineArguments["points"])) : 4000000};
+    const double RADIUS{(0 != commandlineArguments.count("radius")) ? std::stod(commandlineArguments["radius"]) : 20000.0};
+    const std::size_t INVERSE_SAMPLES{std::min<std::size_t>(POINTS, 2000)};
+    const std::array<double, 2> REFERENCE{{57.7, 11.9}};
+
+    // Positions uniformly spread over a square of +/-RADIUS meters.
+    std::vector<double> latitudes(POINTS);
+    std::vector<double> longitudes(POINTS);
+    {
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<double> offset(-RADIUS, RADIUS);
+        const double METERS_PER_DEGREE{111320.0};
+        for (std::size_t i{0}; i < POINTS; i++) {
+            latitudes[i]  = REFERENCE[0] + offset(generator) / METERS_PER_DEGREE;
+            longitudes[i] = REFERENCE[1] + offset(generator) / (METERS_PER_DEGREE * std::cos(REFERENCE[0] * 3.141592653589793 / 180.0));
+        }
+    }
+
+    auto seconds = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    std::vector<double> x(POINTS);
+    std::vector<double> y(POINTS);
+    auto start{std::chrono::steady_clock::now()};
+    for (std::size_t i{0}; i < POINTS; i++) {
+        const auto c{wgs84::toCartesian(REFERENCE, std::array<double, 2>{{latitudes[i], longitudes[i]}})};
+        x[i] = c[0];
+        y[i] = c[1];
+    }
+    const double PER_POINT_FORWARD{seconds(start)};
+
+    std::vector<double> bx(POINTS);
+    std::vector<double> by(POINTS);
+    start = std::chrono::steady_clock::now();
+    const wgs84::Projection projection(REFERENCE);
+    projection.toCartesian(latitudes.data(), longitudes.data(), POINTS, bx.data(), by.data());
+    const double BATCH_FORWARD{seconds(start)};
+
+    double maxForwardError{0};
+    for (std::size_t i{0}; i < POINTS; i++) {
+        maxForwardError = std::max(maxForwardError, std::hypot(x[i] - bx[i], y[i] - by[i]));
+    }
+
+    std::vector<double> rlat(POINTS);
+    std::vector<double> rlon(POINTS);
+    start = std::chrono::steady_clock::now();
+    projection.fromCartesian(bx.data(), by.data(), POINTS, rlat.data(), rlon.data());
+    const double BATCH_INVERSE{seconds(start)};
+
+    std::vector<double> rx(POINTS);
+    std::vector<double> ry(POINTS);
+    projection.toCartesian(rlat.data(), rlon.data(), POINTS, rx.data(), ry.data());
+    double maxRoundTripError{0};
+    for (std::size_t i{0}; i < POINTS; i++) {
+        maxRoundTripError = std::max(maxRoundTripError, std::hypot(rx[i] - bx[i], ry[i] - by[i]));
+    }
+
+    // The per point inversion searches in steps of 1e-5 degrees, only a sample is feasible.
+    double maxPerPointRoundTripError{0};
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i{0}; i < INVERSE_SAMPLES; i++) {
+        const auto p{wgs84::fromCartesian(REFERENCE, std::array<double, 2>{{x[i], y[i]}})};
+        const auto c{wgs84::toCartesian(REFERENCE, p)};
+        maxPerPointRoundTripError = std::max(maxPerPointRoundTripError, std::hypot(c[0] - x[i], c[1] - y[i]));
+    }
+    const double PER_POINT_INVERSE{seconds(start) * static_cast<double>(POINTS) / static_cast<double>(INVERSE_SAMPLES)};
+
+    auto rate = [POINTS](double s) { return static_cast<double>(POINTS) / s / 1.0e6; };
+    std::cout << std::setprecision(4)
+              << "Points:                " << POINTS << " within +/-" << RADIUS << " m of (" << REFERENCE[0] << ", " << REFERENCE[1] << ")" << std::endl
+              << "toCartesian per point: " << PER_POINT_FORWARD << " s (" << rate(PER_POINT_FORWARD) << " Mpoints/s)" << std::endl
+              << "toCartesian batched:   " << BATCH_FORWARD << " s (" << rate(BATCH_FORWARD) << " Mpoints/s), speedup " << (PER_POINT_FORWARD / BATCH_FORWARD)
+              << ", max deviation " << maxForwardError << " m" << std::endl
+              << "fromCartesian per point (extrapolated from " << INVERSE_SAMPLES << "): " << PER_POINT_INVERSE << " s, max round trip error " << maxPerPointRoundTripError << " m" << std::endl
+              << "fromCartesian batched: " << BATCH_INVERSE << " s (" << rate(BATCH_INVERSE) << " Mpoints/s), speedup " << (PER_POINT_INVERSE / BATCH_INVERSE)
+              << ", max round trip error " << maxRoundTripError << " m" << std::endl;
+    return 0;
+}
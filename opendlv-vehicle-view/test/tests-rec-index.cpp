@@ -0,0 +1,195 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018  Christian Berger
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cluon-complete.hpp"
+#include "RecIndex.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static int32_t failures{0};
+
+#define CHECK(condition)                                                          \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+            failures++;                                                           \
+        }                                                                         \
+    } while (false)
+
+namespace {
+
+struct Sample {
+    int32_t dataType;
+    uint32_t senderStamp;
+    int64_t sampleTimeStamp;  // Microseconds.
+};
+
+std::string writeRecording(const std::vector<Sample> &samples) {
+    char name[]{"/tmp/tests-rec-index-XXXXXX"};
+    const int fd{::mkstemp(name)};
+    ::close(fd);
+    const std::string REC{std::string(name) + ".rec"};
+    ::rename(name, REC.c_str());
+
+    std::ofstream fout(REC, std::ios::out|std::ios::binary|std::ios::trunc);
+    for (const auto &s : samples) {
+        cluon::data::Envelope env;
+        env.dataType(s.dataType);
+        env.senderStamp(s.senderStamp);
+        env.serializedData("payload");
+        env.sampleTimeStamp(cluon::time::fromMicroseconds(s.sampleTimeStamp));
+        const std::string DATA{cluon::serializeEnvelope(std::move(env))};
+        fout.write(DATA.data(), static_cast<std::streamsize>(DATA.size()));
+    }
+    return REC;
+}
+
+void removeRecording(const std::string &rec) {
+    ::unlink(recfile::indexFileFor(rec).c_str());
+    ::unlink(rec.c_str());
+}
+
+void testLowerBound() {
+    // Out of order on purpose, the index sorts by sample time.
+    const std::vector<Sample> SAMPLES{{19, 0, 3000}, {19, 0, 1000}, {1030, 1, 2000}, {19, 0, 2000}, {1030, 1, 5000}};
+    const std::string REC{writeRecording(SAMPLES)};
+
+    std::string error;
+    CHECK(recfile::buildIndex(REC, error));
+    recfile::RecIndex index;
+    CHECK(index.open(REC));
+    if (!index.isOpen()) {
+        removeRecording(REC);
+        return;
+    }
+
+    CHECK(5 == index.numberOfEntries());
+    CHECK(2 == index.numberOfTypes());
+    for (uint64_t i{1}; i < index.numberOfEntries(); i++) {
+        CHECK(index.entry(i - 1).sampleTimeStamp <= index.entry(i).sampleTimeStamp);
+    }
+
+    CHECK(0 == index.lowerBound(0));
+    CHECK(0 == index.lowerBound(1000));
+    CHECK(1 == index.lowerBound(1001));
+    CHECK(1 == index.lowerBound(2000));
+    CHECK(3 == index.lowerBound(2001));
+    CHECK(4 == index.lowerBound(5000));
+    CHECK(5 == index.lowerBound(5001));
+
+    // Equal time stamps keep the order of the recording.
+    CHECK(1030 == SAMPLES[2].dataType);
+    CHECK(index.entry(1).offset() < index.entry(2).offset());
+
+    // Postings of a type are ordered by sample time.
+    for (uint32_t t{0}; t < index.numberOfTypes(); t++) {
+        const recfile::IndexTypeSummary &summary{index.type(t)};
+        const uint32_t *postings{index.postings(t)};
+        CHECK((19 == summary.dataType) ? (3 == summary.numberOfEnvelopes) : (2 == summary.numberOfEnvelopes));
+        for (uint64_t i{0}; i < summary.numberOfEnvelopes; i++) {
+            CHECK(t == index.entry(postings[i]).type());
+            CHECK((0 == i) || (index.entry(postings[i - 1]).sampleTimeStamp <= index.entry(postings[i]).sampleTimeStamp));
+        }
+        CHECK(summary.firstSampleTimeStamp == index.entry(postings[0]).sampleTimeStamp);
+        CHECK(summary.lastSampleTimeStamp == index.entry(postings[summary.numberOfEnvelopes - 1]).sampleTimeStamp);
+    }
+
+    // Entries point at their envelopes.
+    recfile::MappedFile recording;
+    CHECK(recording.open(REC));
+    for (uint64_t i{0}; i < index.numberOfEntries(); i++) {
+        recfile::EnvelopeHeader header;
+        CHECK(recfile::envelopeAt(recording, index.entry(i).offset(), header));
+        CHECK(header.sampleTimeStamp == index.entry(i).sampleTimeStamp);
+    }
+
+    removeRecording(REC);
+}
+
+void testStaleness() {
+    const std::string REC{writeRecording({{19, 0, 1000}, {19, 0, 2000}})};
+
+    std::string error;
+    CHECK(recfile::buildIndex(REC, error));
+    {
+        recfile::RecIndex index;
+        CHECK(index.open(REC));
+    }
+
+    // Same size, other modification time.
+    {
+        struct timespec times[2];
+        times[0].tv_sec = 0;
+        times[0].tv_nsec = UTIME_OMIT;
+        times[1].tv_sec = 1000000000;
+        times[1].tv_nsec = 0;
+        CHECK(0 == ::utimensat(AT_FDCWD, REC.c_str(), times, 0));
+        recfile::RecIndex index;
+        CHECK(!index.open(REC));
+    }
+
+    CHECK(recfile::buildIndex(REC, error));
+    {
+        recfile::RecIndex index;
+        CHECK(index.open(REC));
+    }
+
+    // A growing recording.
+    {
+        std::ofstream fout(REC, std::ios::out|std::ios::binary|std::ios::app);
+        fout << "x";
+    }
+    {
+        recfile::RecIndex index;
+        CHECK(!index.open(REC));
+    }
+
+    // Missing index.
+    ::unlink(recfile::indexFileFor(REC).c_str());
+    {
+        recfile::RecIndex index;
+        CHECK(!index.open(REC));
+    }
+
+    removeRecording(REC);
+}
+
+}
+
+int32_t main() {
+    testLowerBound();
+    testStaleness();
+    if (0 != failures) {
+        std::cerr << failures << " check(s) failed." << std::endl;
+    }
+    return (0 == failures) ? 0 : 1;
+}
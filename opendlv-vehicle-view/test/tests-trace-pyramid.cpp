@@ -0,0 +1,179 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018  Christian Berger
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TracePyramid.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+static int32_t failures{0};
+
+#define CHECK(condition)                                                          \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+            failures++;                                                           \
+        }                                                                         \
+    } while (false)
+
+namespace {
+
+// (latitude, longitude) in 1e-7 degrees.
+using Coordinate = std::pair<int64_t, int64_t>;
+
+bool decode(const std::string &data, std::vector<Coordinate> &points) {
+    points.clear();
+    int64_t values[2]{0, 0};
+    size_t component{0};
+    uint64_t v{0};
+    uint32_t shift{0};
+    for (const char c : data) {
+        const uint8_t BYTE{static_cast<uint8_t>(c)};
+        v |= static_cast<uint64_t>(BYTE & 0x7F) << shift;
+        shift += 7;
+        if (0 == (BYTE & 0x80)) {
+            const int64_t DELTA{static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1)};
+            values[component] += DELTA;
+            component = 1 - component;
+            if (0 == component) {
+                points.emplace_back(values[0], values[1]);
+            }
+            v = 0;
+            shift = 0;
+        }
+    }
+    return (0 == component) && (0 == shift);
+}
+
+bool isSubset(const std::vector<Coordinate> &coarse, const std::vector<Coordinate> &fine) {
+    size_t j{0};
+    for (const auto &p : coarse) {
+        while ((j < fine.size()) && (fine[j] != p)) {
+            j++;
+        }
+        if (j == fine.size()) {
+            return false;
+        }
+        j++;
+    }
+    return true;
+}
+
+void testEncoding() {
+    wgs84::TracePyramid pyramid({0.0});
+    pyramid.add(0.0, 0.0, 0.0000001, -0.0000001);
+    pyramid.add(1.0, 1.0, 57.7, 11.9);
+    pyramid.add(2.0, 0.0, -33.9, -151.2);
+    pyramid.flush();
+
+    CHECK(1 == pyramid.numberOfLevels());
+    CHECK(3 == pyramid.numberOfPoints(0));
+
+    // First point relative to 0: zigzag(1) = 2, zigzag(-1) = 1.
+    const std::string &DATA{pyramid.data(0)};
+    CHECK(DATA.size() > 2);
+    CHECK(0x02 == static_cast<uint8_t>(DATA[0]));
+    CHECK(0x01 == static_cast<uint8_t>(DATA[1]));
+
+    std::vector<Coordinate> points;
+    CHECK(decode(DATA, points));
+    CHECK(3 == points.size());
+    if (3 == points.size()) {
+        CHECK(Coordinate(1, -1) == points[0]);
+        CHECK(Coordinate(577000000, 119000000) == points[1]);
+        CHECK(Coordinate(-339000000, -1512000000) == points[2]);
+    }
+}
+
+void testDecimation() {
+    // A zigzag of 1 m amplitude along x.
+    const std::vector<double> TOLERANCES{0.5, 2.0};
+    wgs84::TracePyramid pyramid(TOLERANCES);
+    const uint32_t N{101};
+    for (uint32_t i{0}; i < N; i++) {
+        const double X{static_cast<double>(i)};
+        const double Y{(0 == (i % 2)) ? 0.0 : 1.0};
+        pyramid.add(X, Y, Y * 1.0e-5, X * 1.0e-5);
+    }
+    pyramid.flush();
+
+    CHECK(2 == pyramid.numberOfLevels());
+    CHECK(std::fabs(pyramid.tolerance(0) - 0.5) < 1.0e-12);
+    CHECK(std::fabs(pyramid.tolerance(1) - 2.0) < 1.0e-12);
+    CHECK(N == pyramid.numberOfPoints(0));
+    CHECK(2 == pyramid.numberOfPoints(1));
+
+    std::vector<Coordinate> fine;
+    std::vector<Coordinate> coarse;
+    CHECK(decode(pyramid.data(0), fine));
+    CHECK(decode(pyramid.data(1), coarse));
+    CHECK(fine.size() == pyramid.numberOfPoints(0));
+    CHECK(coarse.size() == pyramid.numberOfPoints(1));
+    CHECK(isSubset(coarse, fine));
+    CHECK(!coarse.empty() && (fine.front() == coarse.front()) && (fine.back() == coarse.back()));
+}
+
+void testWindows() {
+    // A straight line collapses to the window endpoints, each emitted once.
+    wgs84::TracePyramid pyramid({0.1, 10.0}, 4);
+    for (uint32_t i{0}; i < 10; i++) {
+        const double X{static_cast<double>(i)};
+        pyramid.add(X, 0.0, 0.0, X * 1.0e-5);
+    }
+    pyramid.flush();
+
+    for (size_t level{0}; level < pyramid.numberOfLevels(); level++) {
+        std::vector<Coordinate> points;
+        CHECK(decode(pyramid.data(level), points));
+        CHECK(4 == points.size());
+        if (4 == points.size()) {
+            CHECK(Coordinate(0, 0) == points[0]);
+            CHECK(Coordinate(0, 300) == points[1]);
+            CHECK(Coordinate(0, 600) == points[2]);
+            CHECK(Coordinate(0, 900) == points[3]);
+        }
+    }
+
+    // After a flush the next position starts a new window and is emitted.
+    pyramid.add(100.0, 0.0, 0.0, 100.0e-5);
+    pyramid.flush();
+    CHECK(5 == pyramid.numberOfPoints(0));
+    CHECK(5 == pyramid.numberOfPoints(1));
+}
+
+}
+
+int32_t main() {
+    testEncoding();
+    testDecimation();
+    testWindows();
+    if (0 != failures) {
+        std::cerr << failures << " check(s) failed." << std::endl;
+    }
+    return (0 == failures) ? 0 : 1;
+}